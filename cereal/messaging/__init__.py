@@ -4,7 +4,7 @@ from .messaging_pyx import MultiplePublishersError, MessagingError  # pylint: di
 import os
 import capnp
 
-from typing import Optional, List, Union
+from typing import Callable, Optional, List, Union
 from collections import deque
 
 from cereal import log
@@ -136,7 +136,11 @@ def recv_one_retry(sock: SubSocket) -> capnp.lib.capnp._DynamicStructReader:
 class SubMaster():
   def __init__(self, services: List[str], poll: Optional[List[str]] = None,
                ignore_alive: Optional[List[str]] = None, ignore_avg_freq: Optional[List[str]] = None,
-               addr: str = "127.0.0.1"):
+               addr: str = "127.0.0.1",
+               on_message: Optional[Callable[[str, capnp.lib.capnp._DynamicStructReader], None]] = None):
+    # with on_message set the sockets queue every message instead of keeping the latest,
+    # update drains them all and calls on_message(service, msg) for each
+    self.on_message = on_message
     self.frame = -1
     self.updated = {s: False for s in services}
     self.rcv_time = {s: 0. for s in services}
@@ -159,7 +163,7 @@ class SubMaster():
     for s in services:
       if addr is not None:
         p = self.poller if s not in self.non_polled_services else None
-        self.sock[s] = sub_sock(s, poller=p, addr=addr, conflate=True)
+        self.sock[s] = sub_sock(s, poller=p, addr=addr, conflate=on_message is None)
       self.freq[s] = service_list[s].frequency
 
       try:
@@ -177,13 +181,22 @@ class SubMaster():
   def update(self, timeout: int = 1000) -> None:
     msgs = []
     for sock in self.poller.poll(timeout):
-      msgs.append(recv_one_or_none(sock))
+      msgs.append(self._receive(sock))
 
     # non-blocking receive for non-polled sockets
     for s in self.non_polled_services:
-      msgs.append(recv_one_or_none(self.sock[s]))
+      msgs.append(self._receive(self.sock[s]))
     self.update_msgs(sec_since_boot(), msgs)
 
+  def _receive(self, sock: SubSocket) -> Optional[capnp.lib.capnp._DynamicStructReader]:
+    if self.on_message is None:
+      return recv_one_or_none(sock)
+
+    msgs = drain_sock(sock)
+    for msg in msgs:
+      self.on_message(msg.which(), msg)
+    return msgs[-1] if len(msgs) else None
+
   def update_msgs(self, cur_time: float, msgs: List[capnp.lib.capnp._DynamicStructReader]) -> None:
     self.frame += 1
     self.updated = dict.fromkeys(self.updated, False)
@@ -0,0 +1,124 @@
+#include <getopt.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "impl_msgq.h"
+#include "impl_zmq.h"
+
+// Publishes can, sensorEvents and modelV2 on msgq at their full rates and sizes and
+// receives them back over zmq on loopback through a running bridge, reporting what
+// made it through and the latency.
+//
+// usage: ./bridge & ./bench_bridge [-s seconds] [-x rate multiplier]
+
+struct BenchService {
+  const char *name;
+  int freq;
+  size_t size;  // typical serialized size in bytes
+  std::atomic<uint64_t> sent = 0, received = 0, latency_ns = 0, max_latency_ns = 0;
+};
+
+static inline uint64_t nanos() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static void publish(BenchService *s, Context *ctx, double rate, int seconds) {
+  MSGQPubSocket pub;
+  pub.connect(ctx, s->name);
+  std::vector<char> dat(s->size);
+
+  const auto period = std::chrono::nanoseconds((uint64_t)(1e9 / (s->freq * rate)));
+  auto next = std::chrono::steady_clock::now();
+  const auto end = next + std::chrono::seconds(seconds);
+  while (next < end) {
+    // the send time goes in the payload for the receiver's latency
+    uint64_t t = nanos();
+    memcpy(dat.data(), &t, sizeof(t));
+    pub.send(dat.data(), dat.size());
+    s->sent++;
+    next += period;
+    std::this_thread::sleep_until(next);
+  }
+}
+
+static void receive(std::vector<std::unique_ptr<BenchService>> *bench_services, Context *ctx, std::atomic<bool> *stop) {
+  ZMQPoller poller;
+  std::vector<std::unique_ptr<ZMQSubSocket>> socks;
+  std::unordered_map<SubSocket*, BenchService*> sock2service;
+  for (auto &s : *bench_services) {
+    socks.push_back(std::make_unique<ZMQSubSocket>());
+    socks.back()->connect(ctx, s->name, "127.0.0.1", false);
+    poller.registerSocket(socks.back().get());
+    sock2service[socks.back().get()] = s.get();
+  }
+
+  std::vector<SubSocket*> ready;
+  while (!*stop) {
+    poller.poll(100, ready);
+    for (auto sock : ready) {
+      BenchService *s = sock2service.at(sock);
+      Message *msg;
+      while ((msg = sock->receive(true)) != nullptr) {
+        uint64_t t;
+        memcpy(&t, msg->getData(), sizeof(t));
+        uint64_t latency = nanos() - t;
+        s->received++;
+        s->latency_ns += latency;
+        if (latency > s->max_latency_ns) s->max_latency_ns = latency;
+        delete msg;
+      }
+    }
+  }
+}
+
+int main(int argc, char **argv) {
+  int seconds = 10;
+  double rate = 1.0;
+  int opt;
+  while ((opt = getopt(argc, argv, "s:x:")) != -1) {
+    switch (opt) {
+      case 's': seconds = atoi(optarg); break;
+      case 'x': rate = atof(optarg); break;
+      default:
+        printf("usage: %s [-s seconds] [-x rate multiplier]\n", argv[0]);
+        return 1;
+    }
+  }
+
+  std::vector<std::unique_ptr<BenchService>> bench_services;
+  bench_services.push_back(std::unique_ptr<BenchService>(new BenchService{"can", 100, 2000}));
+  bench_services.push_back(std::unique_ptr<BenchService>(new BenchService{"sensorEvents", 100, 1200}));
+  bench_services.push_back(std::unique_ptr<BenchService>(new BenchService{"modelV2", 20, 40000}));
+
+  MSGQContext msgq_ctx;
+  ZMQContext zmq_ctx;
+  std::atomic<bool> stop = false;
+  std::thread receiver(receive, &bench_services, &zmq_ctx, &stop);
+  // let the subscriptions reach the bridge before publishing
+  std::this_thread::sleep_for(std::chrono::seconds(1));
+
+  std::vector<std::thread> publishers;
+  for (auto &s : bench_services) {
+    publishers.emplace_back(publish, s.get(), &msgq_ctx, rate, seconds);
+  }
+  for (auto &t : publishers) t.join();
+  std::this_thread::sleep_for(std::chrono::milliseconds(500));
+  stop = true;
+  receiver.join();
+
+  printf("%-14s %10s %10s %10s %12s %12s\n", "service", "sent", "received", "MB/s", "latency avg", "latency max");
+  for (auto &s : bench_services) {
+    uint64_t received = s->received;
+    printf("%-14s %10lu %10lu %10.2f %9.2f ms %9.2f ms\n", s->name, (uint64_t)s->sent, received,
+           received * s->size / 1e6 / seconds, received ? s->latency_ns / 1e6 / received : 0., s->max_latency_ns / 1e6);
+  }
+  return 0;
+}
@@ -0,0 +1,122 @@
+#include <getopt.h>
+#include <time.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+#include "messaging.h"
+
+// A SubMaster of 20 services published at 100 Hz, updated at 100 Hz like
+// controlsd. Reports the cost of update() and of looking services up by name
+// and by index, and how many of the published messages were seen.
+//
+// usage: bench_submaster [-s seconds] [-b burst] [-d]
+//   -b  messages published per service every tick
+//   -d  drain every queued message with a per-message callback
+
+const int FREQ = 100;
+const std::vector<const char *> SERVICES = {
+  "sensorEvents", "can", "controlsState", "sendcan", "carState",
+  "carControl", "longitudinalPlan", "lateralPlan", "pandaStates", "radarState",
+  "liveCalibration", "deviceState", "modelV2", "driverState", "driverMonitoringState",
+  "liveLocationKalman", "liveParameters", "cameraOdometry", "gpsLocationExternal", "roadCameraState",
+};
+
+static inline uint64_t nanos() {
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return t.tv_sec * 1000000000ULL + t.tv_nsec;
+}
+
+static void publish(std::atomic<bool> *stop, int burst) {
+  PubMaster pm(SERVICES);
+  auto next = std::chrono::steady_clock::now();
+  while (!*stop) {
+    for (auto name : SERVICES) {
+      for (int i = 0; i < burst; i++) {
+        MessageBuilder msg;
+        msg.initEvent();
+        pm.send(name, msg);
+      }
+    }
+    next += std::chrono::microseconds(1000000 / FREQ);
+    std::this_thread::sleep_until(next);
+  }
+}
+
+int main(int argc, char **argv) {
+  int seconds = 10, burst = 1;
+  bool drain = false;
+  int opt;
+  while ((opt = getopt(argc, argv, "s:b:d")) != -1) {
+    switch (opt) {
+      case 's': seconds = atoi(optarg); break;
+      case 'b': burst = atoi(optarg); break;
+      case 'd': drain = true; break;
+      default:
+        printf("usage: %s [-s seconds] [-b burst] [-d]\n", argv[0]);
+        return 1;
+    }
+  }
+
+  uint64_t callbacks = 0;
+  SubMaster::MessageCallback on_message = nullptr;
+  if (drain) {
+    on_message = [&](int idx, cereal::Event::Reader &event) { callbacks++; };
+  }
+  SubMaster sm(SERVICES, nullptr, {}, on_message);
+
+  std::vector<int> idxs;
+  for (auto name : SERVICES) idxs.push_back(sm.index(name));
+
+  std::atomic<bool> stop = false;
+  std::thread publisher(publish, &stop, burst);
+
+  uint64_t updates = 0, received = 0, lookups = 0;
+  uint64_t update_ns = 0, update_max_ns = 0, name_ns = 0, index_ns = 0;
+  volatile uint64_t sum = 0;  // keeps the lookups from being optimized out
+
+  auto next = std::chrono::steady_clock::now();
+  for (int i = 0; i < seconds * FREQ; i++) {
+    next += std::chrono::microseconds(1000000 / FREQ);
+    std::this_thread::sleep_until(next);
+
+    uint64_t t1 = nanos();
+    sm.update(0);
+    uint64_t t2 = nanos();
+    for (auto name : SERVICES) {
+      if (sm.updated(name)) sum += sm[name].getLogMonoTime() + sm.rcv_frame(name);
+    }
+    uint64_t t3 = nanos();
+    for (int idx : idxs) {
+      if (sm.updated(idx)) {
+        received++;
+        sum += sm[idx].getLogMonoTime() + sm.rcv_frame(idx);
+      }
+    }
+    uint64_t t4 = nanos();
+
+    updates++;
+    update_ns += t2 - t1;
+    update_max_ns = std::max(update_max_ns, t2 - t1);
+    name_ns += t3 - t2;
+    index_ns += t4 - t3;
+    lookups += SERVICES.size();
+  }
+
+  stop = true;
+  publisher.join();
+
+  uint64_t published = (uint64_t)seconds * FREQ * burst * SERVICES.size();
+  printf("%zu services at %d Hz, %d per tick%s\n", SERVICES.size(), FREQ, burst, drain ? ", draining" : "");
+  printf("update: %.1f us avg, %.1f us max\n", update_ns / 1e3 / updates, update_max_ns / 1e3);
+  printf("lookup: %.1f ns by name, %.1f ns by index\n", (double)name_ns / lookups, (double)index_ns / lookups);
+  printf("updated: %lu of ~%lu published\n", received, published);
+  if (drain) printf("callbacks: %lu\n", callbacks);
+  return 0;
+}
@@ -1,9 +1,16 @@
 #include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <chrono>
 #include <csignal>
+#include <cstdio>
 #include <iostream>
-#include <map>
+#include <memory>
+#include <sstream>
 #include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
 
 typedef void (*sighandler_t)(int sig);
 
@@ -11,17 +18,39 @@ typedef void (*sighandler_t)(int sig);
 #include "impl_zmq.h"
 #include "services.h"
 
+// seconds between the throughput reports
+const int REPORT_INTERVAL = 10;
+
+std::atomic<bool> do_exit = false;
+
 void sigpipe_handler(int sig) {
   assert(sig == SIGPIPE);
   std::cout << "SIGPIPE received" << std::endl;
 }
 
-static std::vector<std::string> get_services(std::string whitelist_str, bool zmq_to_msgq) {
+void exit_handler(int sig) {
+  do_exit = true;
+}
+
+// service names separated by commas or spaces
+static std::vector<std::string> split_list(std::string list_str) {
+  std::replace(list_str.begin(), list_str.end(), ',', ' ');
+  std::vector<std::string> list;
+  std::stringstream ss(list_str);
+  std::string name;
+  while (ss >> name) {
+    list.push_back(name);
+  }
+  return list;
+}
+
+static std::vector<std::string> get_services(const std::vector<std::string> &whitelist, bool filter) {
   std::vector<std::string> service_list;
   for (const auto& it : services) {
     std::string name = it.name;
-    bool in_whitelist = whitelist_str.find(name) != std::string::npos;
-    if (name == "plusFrame" || name == "uiLayoutState" || (zmq_to_msgq && !in_whitelist)) {
+    // exact match, so "can" doesn't bring in "sendcan"
+    bool in_whitelist = std::find(whitelist.begin(), whitelist.end(), name) != whitelist.end();
+    if (name == "plusFrame" || name == "uiLayoutState" || (filter && !in_whitelist)) {
       continue;
     }
     service_list.push_back(name);
@@ -29,51 +58,133 @@ static std::vector<std::string> get_services(std::string whitelist_str, bool zmq
   return service_list;
 }
 
+struct Route {
+  std::string name;
+  std::unique_ptr<SubSocket> sub;
+  std::unique_ptr<PubSocket> pub;
+  // written by the bridge thread, read by the reporter
+  std::atomic<uint64_t> msgs = 0, bytes = 0, drops = 0;
+};
+
+// Forwards the services from one transport to the other on its own thread. Every
+// ready socket is drained on each wakeup, so a burst goes out back to back instead
+// of one message per poll.
+class Bridge {
+public:
+  Bridge(const char *name, bool zmq_to_msgq, const std::string &ip, const std::vector<std::string> &service_list)
+    : name(name) {
+    if (zmq_to_msgq) {  // republishes zmq debugging messages as msgq
+      poller.reset(new ZMQPoller());
+      pub_context.reset(new MSGQContext());
+      sub_context.reset(new ZMQContext());
+    } else {
+      poller.reset(new MSGQPoller());
+      pub_context.reset(new ZMQContext());
+      sub_context.reset(new MSGQContext());
+    }
+
+    for (auto &endpoint : service_list) {
+      auto r = std::make_unique<Route>();
+      r->name = endpoint;
+      if (zmq_to_msgq) {
+        r->pub.reset(new MSGQPubSocket());
+        r->sub.reset(new ZMQSubSocket());
+      } else {
+        r->pub.reset(new ZMQPubSocket());
+        r->sub.reset(new MSGQSubSocket());
+      }
+      r->pub->connect(pub_context.get(), endpoint);
+      r->sub->connect(sub_context.get(), endpoint, ip, false);
+
+      poller->registerSocket(r->sub.get());
+      sub2route[r->sub.get()] = r.get();
+      routes.push_back(std::move(r));
+    }
+  }
+
+  void run() {
+    std::vector<SubSocket*> ready;
+    while (!do_exit) {
+      poller->poll(100, ready);
+      for (auto sub_sock : ready) {
+        Route *r = sub2route.at(sub_sock);
+        Message *msg;
+        while ((msg = sub_sock->receive(true)) != nullptr) {
+          size_t size = msg->getSize();
+          if (r->pub->sendMessage(msg) < 0) {
+            r->drops++;
+          } else {
+            r->msgs++;
+            r->bytes += size;
+          }
+          delete msg;
+        }
+      }
+    }
+  }
+
+  // prints the services that had traffic since the last report
+  void report(double seconds) {
+    for (auto &r : routes) {
+      uint64_t msgs = r->msgs.exchange(0), bytes = r->bytes.exchange(0), drops = r->drops.exchange(0);
+      if (msgs > 0 || drops > 0) {
+        printf("%s %-24s %8.1f msgs/s %8.1f KB/s %6lu drops\n", name, r->name.c_str(),
+               msgs / seconds, bytes / seconds / 1024., drops);
+      }
+    }
+  }
+
+private:
+  const char *name;
+  std::unique_ptr<Poller> poller;
+  std::unique_ptr<Context> pub_context, sub_context;
+  std::vector<std::unique_ptr<Route>> routes;
+  std::unordered_map<SubSocket*, Route*> sub2route;
+};
+
+// usage:
+//   bridge                                   msgq -> zmq, every service
+//   bridge <ip> <whitelist>                  zmq on ip -> msgq, the services in whitelist
+//   bridge <ip> <whitelist> <publish_list>   and also msgq -> zmq for publish_list
+// lists are service names separated by commas or spaces
 int main(int argc, char** argv) {
   signal(SIGPIPE, (sighandler_t)sigpipe_handler);
+  signal(SIGINT, (sighandler_t)exit_handler);
+  signal(SIGTERM, (sighandler_t)exit_handler);
 
-  bool zmq_to_msgq = argc > 2;
-  std::string ip = zmq_to_msgq ? argv[1] : "127.0.0.1";
-  std::string whitelist_str = zmq_to_msgq ? std::string(argv[2]) : "";
-
-  Poller *poller;
-  Context *pub_context;
-  Context *sub_context;
-  if (zmq_to_msgq) {  // republishes zmq debugging messages as msgq
-    poller = new ZMQPoller();
-    pub_context = new MSGQContext();
-    sub_context = new ZMQContext();
+  std::vector<std::unique_ptr<Bridge>> bridges;
+  if (argc > 2) {
+    auto whitelist = split_list(argv[2]);
+    bridges.push_back(std::make_unique<Bridge>("zmq->msgq", true, argv[1], get_services(whitelist, true)));
+    if (argc > 3) {
+      // a service bridged both ways would loop back on itself
+      auto publish_list = split_list(argv[3]);
+      publish_list.erase(std::remove_if(publish_list.begin(), publish_list.end(), [&](const std::string &name) {
+        return std::find(whitelist.begin(), whitelist.end(), name) != whitelist.end();
+      }), publish_list.end());
+      bridges.push_back(std::make_unique<Bridge>("msgq->zmq", false, "127.0.0.1", get_services(publish_list, true)));
+    }
   } else {
-    poller = new MSGQPoller();
-    pub_context = new ZMQContext();
-    sub_context = new MSGQContext();
+    bridges.push_back(std::make_unique<Bridge>("msgq->zmq", false, "127.0.0.1", get_services({}, false)));
   }
 
-  std::map<SubSocket*, PubSocket*> sub2pub;
-  for (auto endpoint: get_services(whitelist_str, zmq_to_msgq)) {
-    PubSocket * pub_sock;
-    SubSocket * sub_sock;
-    if (zmq_to_msgq) {
-      pub_sock = new MSGQPubSocket();
-      sub_sock = new ZMQSubSocket();
-    } else {
-      pub_sock = new ZMQPubSocket();
-      sub_sock = new MSGQSubSocket();
-    }
-    pub_sock->connect(pub_context, endpoint);
-    sub_sock->connect(sub_context, endpoint, ip, false);
-
-    poller->registerSocket(sub_sock);
-    sub2pub[sub_sock] = pub_sock;
+  std::vector<std::thread> threads;
+  for (auto &b : bridges) {
+    threads.emplace_back(&Bridge::run, b.get());
   }
 
-  while (true) {
-    for (auto sub_sock : poller->poll(100)) {
-      Message * msg = sub_sock->receive();
-      if (msg == NULL) continue;
-      sub2pub[sub_sock]->sendMessage(msg);
-      delete msg;
+  auto last_report = std::chrono::steady_clock::now();
+  while (!do_exit) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    auto now = std::chrono::steady_clock::now();
+    double seconds = std::chrono::duration<double>(now - last_report).count();
+    if (seconds >= REPORT_INTERVAL) {
+      for (auto &b : bridges) b->report(seconds);
+      fflush(stdout);
+      last_report = now;
     }
   }
+
+  for (auto &t : threads) t.join();
   return 0;
 }
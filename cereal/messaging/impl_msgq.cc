@@ -216,15 +216,13 @@ void MSGQPoller::registerSocket(SubSocket * socket){
   num_polls++;
 }
 
-std::vector<SubSocket*> MSGQPoller::poll(int timeout){
-  std::vector<SubSocket*> r;
+void MSGQPoller::poll(int timeout, std::vector<SubSocket*> &ready){
+  ready.clear();
 
   msgq_poll(polls, num_polls, timeout);
   for (size_t i = 0; i < num_polls; i++){
     if (polls[i].revents){
-      r.push_back(sockets[i]);
+      ready.push_back(sockets[i]);
     }
   }
-
-  return r;
 }
@@ -60,6 +60,7 @@ private:
 
 public:
   void registerSocket(SubSocket *socket);
-  std::vector<SubSocket*> poll(int timeout);
+  using Poller::poll;
+  void poll(int timeout, std::vector<SubSocket*> &ready);
   ~MSGQPoller(){};
 };
@@ -150,19 +150,17 @@ void ZMQPoller::registerSocket(SubSocket * socket){
   num_polls++;
 }
 
-std::vector<SubSocket*> ZMQPoller::poll(int timeout){
-  std::vector<SubSocket*> r;
+void ZMQPoller::poll(int timeout, std::vector<SubSocket*> &ready){
+  ready.clear();
 
   int rc = zmq_poll(polls, num_polls, timeout);
   if (rc < 0){
-    return r;
+    return;
   }
 
   for (size_t i = 0; i < num_polls; i++){
     if (polls[i].revents){
-      r.push_back(sockets[i]);
+      ready.push_back(sockets[i]);
     }
   }
-
-  return r;
 }
@@ -1,7 +1,11 @@
 #pragma once
 #include <cstddef>
+#include <cstring>
+#include <functional>
 #include <map>
 #include <string>
+#include <string_view>
+#include <unordered_map>
 #include <vector>
 #include <capnp/serialize.h>
 #include "../gen/cpp/log.capnp.h"
@@ -58,7 +62,13 @@ public:
 class Poller {
 public:
   virtual void registerSocket(SubSocket *socket) = 0;
-  virtual std::vector<SubSocket*> poll(int timeout) = 0;
+  // fills ready with the sockets that have a message, reuse it to poll without allocating
+  virtual void poll(int timeout, std::vector<SubSocket*> &ready) = 0;
+  std::vector<SubSocket*> poll(int timeout) {
+    std::vector<SubSocket*> ready;
+    poll(timeout, ready);
+    return ready;
+  }
   static Poller * create();
   static Poller * create(std::vector<SubSocket*> sockets);
   virtual ~Poller(){};
@@ -66,10 +76,16 @@ public:
 
 class SubMaster {
 public:
+  // called for every message received by update() when draining, before the next one replaces it
+  typedef std::function<void(int idx, cereal::Event::Reader &event)> MessageCallback;
+
+  // with on_message set the sockets queue every message instead of keeping the latest,
+  // and update() drains them all
   SubMaster(const std::vector<const char *> &service_list,
-            const char *address = nullptr, const std::vector<const char *> &ignore_alive = {});
+            const char *address = nullptr, const std::vector<const char *> &ignore_alive = {},
+            MessageCallback on_message = nullptr);
   void update(int timeout = 1000);
-  void update_msgs(uint64_t current_time, const std::vector<std::pair<std::string, cereal::Event::Reader>> &messages);
+  void update_msgs(uint64_t current_time, const std::vector<std::pair<const char *, cereal::Event::Reader>> &messages);
   inline bool allAlive(const std::vector<const char *> &service_list = {}) { return all_(service_list, false, true); }
   inline bool allValid(const std::vector<const char *> &service_list = {}) { return all_(service_list, true, false); }
   inline bool allAliveAndValid(const std::vector<const char *> &service_list = {}) { return all_(service_list, true, true); }
@@ -77,24 +93,53 @@ public:
   ~SubMaster();
 
   uint64_t frame = 0;
-  bool updated(const char *name) const;
-  bool alive(const char *name) const;
-  bool valid(const char *name) const;
-  uint64_t rcv_frame(const char *name) const;
-  uint64_t rcv_time(const char *name) const;
-  cereal::Event::Reader &operator[](const char *name) const;
+
+  // index of a subscribed service in the order of service_list. resolve it once and
+  // use it instead of the name in hot loops, it skips the lookup
+  int index(const char *name) const;
+  inline size_t size() const { return messages_.size(); }
+
+  bool updated(int idx) const;
+  bool alive(int idx) const;
+  bool valid(int idx) const;
+  uint64_t rcv_frame(int idx) const;
+  uint64_t rcv_time(int idx) const;
+  cereal::Event::Reader &operator[](int idx) const;
+
+  inline bool updated(const char *name) const { return updated(index(name)); }
+  inline bool alive(const char *name) const { return alive(index(name)); }
+  inline bool valid(const char *name) const { return valid(index(name)); }
+  inline uint64_t rcv_frame(const char *name) const { return rcv_frame(index(name)); }
+  inline uint64_t rcv_time(const char *name) const { return rcv_time(index(name)); }
+  inline cereal::Event::Reader &operator[](const char *name) const { return (*this)[index(name)]; }
 
 private:
+  struct SubMessage;
   bool all_(const std::vector<const char *> &service_list, bool valid, bool alive);
+  void receive(SubMessage *m, Message *msg);
+  void set_updated(SubMessage *m, uint64_t current_time);
+  void update_alive(uint64_t current_time);
+
   Poller *poller_ = nullptr;
-  struct SubMessage;
-  std::map<SubSocket *, SubMessage *> messages_;
-  std::map<std::string, SubMessage *> services_;
+  MessageCallback on_message_;
+  std::vector<SubMessage *> messages_;
+  std::map<SubSocket *, SubMessage *> sockets_;
+  std::unordered_map<std::string_view, int> services_;
+  std::vector<SubSocket *> ready_;
 };
 
 class MessageBuilder : public capnp::MallocMessageBuilder {
 public:
   MessageBuilder() = default;
+  // builds into first_segment before allocating, reuse it to avoid a malloc per message.
+  // capnp expects it zeroed and zeroes what it used on destruction, allocate it with firstSegment
+  MessageBuilder(kj::ArrayPtr<capnp::word> first_segment) : capnp::MallocMessageBuilder(first_segment) {}
+
+  static kj::Array<capnp::word> firstSegment(size_t words) {
+    auto segment = kj::heapArray<capnp::word>(words);
+    memset(segment.begin(), 0, segment.asBytes().size());
+    return segment;
+  }
 
   cereal::Event::Builder initEvent(bool valid = true) {
     cereal::Event::Builder event = initRoot<cereal::Event>();
@@ -47,6 +47,7 @@ MessageContext message_context;
 struct SubMaster::SubMessage {
   std::string name;
   SubSocket *socket = nullptr;
+  int idx = 0;
   int freq = 0;
   bool updated = false, alive = false, valid = true, ignore_alive;
   uint64_t rcv_time = 0, rcv_frame = 0;
@@ -57,52 +58,68 @@ struct SubMaster::SubMessage {
 };
 
 SubMaster::SubMaster(const std::vector<const char *> &service_list, const char *address,
-                     const std::vector<const char *> &ignore_alive) {
+                     const std::vector<const char *> &ignore_alive, MessageCallback on_message)
+  : on_message_(on_message) {
   poller_ = Poller::create();
   for (auto name : service_list) {
     const service *serv = get_service(name);
     assert(serv != nullptr);
-    SubSocket *socket = SubSocket::create(message_context.context(), name, address ? address : "127.0.0.1", true);
+    SubSocket *socket = SubSocket::create(message_context.context(), name, address ? address : "127.0.0.1", !on_message_);
     assert(socket != 0);
     poller_->registerSocket(socket);
     SubMessage *m = new SubMessage{
       .name = name,
       .socket = socket,
+      .idx = (int)messages_.size(),
       .freq = serv->frequency,
       .ignore_alive = inList(ignore_alive, name),
       .allocated_msg_reader = malloc(sizeof(capnp::FlatArrayMessageReader))};
     m->msg_reader = new (m->allocated_msg_reader) capnp::FlatArrayMessageReader({});
-    messages_[socket] = m;
-    services_[name] = m;
+    messages_.push_back(m);
+    sockets_[socket] = m;
+    services_[m->name] = m->idx;
   }
+  ready_.reserve(messages_.size());
+}
+
+void SubMaster::receive(SubMessage *m, Message *msg) {
+  m->msg_reader->~FlatArrayMessageReader();
+  capnp::ReaderOptions options;
+  options.traversalLimitInWords = kj::maxValue; // Don't limit
+  m->msg_reader = new (m->allocated_msg_reader) capnp::FlatArrayMessageReader(m->aligned_buf.align(msg), options);
+  delete msg;
+  m->event = m->msg_reader->getRoot<cereal::Event>();
 }
 
 void SubMaster::update(int timeout) {
-  for (auto &kv : messages_) kv.second->updated = false;
+  for (auto m : messages_) m->updated = false;
 
-  auto sockets = poller_->poll(timeout);
+  poller_->poll(timeout, ready_);
   uint64_t current_time = nanos_since_boot();
 
-  std::vector<std::pair<std::string, cereal::Event::Reader>> messages;
+  if (++frame == UINT64_MAX) frame = 1;
 
-  for (auto s : sockets) {
+  for (auto s : ready_) {
+    SubMessage *m = sockets_.at(s);
     Message *msg = s->receive(true);
     if (msg == nullptr) continue;
 
-    SubMessage *m = messages_.at(s);
-
-    m->msg_reader->~FlatArrayMessageReader();
-    capnp::ReaderOptions options;
-    options.traversalLimitInWords = kj::maxValue; // Don't limit
-    m->msg_reader = new (m->allocated_msg_reader) capnp::FlatArrayMessageReader(m->aligned_buf.align(msg), options);
-    delete msg;
-    messages.push_back({m->name, m->msg_reader->getRoot<cereal::Event>()});
+    receive(m, msg);
+    if (on_message_) {
+      on_message_(m->idx, m->event);
+      // the rest of the queue, sm[idx] is left with the newest
+      while ((msg = s->receive(true)) != nullptr) {
+        receive(m, msg);
+        on_message_(m->idx, m->event);
+      }
+    }
+    set_updated(m, current_time);
   }
 
-  update_msgs(current_time, messages);
+  update_alive(current_time);
 }
 
-void SubMaster::update_msgs(uint64_t current_time, const std::vector<std::pair<std::string, cereal::Event::Reader>> &messages){
+void SubMaster::update_msgs(uint64_t current_time, const std::vector<std::pair<const char *, cereal::Event::Reader>> &messages){
   if (++frame == UINT64_MAX) frame = 1;
 
   for(auto &kv : messages) {
@@ -110,18 +127,25 @@ void SubMaster::update_msgs(uint64_t current_time, const std::vector<std::pair<s
     if (m_find == services_.end()){
       continue;
     }
-    SubMessage *m = m_find->second;
+    SubMessage *m = messages_[m_find->second];
     m->event = kv.second;
-    m->updated = true;
-    m->rcv_time = current_time;
-    m->rcv_frame = frame;
-    m->valid = m->event.getValid();
-    if (SIMULATION) m->alive = true;
+    set_updated(m, current_time);
   }
 
+  update_alive(current_time);
+}
+
+void SubMaster::set_updated(SubMessage *m, uint64_t current_time) {
+  m->updated = true;
+  m->rcv_time = current_time;
+  m->rcv_frame = frame;
+  m->valid = m->event.getValid();
+  if (SIMULATION) m->alive = true;
+}
+
+void SubMaster::update_alive(uint64_t current_time) {
   if (!SIMULATION) {
-    for (auto &kv : messages_) {
-      SubMessage *m = kv.second;
+    for (auto m : messages_) {
       m->alive = (m->freq <= (1e-5) || ((current_time - m->rcv_time) * (1e-9)) < (10.0 / m->freq));
     }
   }
@@ -129,8 +153,7 @@ void SubMaster::update_msgs(uint64_t current_time, const std::vector<std::pair<s
 
 bool SubMaster::all_(const std::vector<const char *> &service_list, bool valid, bool alive) {
   int found = 0;
-  for (auto &kv : messages_) {
-    SubMessage *m = kv.second;
+  for (auto m : messages_) {
     if (service_list.size() == 0 || inList(service_list, m->name.c_str())) {
       found += (!valid || m->valid) && (!alive || (m->alive || m->ignore_alive));
     }
@@ -140,45 +163,48 @@ bool SubMaster::all_(const std::vector<const char *> &service_list, bool valid,
 
 void SubMaster::drain() {
   while (true) {
-    auto polls = poller_->poll(0);
-    if (polls.size() == 0)
+    poller_->poll(0, ready_);
+    if (ready_.size() == 0)
       break;
 
-    for (auto sock : polls) {
+    for (auto sock : ready_) {
       Message *msg = sock->receive(true);
       delete msg;
     }
   }
 }
 
-bool SubMaster::updated(const char *name) const {
-  return services_.at(name)->updated;
+int SubMaster::index(const char *name) const {
+  return services_.at(name);
+}
+
+bool SubMaster::updated(int idx) const {
+  return messages_[idx]->updated;
 }
 
-bool SubMaster::alive(const char *name) const {
-  return services_.at(name)->alive;
+bool SubMaster::alive(int idx) const {
+  return messages_[idx]->alive;
 }
 
-bool SubMaster::valid(const char *name) const {
-  return services_.at(name)->valid;
+bool SubMaster::valid(int idx) const {
+  return messages_[idx]->valid;
 }
 
-uint64_t SubMaster::rcv_frame(const char *name) const {
-  return services_.at(name)->rcv_frame;
+uint64_t SubMaster::rcv_frame(int idx) const {
+  return messages_[idx]->rcv_frame;
 }
 
-uint64_t SubMaster::rcv_time(const char *name) const {
-  return services_.at(name)->rcv_time;
+uint64_t SubMaster::rcv_time(int idx) const {
+  return messages_[idx]->rcv_time;
 }
 
-cereal::Event::Reader &SubMaster::operator[](const char *name) const {
-  return services_.at(name)->event;
+cereal::Event::Reader &SubMaster::operator[](int idx) const {
+  return messages_[idx]->event;
 };
 
 SubMaster::~SubMaster() {
   delete poller_;
-  for (auto &kv : messages_) {
-    SubMessage *m = kv.second;
+  for (auto m : messages_) {
     m->msg_reader->~FlatArrayMessageReader();
     free(m->allocated_msg_reader);
     delete m->socket;
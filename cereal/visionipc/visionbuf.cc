@@ -41,9 +41,15 @@ void VisionBuf::init_yuv(size_t init_width, size_t init_height){
 
 
 uint64_t VisionBuf::get_frame_id() {
-  return *frame_id;
+  return meta->frame_id;
 }
 
 void VisionBuf::set_frame_id(uint64_t id) {
-  *frame_id = id;
+  meta->frame_id = id;
+}
+
+bool VisionBuf::is_valid() {
+  // reads of the frame before this can't move past the check
+  std::atomic_thread_fence(std::memory_order_acquire);
+  return meta->generation.load(std::memory_order_relaxed) == generation;
 }
\ No newline at end of file
@@ -1,4 +1,6 @@
 #pragma once
+#include <atomic>
+
 #include "visionipc.h"
 
 #define CL_USE_DEPRECATED_OPENCL_1_2_APIS
@@ -22,12 +24,23 @@ enum VisionStreamType {
   VISION_STREAM_MAX,
 };
 
+// Shared between the server and its clients, in the buffer after the frame
+struct VisionBufMeta {
+  uint64_t frame_id;
+  std::atomic<uint32_t> readers;     // references held by clients
+  std::atomic<uint64_t> generation;  // odd while the server writes a new frame
+};
+static_assert(std::atomic<uint32_t>::is_always_lock_free && std::atomic<uint64_t>::is_always_lock_free);
+
+// offset of the VisionBufMeta after a frame of len bytes
+inline size_t visionbuf_meta_offset(size_t len) { return (len + 63) & ~(size_t)63; }
+
 class VisionBuf {
  public:
   size_t len = 0;
   size_t mmap_len = 0;
   void * addr = nullptr;
-  uint64_t *frame_id;
+  VisionBufMeta *meta = nullptr;
   int fd = 0;
 
   bool rgb = false;
@@ -44,6 +57,7 @@ class VisionBuf {
   uint64_t server_id = 0;
   size_t idx = 0;
   VisionStreamType type;
+  uint64_t generation = 0;  // generation of the frame the client received
 
   // OpenCL
   cl_mem buf_cl = nullptr;
@@ -62,6 +76,9 @@ class VisionBuf {
 
   void set_frame_id(uint64_t id);
   uint64_t get_frame_id();
+
+  // true while the frame the client received hasn't been overwritten
+  bool is_valid();
 };
 
 void visionbuf_compute_aligned_width_and_height(int width, int height, int *aligned_w, int *aligned_h);
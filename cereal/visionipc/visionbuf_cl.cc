@@ -34,9 +34,9 @@ static void *malloc_with_fd(size_t len, int *fd) {
 
 void VisionBuf::allocate(size_t length) {
   this->len = length;
-  this->mmap_len = this->len;
-  this->addr = malloc_with_fd(this->len, &this->fd);
-  this->frame_id = (uint64_t*)((uint8_t*)this->addr + this->len);
+  this->mmap_len = visionbuf_meta_offset(this->len) + sizeof(VisionBufMeta);
+  this->addr = malloc_with_fd(this->mmap_len, &this->fd);
+  this->meta = (VisionBufMeta*)((uint8_t*)this->addr + visionbuf_meta_offset(this->len));
 }
 
 void VisionBuf::init_cl(cl_device_id device_id, cl_context ctx){
@@ -55,7 +55,7 @@ void VisionBuf::import(){
   this->addr = mmap(NULL, this->mmap_len, PROT_READ | PROT_WRITE, MAP_SHARED, this->fd, 0);
   assert(this->addr != MAP_FAILED);
 
-  this->frame_id = (uint64_t*)((uint8_t*)this->addr + this->len);
+  this->meta = (VisionBufMeta*)((uint8_t*)this->addr + visionbuf_meta_offset(this->len));
 }
 
 
@@ -86,7 +86,7 @@ int VisionBuf::free() {
     if (err != 0) return err;
   }
 
-  err = munmap(this->addr, this->len);
+  err = munmap(this->addr, this->mmap_len);
   if (err != 0) return err;
 
   err = close(this->fd);
@@ -53,7 +53,7 @@ void VisionBuf::allocate(size_t length) {
   ion_init();
 
   struct ion_allocation_data ion_alloc = {0};
-  ion_alloc.len = length + PADDING_CL + sizeof(uint64_t);
+  ion_alloc.len = visionbuf_meta_offset(length + PADDING_CL) + sizeof(VisionBufMeta);
   ion_alloc.align = 4096;
   ion_alloc.heap_id_mask = 1 << ION_IOMMU_HEAP_ID;
   ion_alloc.flags = ION_FLAG_CACHED;
@@ -78,7 +78,7 @@ void VisionBuf::allocate(size_t length) {
   this->addr = mmap_addr;
   this->handle = ion_alloc.handle;
   this->fd = ion_fd_data.fd;
-  this->frame_id = (uint64_t*)((uint8_t*)this->addr + this->len + PADDING_CL);
+  this->meta = (VisionBufMeta*)((uint8_t*)this->addr + visionbuf_meta_offset(this->len + PADDING_CL));
 }
 
 void VisionBuf::import(){
@@ -97,7 +97,7 @@ void VisionBuf::import(){
   this->addr = mmap(NULL, this->mmap_len, PROT_READ | PROT_WRITE, MAP_SHARED, this->fd, 0);
   assert(this->addr != MAP_FAILED);
 
-  this->frame_id = (uint64_t*)((uint8_t*)this->addr + this->len + PADDING_CL);
+  this->meta = (VisionBufMeta*)((uint8_t*)this->addr + visionbuf_meta_offset(this->len + PADDING_CL));
 }
 
 void VisionBuf::init_cl(cl_device_id device_id, cl_context ctx) {
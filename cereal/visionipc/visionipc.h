@@ -14,5 +14,6 @@ struct VisionIpcBufExtra {
 struct VisionIpcPacket {
   uint64_t server_id;
   size_t idx;
+  uint64_t generation;
   struct VisionIpcBufExtra extra;
 };
@@ -21,6 +21,7 @@ bool VisionIpcClient::connect(bool blocking){
   connected = false;
 
   // Cleanup old buffers on reconnect
+  release_all();
   for (size_t i = 0; i < num_buffers; i++){
     if (buffers[i].free() != 0) {
       LOGE("Failed to free buffer %zu", i);
@@ -102,6 +103,22 @@ VisionBuf * VisionIpcClient::recv(VisionIpcBufExtra * extra, const int timeout_m
     return nullptr;
   }
 
+  // Take a reference before checking the frame is still there, see
+  // VisionIpcServer::get_buffer
+  acquire(buf);
+  if (buf->meta->generation.load() != packet->generation) {
+    release(buf);
+    stale_reads++;
+    delete r;
+    return nullptr;
+  }
+  buf->generation = packet->generation;
+
+  if (last_recv) {
+    release(last_recv);
+  }
+  last_recv = buf;
+
   if (extra) {
     *extra = packet->extra;
   }
@@ -114,9 +131,30 @@ VisionBuf * VisionIpcClient::recv(VisionIpcBufExtra * extra, const int timeout_m
   return buf;
 }
 
+void VisionIpcClient::acquire(VisionBuf * buf){
+  held[buf->idx]++;
+  buf->meta->readers++;
+}
 
+void VisionIpcClient::release(VisionBuf * buf){
+  assert(held[buf->idx] > 0);
+  held[buf->idx]--;
+  buf->meta->readers--;
+}
+
+// Drops every reference this client holds, before its buffers are unmapped
+void VisionIpcClient::release_all(){
+  for (size_t i = 0; i < num_buffers; i++){
+    int n = held[i].exchange(0);
+    if (n > 0) {
+      buffers[i].meta->readers -= n;
+    }
+  }
+  last_recv = nullptr;
+}
 
 VisionIpcClient::~VisionIpcClient(){
+  release_all();
   for (size_t i = 0; i < num_buffers; i++){
     if (buffers[i].free() != 0) {
       LOGE("Failed to free buffer %zu", i);
@@ -1,4 +1,5 @@
 #pragma once
+#include <atomic>
 #include <vector>
 #include <string>
 #include <unistd.h>
@@ -20,14 +21,27 @@ private:
   cl_context ctx = nullptr;
 
   void init_msgq(bool conflate);
+  void release_all();
+
+  VisionBuf *last_recv = nullptr;
+  std::atomic<int> held[VISIONIPC_MAX_FDS] = {};
 
 public:
   bool connected = false;
   int num_buffers = 0;
   VisionBuf buffers[VISIONIPC_MAX_FDS];
+  // frames that were overwritten before they could be received
+  uint64_t stale_reads = 0;
+
   VisionIpcClient(std::string name, VisionStreamType type, bool conflate, cl_device_id device_id=nullptr, cl_context ctx=nullptr);
   ~VisionIpcClient();
+  // The returned buffer is held until the next recv
   VisionBuf * recv(VisionIpcBufExtra * extra=nullptr, const int timeout_ms=100);
   bool connect(bool blocking=true);
   bool is_connected() { return connected; }
+
+  // Hold a received buffer past the next recv, so the server doesn't reuse it
+  // until it's released. Thread safe.
+  void acquire(VisionBuf * buf);
+  void release(VisionBuf * buf);
 };
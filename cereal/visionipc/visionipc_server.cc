@@ -60,6 +60,8 @@ void VisionIpcServer::create_buffers(VisionStreamType type, size_t num_buffers,
   }
 
   cur_idx[type] = 0;
+  skipped[type] = 0;
+  overwritten[type] = 0;
 
   // Create msgq publisher for each of the `name` + type combos
   // TODO: compute port number directly if using zmq
@@ -138,10 +140,27 @@ void VisionIpcServer::listener(){
 
 
 VisionBuf * VisionIpcServer::get_buffer(VisionStreamType type){
-  // Do we want to keep track if the buffer has been sent out yet and warn user?
   assert(buffers.count(type));
-  auto b = buffers[type];
-  return b[cur_idx[type]++ % b.size()];
+  auto &b = buffers[type];
+
+  // Claim a buffer by making its generation odd before checking for readers.
+  // A client takes a reference before checking the generation, so either we
+  // see its reference or it sees the buffer is being rewritten.
+  for (size_t i = 0; i < b.size(); i++) {
+    VisionBuf *buf = b[cur_idx[type]++ % b.size()];
+    uint64_t generation = buf->meta->generation.fetch_or(1);
+    if (buf->meta->readers.load() == 0) {
+      return buf;
+    }
+    buf->meta->generation.store(generation);
+    skipped[type]++;
+  }
+
+  // A client that died holding a buffer never lets go of it, so don't wait
+  VisionBuf *buf = b[cur_idx[type]++ % b.size()];
+  buf->meta->generation.fetch_or(1);
+  overwritten[type]++;
+  return buf;
 }
 
 void VisionIpcServer::send(VisionBuf * buf, VisionIpcBufExtra * extra, bool sync){
@@ -153,10 +172,17 @@ void VisionIpcServer::send(VisionBuf * buf, VisionIpcBufExtra * extra, bool sync
   assert(buffers.count(buf->type));
   assert(buf->idx < buffers[buf->type].size());
 
+  // Publish the new frame
+  uint64_t generation = buf->meta->generation.load();
+  if (generation & 1) {
+    generation = ++buf->meta->generation;
+  }
+
   // Send over correct msgq socket
   VisionIpcPacket packet = {0};
   packet.server_id = server_id;
   packet.idx = buf->idx;
+  packet.generation = generation;
   packet.extra = *extra;
 
   sockets[buf->type]->send((char*)&packet, sizeof(packet));
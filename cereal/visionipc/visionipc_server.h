@@ -34,9 +34,16 @@ class VisionIpcServer {
   VisionIpcServer(std::string name, cl_device_id device_id=nullptr, cl_context ctx=nullptr);
   ~VisionIpcServer();
 
+  // Next buffer to write a frame into. Buffers clients still hold are skipped,
+  // if all of them are held the next one is overwritten anyway.
   VisionBuf * get_buffer(VisionStreamType type);
 
   void create_buffers(VisionStreamType type, size_t num_buffers, bool rgb, size_t width, size_t height);
   void send(VisionBuf * buf, VisionIpcBufExtra * extra, bool sync=true);
   void start_listener();
+
+  // buffers skipped because a client held them, and held buffers overwritten
+  // because every buffer was held
+  std::map<VisionStreamType, std::atomic<uint64_t> > skipped;
+  std::map<VisionStreamType, std::atomic<uint64_t> > overwritten;
 };
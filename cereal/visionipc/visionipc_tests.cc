@@ -1,5 +1,10 @@
 #include <thread>
 #include <chrono>
+#include <cstring>
+#include <deque>
+
+#include <sys/wait.h>
+#include <unistd.h>
 
 #include "catch2/catch.hpp"
 #include "visionipc_server.h"
@@ -135,3 +140,106 @@ TEST_CASE("Test conflate"){
   recv_buf = client.recv(&extra_recv);
   REQUIRE(recv_buf == nullptr);
 }
+
+// Reads frames slowly, holding a few past the next recv like loggerd does,
+// and checks that every frame still valid after reading it wasn't torn.
+static int stress_reader(int ready_fd, uint32_t last_frame_id){
+  VisionIpcClient client = VisionIpcClient("camerad", VISION_STREAM_ROAD, false);
+  client.connect();
+  write(ready_fd, "r", 1);
+  close(ready_fd);
+
+  auto check = [&](VisionBuf &buf, uint32_t frame_id) {
+    const uint8_t *data = (const uint8_t *)buf.addr;
+    bool intact = true;
+    for (size_t i = 0; i < buf.len; i++) {
+      intact = intact && data[i] == (uint8_t)frame_id;
+    }
+    return buf.is_valid() && !intact;
+  };
+
+  std::deque<std::pair<VisionBuf, uint32_t>> held;
+  int torn = 0, received = 0, idle = 0;
+  while (idle < 20) {
+    uint64_t stale = client.stale_reads;
+    VisionIpcBufExtra extra = {0};
+    VisionBuf *buf = client.recv(&extra);
+    if (buf == nullptr) {
+      if (client.stale_reads == stale) idle++;
+      continue;
+    }
+    idle = 0;
+    received++;
+
+    // a copy keeps the generation it was received with
+    client.acquire(buf);
+    held.push_back({*buf, extra.frame_id});
+    std::this_thread::sleep_for(std::chrono::microseconds(rand() % 2000));
+    if (held.size() > 2) {
+      torn += check(held.front().first, held.front().second);
+      client.release(&client.buffers[held.front().first.idx]);
+      held.pop_front();
+    }
+    if (extra.frame_id == last_frame_id) break;
+  }
+  for (auto &[buf, frame_id] : held) {
+    torn += check(buf, frame_id);
+    client.release(&client.buffers[buf.idx]);
+  }
+  printf("reader %d: %d frames, %lu stale, %d torn\n", getpid(), received, client.stale_reads, torn);
+  fflush(stdout);
+  return received > 0 && torn == 0 ? 0 : 1;
+}
+
+TEST_CASE("Refcounted buffers with readers in other processes"){
+  const int num_readers = 3, num_buffers = 4;
+  const uint32_t num_frames = 2000;
+
+  // readers connect while the server starts and say when they're ready
+  fflush(stdout);
+  int ready[2];
+  REQUIRE(pipe(ready) == 0);
+  std::vector<pid_t> readers;
+  for (int i = 0; i < num_readers; i++) {
+    pid_t pid = fork();
+    REQUIRE(pid >= 0);
+    if (pid == 0) {
+      close(ready[0]);
+      srand(getpid());
+      _exit(stress_reader(ready[1], num_frames));
+    }
+    readers.push_back(pid);
+  }
+  close(ready[1]);
+
+  VisionIpcServer server("camerad");
+  server.create_buffers(VISION_STREAM_ROAD, num_buffers, false, 64, 64);
+  server.start_listener();
+  for (int i = 0; i < num_readers; i++) {
+    char c;
+    REQUIRE(read(ready[0], &c, 1) == 1);
+  }
+  close(ready[0]);
+  zmq_sleep();
+
+  for (uint32_t frame_id = 1; frame_id <= num_frames; frame_id++) {
+    VisionBuf *buf = server.get_buffer(VISION_STREAM_ROAD);
+    memset(buf->addr, (uint8_t)frame_id, buf->len);
+    buf->set_frame_id(frame_id);
+
+    VisionIpcBufExtra extra = {0};
+    extra.frame_id = frame_id;
+    server.send(buf, &extra);
+    std::this_thread::sleep_for(std::chrono::microseconds(500));
+  }
+
+  for (pid_t pid : readers) {
+    int status = 0;
+    REQUIRE(waitpid(pid, &status, 0) == pid);
+    REQUIRE(WIFEXITED(status));
+    REQUIRE(WEXITSTATUS(status) == 0);
+  }
+
+  // the readers are slower than the server, so it had to skip buffers they held
+  REQUIRE(server.skipped[VISION_STREAM_ROAD] > 0);
+}
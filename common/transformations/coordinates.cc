@@ -63,6 +63,50 @@ Geodetic ecef2geodetic(ECEF e){
   return to_degrees({lat, lon, h});
 }
 
+void geodetic2ecef_batch(const double *geodetic, double *ecef, size_t n){
+  // locals so the constants aren't reloaded after every store
+  const double a_ = a, esq_ = esq;
+  for (size_t i = 0; i < n; i++) {
+    const double lat = DEG2RAD(geodetic[3*i]);
+    const double lon = DEG2RAD(geodetic[3*i + 1]);
+    const double alt = geodetic[3*i + 2];
+    const double sin_lat = sin(lat), cos_lat = cos(lat);
+    const double n_lat = a_ / sqrt(1.0 - esq_ * sin_lat * sin_lat);
+    ecef[3*i] = (n_lat + alt) * cos_lat * cos(lon);
+    ecef[3*i + 1] = (n_lat + alt) * cos_lat * sin(lon);
+    ecef[3*i + 2] = (n_lat * (1.0 - esq_) + alt) * sin_lat;
+  }
+}
+
+void ecef2geodetic_batch(const double *ecef, double *geodetic, size_t n){
+  // same as ecef2geodetic with the powers multiplied out
+  const double a_ = a, b_ = b, esq_ = esq, e1sq_ = e1sq;
+  const double Esq = a_ * a_ - b_ * b_;
+  for (size_t i = 0; i < n; i++) {
+    const double x = ecef[3*i];
+    const double y = ecef[3*i + 1];
+    const double z = ecef[3*i + 2];
+
+    const double r = sqrt(x * x + y * y);
+    const double F = 54 * b_ * b_ * z * z;
+    const double G = r * r + (1 - esq_) * z * z - esq_ * Esq;
+    const double C = (esq_ * esq_ * F * r * r) / (G * G * G);
+    const double S = cbrt(1 + C + sqrt(C * C + 2 * C));
+    const double S1 = S + 1 / S + 1;
+    const double P = F / (3 * S1 * S1 * G * G);
+    const double Q = sqrt(1 + 2 * esq_ * esq_ * P);
+    const double r_0 = -(P * esq_ * r) / (1 + Q) + sqrt(0.5 * a_ * a_*(1 + 1.0 / Q) - P * (1 - esq_) * z * z / (Q * (1 + Q)) - 0.5 * P * r * r);
+    const double dr = r - esq_ * r_0;
+    const double U = sqrt(dr * dr + z * z);
+    const double V = sqrt(dr * dr + (1 - esq_) * z * z);
+    const double Z_0 = b_ * b_ * z / (a_ * V);
+
+    geodetic[3*i] = RAD2DEG(atan((z + e1sq_ * Z_0) / r));
+    geodetic[3*i + 1] = RAD2DEG(atan2(y, x));
+    geodetic[3*i + 2] = U * (1 - b_ * b_ / (a_ * V));
+  }
+}
+
 LocalCoord::LocalCoord(Geodetic g, ECEF e){
   init_ecef <<  e.x, e.y, e.z;
 
@@ -100,3 +144,25 @@ Geodetic LocalCoord::ned2geodetic(NED n){
   ECEF e = ned2ecef(n);
   return ::ecef2geodetic(e);
 }
+
+typedef Eigen::Map<Eigen::Matrix<double, Eigen::Dynamic, 3, Eigen::RowMajor>> Points;
+typedef Eigen::Map<const Eigen::Matrix<double, Eigen::Dynamic, 3, Eigen::RowMajor>> ConstPoints;
+
+void LocalCoord::ecef2ned_batch(const double *ecef, double *ned, size_t n) {
+  // the product is evaluated into a temporary, so in place works too
+  Points(ned, n, 3) = (ConstPoints(ecef, n, 3).rowwise() - init_ecef.transpose()) * ecef2ned_matrix.transpose();
+}
+
+void LocalCoord::ned2ecef_batch(const double *ned, double *ecef, size_t n) {
+  Points(ecef, n, 3) = (ConstPoints(ned, n, 3) * ned2ecef_matrix.transpose()).rowwise() + init_ecef.transpose();
+}
+
+void LocalCoord::geodetic2ned_batch(const double *geodetic, double *ned, size_t n) {
+  ::geodetic2ecef_batch(geodetic, ned, n);
+  ecef2ned_batch(ned, ned, n);
+}
+
+void LocalCoord::ned2geodetic_batch(const double *ned, double *geodetic, size_t n) {
+  ned2ecef_batch(ned, geodetic, n);
+  ::ecef2geodetic_batch(geodetic, geodetic, n);
+}
@@ -25,6 +25,11 @@ struct Geodetic {
 ECEF geodetic2ecef(Geodetic g);
 Geodetic ecef2geodetic(ECEF e);
 
+// Batch versions over n points stored as contiguous rows of 3 doubles, geodetic
+// in degrees. Input and output may be the same buffer.
+void geodetic2ecef_batch(const double *geodetic, double *ecef, size_t n);
+void ecef2geodetic_batch(const double *ecef, double *geodetic, size_t n);
+
 class LocalCoord {
 public:
   Eigen::Matrix3d ned2ecef_matrix;
@@ -38,4 +43,10 @@ public:
   ECEF ned2ecef(NED n);
   NED geodetic2ned(Geodetic g);
   Geodetic ned2geodetic(NED n);
+
+  // batch versions, see geodetic2ecef_batch
+  void ecef2ned_batch(const double *ecef, double *ned, size_t n);
+  void ned2ecef_batch(const double *ned, double *ecef, size_t n);
+  void geodetic2ned_batch(const double *geodetic, double *ned, size_t n);
+  void ned2geodetic_batch(const double *ned, double *geodetic, size_t n);
 };
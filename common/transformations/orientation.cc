@@ -52,6 +52,69 @@ Eigen::Vector3d rot2euler(const Eigen::Matrix3d &rot){
   return quat2euler(rot2quat(rot));
 }
 
+typedef Eigen::Matrix<double, 3, 3, Eigen::RowMajor> RowMatrix3d;
+
+static inline Eigen::Quaterniond euler2quat_fast(double roll, double pitch, double yaw){
+  // the product of the three axis rotations in euler2quat written out
+  const double cr = cos(roll / 2), sr = sin(roll / 2);
+  const double cp = cos(pitch / 2), sp = sin(pitch / 2);
+  const double cy = cos(yaw / 2), sy = sin(yaw / 2);
+  return ensure_unique(Eigen::Quaterniond(cy * cp * cr + sy * sp * sr,
+                                          cy * cp * sr - sy * sp * cr,
+                                          cy * sp * cr + sy * cp * sr,
+                                          sy * cp * cr - cy * sp * sr));
+}
+
+void euler2quat_batch(const double *euler, double *quat, size_t n){
+  for (size_t i = 0; i < n; i++) {
+    Eigen::Quaterniond q = euler2quat_fast(euler[3*i], euler[3*i + 1], euler[3*i + 2]);
+    quat[4*i] = q.w();
+    quat[4*i + 1] = q.x();
+    quat[4*i + 2] = q.y();
+    quat[4*i + 3] = q.z();
+  }
+}
+
+void quat2euler_batch(const double *quat, double *euler, size_t n){
+  for (size_t i = 0; i < n; i++) {
+    Eigen::Vector3d e = quat2euler(Eigen::Quaterniond(quat[4*i], quat[4*i + 1], quat[4*i + 2], quat[4*i + 3]));
+    euler[3*i] = e(0);
+    euler[3*i + 1] = e(1);
+    euler[3*i + 2] = e(2);
+  }
+}
+
+void quat2rot_batch(const double *quat, double *rot, size_t n){
+  for (size_t i = 0; i < n; i++) {
+    Eigen::Map<RowMatrix3d>(rot + 9*i) = Eigen::Quaterniond(quat[4*i], quat[4*i + 1], quat[4*i + 2], quat[4*i + 3]).toRotationMatrix();
+  }
+}
+
+void rot2quat_batch(const double *rot, double *quat, size_t n){
+  for (size_t i = 0; i < n; i++) {
+    Eigen::Quaterniond q = rot2quat(Eigen::Map<const RowMatrix3d>(rot + 9*i));
+    quat[4*i] = q.w();
+    quat[4*i + 1] = q.x();
+    quat[4*i + 2] = q.y();
+    quat[4*i + 3] = q.z();
+  }
+}
+
+void euler2rot_batch(const double *euler, double *rot, size_t n){
+  for (size_t i = 0; i < n; i++) {
+    Eigen::Map<RowMatrix3d>(rot + 9*i) = euler2quat_fast(euler[3*i], euler[3*i + 1], euler[3*i + 2]).toRotationMatrix();
+  }
+}
+
+void rot2euler_batch(const double *rot, double *euler, size_t n){
+  for (size_t i = 0; i < n; i++) {
+    Eigen::Vector3d e = quat2euler(rot2quat(Eigen::Map<const RowMatrix3d>(rot + 9*i)));
+    euler[3*i] = e(0);
+    euler[3*i + 1] = e(1);
+    euler[3*i + 2] = e(2);
+  }
+}
+
 Eigen::Matrix3d rot_matrix(double roll, double pitch, double yaw){
   return euler2rot({roll, pitch, yaw});
 }
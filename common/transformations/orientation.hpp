@@ -15,3 +15,12 @@ Eigen::Matrix3d rot_matrix(double roll, double pitch, double yaw);
 Eigen::Matrix3d rot(Eigen::Vector3d axis, double angle);
 Eigen::Vector3d ecef_euler_from_ned(ECEF ecef_init, Eigen::Vector3d ned_pose);
 Eigen::Vector3d ned_euler_from_ecef(ECEF ecef_init, Eigen::Vector3d ecef_pose);
+
+// Batch versions over n contiguous eulers (3 doubles), quaternions (4, w first)
+// or row major rotation matrices (9).
+void euler2quat_batch(const double *euler, double *quat, size_t n);
+void quat2euler_batch(const double *quat, double *euler, size_t n);
+void quat2rot_batch(const double *quat, double *rot, size_t n);
+void rot2quat_batch(const double *rot, double *quat, size_t n);
+void euler2rot_batch(const double *euler, double *rot, size_t n);
+void rot2euler_batch(const double *rot, double *euler, size_t n);
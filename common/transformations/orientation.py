@@ -2,13 +2,13 @@
 import numpy as np
 
 from common.transformations.transformations import (ecef_euler_from_ned_single,
-                                                    euler2quat_single,
-                                                    euler2rot_single,
+                                                    euler2quat_batch,
+                                                    euler2rot_batch,
                                                     ned_euler_from_ecef_single,
-                                                    quat2euler_single,
-                                                    quat2rot_single,
-                                                    rot2euler_single,
-                                                    rot2quat_single)
+                                                    quat2euler_batch,
+                                                    quat2rot_batch,
+                                                    rot2euler_batch,
+                                                    rot2quat_batch)
 
 
 def numpy_wrap(function, input_shape, output_shape):
@@ -33,12 +33,27 @@ def numpy_wrap(function, input_shape, output_shape):
   return f
 
 
-euler2quat = numpy_wrap(euler2quat_single, (3,), (4,))
-quat2euler = numpy_wrap(quat2euler_single, (4,), (3,))
-quat2rot = numpy_wrap(quat2rot_single, (4,), (3, 3))
-rot2quat = numpy_wrap(rot2quat_single, (3, 3), (4,))
-euler2rot = numpy_wrap(euler2rot_single, (3,), (3, 3))
-rot2euler = numpy_wrap(rot2euler_single, (3, 3), (3,))
+def numpy_batch_wrap(function, input_shape, output_shape):
+  """Like numpy_wrap, for a function that converts an array of inputs in one call"""
+  def f(*inps):
+    *args, inp = inps
+    inp = np.asarray(inp, dtype=np.float64)
+
+    if inp.ndim == len(input_shape):
+      out_shape = output_shape
+    else:
+      out_shape = (inp.shape[0],) + output_shape
+
+    return function(*args, inp.reshape((-1,) + input_shape)).reshape(out_shape)
+  return f
+
+
+euler2quat = numpy_batch_wrap(euler2quat_batch, (3,), (4,))
+quat2euler = numpy_batch_wrap(quat2euler_batch, (4,), (3,))
+quat2rot = numpy_batch_wrap(quat2rot_batch, (4,), (3, 3))
+rot2quat = numpy_batch_wrap(rot2quat_batch, (3, 3), (4,))
+euler2rot = numpy_batch_wrap(euler2rot_batch, (3,), (3, 3))
+rot2euler = numpy_batch_wrap(rot2euler_batch, (3, 3), (3,))
 ecef_euler_from_ned = numpy_wrap(ecef_euler_from_ned_single, (3,), (3,))
 ned_euler_from_ecef = numpy_wrap(ned_euler_from_ecef_single, (3,), (3,))
 
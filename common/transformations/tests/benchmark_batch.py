@@ -0,0 +1,38 @@
+#!/usr/bin/env python3
+# Points per second of the batched coordinate and orientation conversions,
+# compared to calling them one point at a time.
+import argparse
+import time
+
+import numpy as np
+
+import common.transformations.coordinates as coord
+import common.transformations.orientation as orient
+from common.transformations.tests.test_batch import random_euler, random_geodetic
+
+
+if __name__ == "__main__":
+  parser = argparse.ArgumentParser()
+  parser.add_argument("-n", type=int, default=1000000, help="points per batched call")
+  parser.add_argument("--single", type=int, default=10000, help="points converted one at a time")
+  args = parser.parse_args()
+
+  np.random.seed(0)
+  geodetic = random_geodetic(args.n)
+  euler = random_euler(args.n)
+  lc = coord.LocalCoord.from_geodetic([37.7749, -122.4194, 10.])
+
+  for name, f, inputs in [("geodetic2ecef", coord.geodetic2ecef, geodetic),
+                          ("geodetic2ned", lc.geodetic2ned, geodetic),
+                          ("euler2quat", orient.euler2quat, euler),
+                          ("euler2rot", orient.euler2rot, euler)]:
+    t = time.monotonic()
+    f(inputs)
+    batch = args.n / (time.monotonic() - t)
+
+    t = time.monotonic()
+    for x in inputs[:args.single]:
+      f(x)
+    single = args.single / (time.monotonic() - t)
+
+    print(f"{name:14} {batch / 1e6:6.2f}M points/s batched, {single / 1e6:6.3f}M points/s one at a time, {batch / single:5.1f}x")
@@ -0,0 +1,82 @@
+import unittest
+import numpy as np
+
+import common.transformations.coordinates as coord
+import common.transformations.orientation as orient
+from common.transformations.transformations import (LocalCoord,
+                                                    ecef2geodetic_single,
+                                                    euler2quat_single,
+                                                    euler2rot_single,
+                                                    geodetic2ecef_single,
+                                                    quat2euler_single,
+                                                    quat2rot_single,
+                                                    rot2euler_single,
+                                                    rot2quat_single)
+
+N = 1000
+
+
+def random_geodetic(n):
+  return np.column_stack([np.random.uniform(-89, 89, n), np.random.uniform(-180, 180, n), np.random.uniform(-100, 3000, n)])
+
+
+def random_euler(n):
+  return np.column_stack([np.random.uniform(-np.pi, np.pi, n), np.random.uniform(-np.pi/2, np.pi/2, n), np.random.uniform(-np.pi, np.pi, n)])
+
+
+class TestBatchTransforms(unittest.TestCase):
+  def setUp(self):
+    np.random.seed(0)
+
+  def assert_matches_single(self, batch, single, inputs, atol):
+    out = batch(inputs)
+    self.assertEqual(out.shape[0], len(inputs))
+    expected = np.array([single(x) for x in inputs])
+    np.testing.assert_allclose(out, expected, rtol=0, atol=atol)
+
+  def test_coordinates(self):
+    geodetic = random_geodetic(N)
+    ecef = np.array([geodetic2ecef_single(g) for g in geodetic])
+    self.assert_matches_single(coord.geodetic2ecef, geodetic2ecef_single, geodetic, 1e-6)
+    self.assert_matches_single(coord.ecef2geodetic, ecef2geodetic_single, ecef, 1e-6)
+
+  def test_local_coord(self):
+    lc = coord.LocalCoord.from_geodetic([37.7749, -122.4194, 10.])
+    lc_single = LocalCoord.from_geodetic([37.7749, -122.4194, 10.])
+    geodetic = np.column_stack([np.random.uniform(37.5, 38, N), np.random.uniform(-122.6, -122.2, N), np.random.uniform(-10, 100, N)])
+    ecef = coord.geodetic2ecef(geodetic)
+    ned = lc.ecef2ned(ecef)
+
+    self.assert_matches_single(lc.ecef2ned, lc_single.ecef2ned_single, ecef, 1e-6)
+    self.assert_matches_single(lc.ned2ecef, lc_single.ned2ecef_single, ned, 1e-6)
+    self.assert_matches_single(lc.geodetic2ned, lc_single.geodetic2ned_single, geodetic, 1e-6)
+    self.assert_matches_single(lc.ned2geodetic, lc_single.ned2geodetic_single, ned, 1e-6)
+
+  def test_orientation(self):
+    euler = random_euler(N)
+    quat = np.array([euler2quat_single(e) for e in euler])
+    rot = np.array([quat2rot_single(q) for q in quat])
+
+    self.assert_matches_single(orient.euler2quat, euler2quat_single, euler, 1e-12)
+    self.assert_matches_single(orient.quat2euler, quat2euler_single, quat, 1e-12)
+    self.assert_matches_single(orient.quat2rot, quat2rot_single, quat, 1e-12)
+    self.assert_matches_single(orient.rot2quat, rot2quat_single, rot, 1e-12)
+    self.assert_matches_single(orient.euler2rot, euler2rot_single, euler, 1e-12)
+    self.assert_matches_single(orient.rot2euler, rot2euler_single, rot, 1e-12)
+
+  def test_shapes(self):
+    # a single input gives a single output, like the per point wrappers did
+    self.assertEqual(coord.geodetic2ecef([37., -122., 0.]).shape, (3,))
+    self.assertEqual(orient.euler2rot([0.1, 0.2, 0.3]).shape, (3, 3))
+    self.assertEqual(orient.rot2quat(np.eye(3)).shape, (4,))
+    self.assertEqual(orient.rot2quat(np.stack([np.eye(3)] * 5)).shape, (5, 4))
+    self.assertEqual(orient.quat2euler(np.zeros((0, 4))).shape, (0, 3))
+
+    # non contiguous and integer inputs are converted
+    geodetic = random_geodetic(10)
+    np.testing.assert_allclose(coord.geodetic2ecef(geodetic[::2]), coord.geodetic2ecef(geodetic)[::2])
+    np.testing.assert_allclose(orient.euler2quat([[0, 0, 0]]), [[1., 0, 0, 0]])
+
+
+if __name__ == "__main__":
+  unittest.main()
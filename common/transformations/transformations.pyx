@@ -15,6 +15,14 @@ from common.transformations.transformations cimport ned_euler_from_ecef as ned_e
 from common.transformations.transformations cimport geodetic2ecef as geodetic2ecef_c
 from common.transformations.transformations cimport ecef2geodetic as ecef2geodetic_c
 from common.transformations.transformations cimport LocalCoord_c
+from common.transformations.transformations cimport euler2quat_batch as euler2quat_batch_c
+from common.transformations.transformations cimport quat2euler_batch as quat2euler_batch_c
+from common.transformations.transformations cimport quat2rot_batch as quat2rot_batch_c
+from common.transformations.transformations cimport rot2quat_batch as rot2quat_batch_c
+from common.transformations.transformations cimport euler2rot_batch as euler2rot_batch_c
+from common.transformations.transformations cimport rot2euler_batch as rot2euler_batch_c
+from common.transformations.transformations cimport geodetic2ecef_batch as geodetic2ecef_batch_c
+from common.transformations.transformations cimport ecef2geodetic_batch as ecef2geodetic_batch_c
 
 
 import cython
@@ -54,6 +62,29 @@ cdef Geodetic list2geodetic(geodetic):
     g.alt = geodetic[2]
     return g
 
+ctypedef void (*batch_fn)(const double*, double*, size_t)
+
+cdef class BatchBuffers:
+    # flat views of a batch input, without a copy if it is already contiguous
+    # doubles, and of a new output array
+    cdef const double[::1] inp
+    cdef double[::1] out_flat
+    cdef object out
+    cdef size_t n
+
+    def __init__(self, inp, int in_size, tuple out_shape):
+        self.inp = np.ascontiguousarray(inp, dtype=np.double).reshape(-1)
+        assert self.inp.shape[0] % in_size == 0
+        self.n = self.inp.shape[0] // in_size
+        self.out = np.empty((self.n,) + out_shape)
+        self.out_flat = self.out.reshape(-1)
+
+cdef run_batch(batch_fn f, inp, int in_size, tuple out_shape):
+    cdef BatchBuffers b = BatchBuffers(inp, in_size, out_shape)
+    if b.n > 0:
+        f(&b.inp[0], &b.out_flat[0], b.n)
+    return b.out
+
 def euler2quat_single(euler):
     cdef Vector3 e = Vector3(euler[0], euler[1], euler[2])
     cdef Quaternion q = euler2quat_c(e)
@@ -111,6 +142,33 @@ def ecef2geodetic_single(ecef):
     cdef Geodetic g = ecef2geodetic_c(e)
     return [g.lat, g.lon, g.alt]
 
+# Batch versions take an array of N inputs and return an array of N outputs
+# from a single call into C++
+
+def euler2quat_batch(euler):
+    return run_batch(euler2quat_batch_c, euler, 3, (4,))
+
+def quat2euler_batch(quat):
+    return run_batch(quat2euler_batch_c, quat, 4, (3,))
+
+def quat2rot_batch(quat):
+    return run_batch(quat2rot_batch_c, quat, 4, (3, 3))
+
+def rot2quat_batch(rot):
+    return run_batch(rot2quat_batch_c, rot, 9, (4,))
+
+def euler2rot_batch(euler):
+    return run_batch(euler2rot_batch_c, euler, 3, (3, 3))
+
+def rot2euler_batch(rot):
+    return run_batch(rot2euler_batch_c, rot, 9, (3,))
+
+def geodetic2ecef_batch(geodetic):
+    return run_batch(geodetic2ecef_batch_c, geodetic, 3, (3,))
+
+def ecef2geodetic_batch(ecef):
+    return run_batch(ecef2geodetic_batch_c, ecef, 3, (3,))
+
 
 cdef class LocalCoord:
     cdef LocalCoord_c * lc
@@ -170,5 +228,33 @@ cdef class LocalCoord:
         cdef Geodetic g = self.lc.ned2geodetic(n)
         return [g.lat, g.lon, g.alt]
 
+    def ecef2ned_batch(self, ecef):
+        assert self.lc
+        cdef BatchBuffers b = BatchBuffers(ecef, 3, (3,))
+        if b.n > 0:
+            self.lc.ecef2ned_batch(&b.inp[0], &b.out_flat[0], b.n)
+        return b.out
+
+    def ned2ecef_batch(self, ned):
+        assert self.lc
+        cdef BatchBuffers b = BatchBuffers(ned, 3, (3,))
+        if b.n > 0:
+            self.lc.ned2ecef_batch(&b.inp[0], &b.out_flat[0], b.n)
+        return b.out
+
+    def geodetic2ned_batch(self, geodetic):
+        assert self.lc
+        cdef BatchBuffers b = BatchBuffers(geodetic, 3, (3,))
+        if b.n > 0:
+            self.lc.geodetic2ned_batch(&b.inp[0], &b.out_flat[0], b.n)
+        return b.out
+
+    def ned2geodetic_batch(self, ned):
+        assert self.lc
+        cdef BatchBuffers b = BatchBuffers(ned, 3, (3,))
+        if b.n > 0:
+            self.lc.ned2geodetic_batch(&b.inp[0], &b.out_flat[0], b.n)
+        return b.out
+
     def __dealloc__(self):
         del self.lc
@@ -98,30 +98,92 @@ uint32_t get_ts_elapsed(uint32_t ts, uint32_t ts_last) {
   return ts - ts_last;
 }
 
+addr_check_lookup rx_check_lookup = {.check = NULL, .len = 0};
+
+static uint32_t addr_check_hash(int addr, int bus) {
+  uint32_t key = (uint32_t)addr ^ ((uint32_t)bus << 29U);
+  return ((key * 2654435761U) >> 16U) & (ADDR_CHECK_LOOKUP_SIZE - 1U);
+}
+
+void build_addr_check_lookup(const addr_checks *rx_checks) {
+  rx_check_lookup.check = NULL;
+  rx_check_lookup.len = 0;
+  for (uint32_t k = 0U; k < ADDR_CHECK_LOOKUP_SIZE; k++) {
+    rx_check_lookup.table[k].check = -1;
+  }
+
+  // msgs with the same (addr, bus) end up along the probe sequence in the order of the
+  // checks, so lookups see them in the same order as the linear scan
+  uint32_t count = 0U;
+  bool fits = true;
+  for (int i = 0; fits && (i < rx_checks->len); i++) {
+    const AddrCheckStruct *check = &rx_checks->check[i];
+    const int msg_len = sizeof(check->msg) / sizeof(check->msg[0]);
+    for (int j = 0; (j < msg_len) && (check->msg[j].addr != 0); j++) {
+      count++;
+      if ((count * 2U) > ADDR_CHECK_LOOKUP_SIZE) {
+        fits = false;
+        break;
+      }
+      uint32_t k = addr_check_hash(check->msg[j].addr, check->msg[j].bus);
+      while (rx_check_lookup.table[k].check != -1) {
+        k = (k + 1U) & (ADDR_CHECK_LOOKUP_SIZE - 1U);
+      }
+      rx_check_lookup.table[k] = (addr_check_lookup_entry){check->msg[j].addr, check->msg[j].bus, i, j};
+    }
+  }
+
+  // modes checking more msgs than fit keep using the linear scan
+  if (fits) {
+    rx_check_lookup.check = rx_checks->check;
+    rx_check_lookup.len = rx_checks->len;
+  }
+}
+
 int get_addr_check_index(CANPacket_t *to_push, AddrCheckStruct addr_list[], const int len) {
   int bus = GET_BUS(to_push);
   int addr = GET_ADDR(to_push);
   int length = GET_LEN(to_push);
 
   int index = -1;
-  for (int i = 0; i < len; i++) {
-    // if multiple msgs are allowed, determine which one is present on the bus
-    if (!addr_list[i].msg_seen) {
-      for (uint8_t j = 0U; addr_list[i].msg[j].addr != 0; j++) {
-        if ((addr == addr_list[i].msg[j].addr) && (bus == addr_list[i].msg[j].bus) &&
-              (length == addr_list[i].msg[j].len)) {
-          addr_list[i].index = j;
-          addr_list[i].msg_seen = true;
+  if ((addr_list == rx_check_lookup.check) && (len == rx_check_lookup.len)) {
+    uint32_t k = addr_check_hash(addr, bus);
+    while (rx_check_lookup.table[k].check != -1) {
+      const addr_check_lookup_entry *entry = &rx_check_lookup.table[k];
+      if ((addr == entry->addr) && (bus == entry->bus) && (length == addr_list[entry->check].msg[entry->msg].len)) {
+        AddrCheckStruct *check = &addr_list[entry->check];
+        // if multiple msgs are allowed, the first one seen on the bus is the one checked
+        if (!check->msg_seen) {
+          check->index = entry->msg;
+          check->msg_seen = true;
+        }
+        if (check->index == entry->msg) {
+          index = entry->check;
           break;
         }
       }
+      k = (k + 1U) & (ADDR_CHECK_LOOKUP_SIZE - 1U);
     }
+  } else {
+    for (int i = 0; i < len; i++) {
+      // if multiple msgs are allowed, determine which one is present on the bus
+      if (!addr_list[i].msg_seen) {
+        for (uint8_t j = 0U; addr_list[i].msg[j].addr != 0; j++) {
+          if ((addr == addr_list[i].msg[j].addr) && (bus == addr_list[i].msg[j].bus) &&
+                (length == addr_list[i].msg[j].len)) {
+            addr_list[i].index = j;
+            addr_list[i].msg_seen = true;
+            break;
+          }
+        }
+      }
 
-    int idx = addr_list[i].index;
-    if ((addr == addr_list[i].msg[idx].addr) && (bus == addr_list[i].msg[idx].bus) &&
-        (length == addr_list[i].msg[idx].len)) {
-      index = i;
-      break;
+      int idx = addr_list[i].index;
+      if ((addr == addr_list[i].msg[idx].addr) && (bus == addr_list[i].msg[idx].bus) &&
+          (length == addr_list[i].msg[idx].len)) {
+        index = i;
+        break;
+      }
     }
   }
   return index;
@@ -306,6 +368,7 @@ int set_safety_hooks(uint16_t mode, int16_t param) {
       current_rx_checks->check[j].msg_seen = false;
     }
   }
+  build_addr_check_lookup(current_rx_checks);
   return set_status;
 }
 
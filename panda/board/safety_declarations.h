@@ -54,6 +54,23 @@ typedef struct {
   int len;
 } addr_checks;
 
+// open addressing hash table from (addr, bus) to the rx checks that may match, built by
+// set_safety_hooks so get_addr_check_index doesn't scan every check on each rx msg
+#define ADDR_CHECK_LOOKUP_SIZE 64U  // power of 2, at least twice the number of checked msgs
+
+typedef struct {
+  int addr;
+  int bus;
+  int check;  // index in the rx checks, -1 if the slot is empty
+  int msg;    // index in check[check].msg
+} addr_check_lookup_entry;
+
+typedef struct {
+  const AddrCheckStruct *check;  // rx checks the table was built for, NULL if none
+  int len;
+  addr_check_lookup_entry table[ADDR_CHECK_LOOKUP_SIZE];
+} addr_check_lookup;
+
 int safety_rx_hook(CANPacket_t *to_push);
 int safety_tx_hook(CANPacket_t *to_send);
 int safety_tx_lin_hook(int lin_num, uint8_t *data, int len);
@@ -70,6 +87,7 @@ bool rt_rate_limit_check(int val, int val_last, const int MAX_RT_DELTA);
 float interpolate(struct lookup_t xy, float x);
 void gen_crc_lookup_table(uint8_t poly, uint8_t crc_lut[]);
 bool msg_allowed(CANPacket_t *to_send, const CanMsg msg_list[], int len);
+void build_addr_check_lookup(const addr_checks *rx_checks);
 int get_addr_check_index(CANPacket_t *to_push, AddrCheckStruct addr_list[], const int len);
 void update_counter(AddrCheckStruct addr_list[], int index, uint8_t counter);
 void update_addr_timestamp(AddrCheckStruct addr_list[], int index);
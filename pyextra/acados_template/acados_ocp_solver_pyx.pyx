@@ -347,6 +347,107 @@ cdef class AcadosOcpSolverFast:
         return
 
 
+    def set_all(self, str field_, values_):
+        """
+        Set numerical data inside the solver for stages 0, ..., len(values) - 1 in one call.
+
+            :param field: string in ['x', 'u', 'pi', 'lam', 't', 'z', 'sl', 'su', 'p']
+            :param values: array with a row per stage
+        """
+        out_fields = ['x', 'u', 'pi', 'lam', 't', 'z', 'sl', 'su']
+        if field_ not in out_fields + ['p']:
+            raise Exception('AcadosOcpSolver.set_all(): {} is not a valid argument.\
+                \nPossible values are {}. Exiting.'.format(field_, out_fields + ['p']))
+
+        field = field_.encode('utf-8')
+        cdef const char *field_c = field
+
+        cdef double[:, ::1] values = np.ascontiguousarray(values_, dtype=np.double)
+        cdef int n_stages = values.shape[0]
+        if n_stages > self.N + 1:
+            raise Exception('AcadosOcpSolver.set_all(): got {} stages, solver has {}'.format(n_stages, self.N + 1))
+
+        cdef int stage, dims
+        for stage in range(n_stages):
+            if field_ == 'p':
+                assert acados_solver.acados_update_params(self.capsule, stage, &values[stage, 0], values.shape[1]) == 0
+            else:
+                dims = acados_solver_common.ocp_nlp_dims_get_from_attr(self.nlp_config,
+                    self.nlp_dims, self.nlp_out, stage, field_c)
+                if dims != values.shape[1]:
+                    raise Exception('AcadosOcpSolver.set_all(): mismatching dimension for field "{}" '
+                        'at stage {} with dimension {} (you have {})'.format(field_, stage, dims, values.shape[1]))
+                acados_solver_common.ocp_nlp_out_set(self.nlp_config,
+                    self.nlp_dims, self.nlp_out, stage, field_c, <void *> &values[stage, 0])
+
+
+    def cost_set_all(self, str field_, values_):
+        """
+        Set numerical data in the cost module of the solver for stages 0, ..., len(values) - 1 in one call.
+
+            :param field: string, e.g. 'yref', 'W', 'Zl'
+            :param values: array with a vector or matrix per stage. A stage with smaller
+                           dimensions, like the terminal one, uses the leading elements.
+        """
+        self._model_set_all(0, field_, values_)
+
+
+    def constraints_set_all(self, str field_, values_):
+        """
+        Set numerical data in the constraint module of the solver for stages 0, ..., len(values) - 1 in one call.
+
+            :param field: string in ['lbx', 'ubx', 'lbu', 'ubu', 'lg', 'ug', 'lh', 'uh', 'uphi', 'C', 'D']
+            :param values: array with a vector or matrix per stage, see cost_set_all
+        """
+        self._model_set_all(1, field_, values_)
+
+
+    cdef _model_set_all(self, int constraints, str field_, values_):
+        name = 'constraints_set_all' if constraints else 'cost_set_all'
+        field = field_.encode('utf-8')
+        cdef const char *field_c = field
+
+        # one contiguous copy of all stages, matrices are copied column major per stage
+        values_ = np.asarray(values_, dtype=np.double)
+        if values_.ndim == 2:
+            values_ = values_[:, :, None]
+        elif values_.ndim != 3:
+            raise Exception('AcadosOcpSolver.{}(): expected an array of vectors or matrices, got shape {}'.format(name, values_.shape))
+        cdef double[:, :, ::1] values = np.ascontiguousarray(values_)
+        cdef int n_stages = values.shape[0]
+        if n_stages > self.N + 1:
+            raise Exception('AcadosOcpSolver.{}(): got {} stages, solver has {}'.format(name, n_stages, self.N + 1))
+
+        cdef double[::1] stage_value = np.empty(values.shape[1] * values.shape[2])
+        cdef int dims[2]
+        cdef int stage, i, j, rows, cols
+        for stage in range(n_stages):
+            if constraints:
+                acados_solver_common.ocp_nlp_constraint_dims_get_from_attr(self.nlp_config,
+                    self.nlp_dims, self.nlp_out, stage, field_c, &dims[0])
+            else:
+                acados_solver_common.ocp_nlp_cost_dims_get_from_attr(self.nlp_config,
+                    self.nlp_dims, self.nlp_out, stage, field_c, &dims[0])
+
+            # vectors come back as (n, 0)
+            rows = dims[0]
+            cols = dims[1] if dims[1] > 0 else 1
+            if rows > values.shape[1] or cols > values.shape[2]:
+                raise Exception('AcadosOcpSolver.{}(): mismatching dimension for field "{}" '
+                    'at stage {} with dimension {} (you have {})'.format(name, field_, stage, tuple(dims), values_.shape[1:]))
+
+            for j in range(cols):
+                for i in range(rows):
+                    stage_value[j * rows + i] = values[stage, i, j]
+
+            if constraints:
+                acados_solver_common.ocp_nlp_constraints_model_set(self.nlp_config,
+                    self.nlp_dims, self.nlp_in, stage, field_c, <void *> &stage_value[0])
+            else:
+                acados_solver_common.ocp_nlp_cost_model_set(self.nlp_config,
+                    self.nlp_dims, self.nlp_in, stage, field_c, <void *> &stage_value[0])
+
+
     def dynamics_get(self, int stage, str field_):
         """
         Get numerical data from the dynamics module of the solver:
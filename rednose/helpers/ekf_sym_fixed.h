@@ -0,0 +1,227 @@
+#pragma once
+
+#include <array>
+#include <cassert>
+#include <cmath>
+#include <string>
+#include <vector>
+
+#include <eigen3/Eigen/Dense>
+
+#include "common_ekf.h"
+#include "ekf_sym.h"
+
+namespace EKFS {
+
+// EKFSym for a filter whose dimensions are known at compile time, e.g. from
+// the constants header generated next to it. State, covariance and
+// observations are fixed size so a step doesn't allocate, and the rewind
+// history is a ring of REWIND_TO_KEEP slots allocated once. Observations have
+// up to DIM_OBS rows and a batch holds up to BATCH observations. There is no
+// MSCKF augmentation or extra args.
+template <int DIM_X, int DIM_ERR, int DIM_OBS, int BATCH = 1>
+class EKFSymFixed {
+public:
+  typedef Eigen::Matrix<double, DIM_X, 1> VectorX;
+  typedef Eigen::Matrix<double, DIM_ERR, DIM_ERR, Eigen::RowMajor> MatrixP;
+  typedef Eigen::Matrix<double, Eigen::Dynamic, 1, Eigen::ColMajor, DIM_OBS, 1> VectorZ;
+  typedef Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor, DIM_OBS, DIM_OBS> MatrixR;
+
+  struct Observation {
+    double t;
+    int kind;
+    int n;
+    std::array<VectorZ, BATCH> z;
+    std::array<MatrixR, BATCH> R;
+  };
+
+  struct Estimate {
+    VectorX xk1;
+    VectorX xk;
+    MatrixP Pk1;
+    MatrixP Pk;
+    double t;
+    int kind;
+    int n;
+    std::array<VectorZ, BATCH> y;
+    std::array<VectorZ, BATCH> z;
+  };
+
+  EKFSymFixed(const std::string &name, const MatrixP &Q, const VectorX &x_initial, const MatrixP &P_initial,
+              std::vector<int> quaternion_idxs = std::vector<int>(), double max_rewind_age = 1.0)
+      : Q(Q), quaternion_idxs(quaternion_idxs), max_rewind_age(max_rewind_age),
+        rewind_states(REWIND_TO_KEEP), rewound(REWIND_TO_KEEP) {
+    this->ekf = ekf_lookup(name);
+    assert(this->ekf);
+    this->init_state(x_initial, P_initial, NAN);
+  }
+
+  void init_state(const VectorX &state, const MatrixP &covs, double filter_time) {
+    this->x = state;
+    this->P = covs;
+    this->filter_time = filter_time;
+    this->reset_rewind();
+  }
+
+  const VectorX &state() const { return this->x; }
+  const MatrixP &covs() const { return this->P; }
+  void set_filter_time(double t) { this->filter_time = t; }
+  double get_filter_time() const { return this->filter_time; }
+  void set_global(const std::string &global_var, double val) { this->ekf->sets.at(global_var)(val); }
+  void reset_rewind() { this->rewind_start = this->rewind_size = 0; }
+
+  extra_routine_t get_extra_routine(const std::string &routine) {
+    return this->ekf->extra_routines.at(routine);
+  }
+
+  void predict(double t) {
+    // initialize time
+    if (std::isnan(this->filter_time)) {
+      this->filter_time = t;
+    }
+
+    double dt = t - this->filter_time;
+    assert(dt >= 0.0);
+
+    this->ekf->predict(this->x.data(), this->P.data(), this->Q.data(), dt);
+    this->normalize_quaternions();
+    this->filter_time = t;
+  }
+
+  // Returns false and ignores the observation if it is too old to rewind to. res is only
+  // filled in when the caller asks for it.
+  template <typename ZList, typename RList>
+  bool predict_and_update_batch(double t, int kind, const ZList &z, const RList &R, Estimate *res = nullptr) {
+    assert(z.size() == R.size());
+    assert(z.size() <= BATCH);
+
+    int n_rewound = 0;
+    if (!std::isnan(this->filter_time) && t < this->filter_time) {
+      if (this->rewind_size == 0 || t < this->checkpoint_at(0).t ||
+          t < this->checkpoint_at(this->rewind_size - 1).t - this->max_rewind_age) {
+        return false;
+      }
+      n_rewound = this->rewind(t);
+    }
+
+    Observation obs;
+    obs.t = t;
+    obs.kind = kind;
+    obs.n = z.size();
+    for (int i = 0; i < obs.n; i++) {
+      obs.z[i] = z[i];
+      obs.R[i] = R[i];
+    }
+    this->predict_and_update_batch(obs, res);
+
+    // fast forward through the observations that were rewound
+    for (int i = 0; i < n_rewound; i++) {
+      this->predict_and_update_batch(this->rewound[i], nullptr);
+    }
+    return true;
+  }
+
+private:
+  struct Checkpoint {
+    double t;
+    VectorX x;
+    MatrixP P;
+    Observation obs;
+  };
+
+  Checkpoint &checkpoint_at(int i) {
+    return this->rewind_states[(this->rewind_start + i) % REWIND_TO_KEEP];
+  }
+
+  // Restores the state to the last checkpoint at or before t and moves the
+  // observations after it to rewound, oldest first. Returns how many.
+  int rewind(double t) {
+    int n = 0;
+    while (this->checkpoint_at(this->rewind_size - 1).t > t) {
+      this->rewind_size--;
+      n++;
+    }
+    for (int i = 0; i < n; i++) {
+      this->rewound[i] = this->checkpoint_at(this->rewind_size + i).obs;
+    }
+
+    const Checkpoint &c = this->checkpoint_at(this->rewind_size - 1);
+    this->filter_time = c.t;
+    this->x = c.x;
+    this->P = c.P;
+    return n;
+  }
+
+  void checkpoint(const Observation &obs) {
+    // only keep a certain number around, the oldest is overwritten
+    if (this->rewind_size == REWIND_TO_KEEP) {
+      this->rewind_start = (this->rewind_start + 1) % REWIND_TO_KEEP;
+      this->rewind_size--;
+    }
+    Checkpoint &c = this->checkpoint_at(this->rewind_size++);
+    c.t = this->filter_time;
+    c.x = this->x;
+    c.P = this->P;
+    c.obs = obs;
+  }
+
+  void predict_and_update_batch(const Observation &obs, Estimate *res) {
+    this->predict(obs.t);
+
+    if (res != nullptr) {
+      res->t = obs.t;
+      res->kind = obs.kind;
+      res->n = obs.n;
+      res->z = obs.z;
+      res->xk1 = this->x;
+      res->Pk1 = this->P;
+    }
+
+    auto update = this->ekf->updates.at(obs.kind);
+    for (int i = 0; i < obs.n; i++) {
+      assert(obs.z[i].rows() == obs.R[i].rows());
+      assert(obs.z[i].rows() == obs.R[i].cols());
+
+      // the generated update overwrites z with the residual, R is only read
+      VectorZ y = obs.z[i];
+      update(this->x.data(), this->P.data(), y.data(), const_cast<double *>(obs.R[i].data()), nullptr);
+      this->normalize_quaternions();
+      if (res != nullptr) {
+        res->y[i] = y;
+      }
+    }
+
+    if (res != nullptr) {
+      res->xk = this->x;
+      res->Pk = this->P;
+    }
+
+    this->checkpoint(obs);
+  }
+
+  void normalize_quaternions() {
+    for (int idx : this->quaternion_idxs) {
+      this->x.template segment<4>(idx).normalize();
+    }
+  }
+
+  // stuct with linked sympy generated functions
+  const EKF *ekf = NULL;
+
+  VectorX x;  // state
+  MatrixP P;  // covs
+  double filter_time;
+
+  // process noise
+  MatrixP Q;
+  const std::vector<int> quaternion_idxs;
+
+  // rewind stuff
+  const double max_rewind_age;
+  std::vector<Checkpoint> rewind_states;  // ring of REWIND_TO_KEEP
+  int rewind_start = 0;
+  int rewind_size = 0;
+  std::vector<Observation> rewound;  // scratch for rewind
+};
+
+}
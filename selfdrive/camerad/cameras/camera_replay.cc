@@ -1,9 +1,17 @@
 #include "selfdrive/camerad/cameras/camera_replay.h"
 
+#include <dirent.h>
+
+#include <algorithm>
 #include <cassert>
+#include <chrono>
+#include <future>
 #include <thread>
 
 #include "selfdrive/common/clutil.h"
+#include "selfdrive/common/queue.h"
+#include "selfdrive/common/swaglog.h"
+#include "selfdrive/common/timing.h"
 #include "selfdrive/common/util.h"
 
 extern ExitHandler do_exit;
@@ -14,20 +22,72 @@ namespace {
 
 const char *BASE_URL = "https://commadataci.blob.core.windows.net/openpilotci/";
 
+// streamed when CAMERA_REPLAY_ROUTE doesn't point at a local route
 const std::string road_camera_route = "0c94aa1e1296d7c6|2021-05-05--19-48-37";
-// const std::string driver_camera_route = "534ccd8a0950a00c|2021-06-08--12-15-37";
+
+// frames decoded ahead of the one being sent
+const int DECODE_AHEAD = 4;
+
+// how often every camera reports its fps and jitter
+const double STATS_INTERVAL_S = 10.;
 
 std::string get_url(std::string route_name, const std::string &camera, int segment_num) {
   std::replace(route_name.begin(), route_name.end(), '|', '/');
   return util::string_format("%s%s/%d/%s.hevc", BASE_URL, route_name.c_str(), segment_num, camera.c_str());
 }
 
-void camera_init(VisionIpcServer *v, CameraState *s, int camera_id, unsigned int fps, cl_device_id device_id, cl_context ctx, VisionStreamType rgb_type, VisionStreamType yuv_type, const std::string &url) {
-  s->frame = new FrameReader();
-  if (!s->frame->load(url)) {
-    printf("failed to load stream from %s", url.c_str());
-    assert(0);
+// The segment directories of a local route in order. They're named like the
+// segments on device (<route>--<n>) or just by their number.
+std::vector<std::string> route_segments(const std::string &route_dir) {
+  std::vector<std::pair<int, std::string>> segments;
+  DIR *d = opendir(route_dir.c_str());
+  if (!d) return {};
+
+  struct dirent *de = NULL;
+  while ((de = readdir(d))) {
+    if (de->d_type != DT_DIR) continue;
+    std::string name = de->d_name;
+    size_t pos = name.rfind("--");
+    std::string num = pos == std::string::npos ? name : name.substr(pos + 2);
+    if (!num.empty() && std::all_of(num.begin(), num.end(), ::isdigit)) {
+      segments.push_back({std::stoi(num), route_dir + "/" + name});
+    }
+  }
+  closedir(d);
+
+  std::sort(segments.begin(), segments.end());
+  std::vector<std::string> ret;
+  for (auto &[num, path] : segments) ret.push_back(path);
+  return ret;
+}
+
+// The camera's video of every segment that has one
+std::vector<std::string> camera_files(const std::vector<std::string> &segments, const std::string &camera) {
+  std::vector<std::string> files;
+  for (auto &seg : segments) {
+    std::string file = seg + "/" + camera + ".hevc";
+    if (util::file_exists(file)) files.push_back(file);
+  }
+  return files;
+}
+
+std::unique_ptr<FrameReader> load_frames(const std::string &file) {
+  auto fr = std::make_unique<FrameReader>();
+  if (!fr->load(file)) {
+    LOGE("failed to load stream from %s", file.c_str());
+    return nullptr;
   }
+  return fr;
+}
+
+void camera_init(VisionIpcServer *v, CameraState *s, int camera_id, const char *name, unsigned int fps, cl_device_id device_id, cl_context ctx,
+                 VisionStreamType rgb_type, VisionStreamType yuv_type, const std::vector<std::string> &files) {
+  s->name = name;
+  s->files = files;
+  if (files.empty()) return;
+
+  s->frame = load_frames(files[0]);
+  assert(s->frame);
 
   CameraInfo ci = {
       .frame_width = s->frame->width,
@@ -38,86 +98,194 @@ void camera_init(VisionIpcServer *v, CameraState *s, int camera_id, unsigned int
   s->camera_num = camera_id;
   s->fps = fps;
   s->buf.init(device_id, ctx, s, v, FRAME_BUF_COUNT, rgb_type, yuv_type);
+  LOGW("replaying %s from %zu segments", name, files.size());
 }
 
-void camera_close(CameraState *s) {
-  delete s->frame;
+// Decodes the camera's segments in order, looping over the route, into free
+// host buffers and hands them to the camera thread.
+void decode_thread(CameraState *s, std::vector<std::unique_ptr<uint8_t[]>> *rgb_bufs,
+                   SafeQueue<int> *free_bufs, SafeQueue<int> *ready_bufs) {
+  util::set_thread_name(util::string_format("replay_%s_decoder", s->name).c_str());
+
+  auto play = [&](FrameReader *fr) {
+    for (int i = 0; i < fr->getFrameCount() && !do_exit;) {
+      int idx;
+      if (!free_bufs->try_pop(idx, 100)) continue;
+      if (fr->get(i++, (*rgb_bufs)[idx].get(), nullptr)) {
+        ready_bufs->push(idx);
+      } else {
+        free_bufs->push(idx);
+      }
+    }
+  };
+
+  std::unique_ptr<FrameReader> fr = std::move(s->frame);
+  if (s->files.size() == 1) {
+    // a single segment starts over with the reader it's already in
+    while (!do_exit) {
+      play(fr.get());
+    }
+    return;
+  }
+
+  size_t seg = 0;
+  int failed_loads = 0;
+  auto next_seg = [&] { return (seg + 1) % s->files.size(); };
+  // the next segment loads while this one plays
+  auto next = std::async(std::launch::async, load_frames, s->files[next_seg()]);
+
+  while (!do_exit) {
+    if (fr && (fr->width != s->ci.frame_width || fr->height != s->ci.frame_height)) {
+      LOGE("%s size changed in %s, skipping it", s->name, s->files[seg].c_str());
+      fr.reset();
+    }
+
+    if (fr) {
+      failed_loads = 0;
+      play(fr.get());
+    } else {
+      // back off while segments keep failing to load, up to 10 s between them
+      const int backoff_ms = std::min(100 << std::min(failed_loads++, 7), 10000);
+      for (int ms = 0; ms < backoff_ms && !do_exit; ms += 100) {
+        util::sleep_for(100);
+      }
+    }
+
+    seg = next_seg();
+    fr = next.get();
+    next = std::async(std::launch::async, load_frames, s->files[next_seg()]);
+  }
 }
 
+// Sends the decoded frames on an absolute schedule, so the time spent waiting
+// for, uploading and queueing a frame doesn't add up into drift.
 void run_camera(CameraState *s) {
-  uint32_t stream_frame_id = 0, frame_id = 0;
+  util::set_thread_name(util::string_format("replay_%s", s->name).c_str());
+
+  const size_t rgb_size = s->frame->getRGBSize();
+  std::vector<std::unique_ptr<uint8_t[]>> rgb_bufs;
+  SafeQueue<int> free_bufs, ready_bufs;
+  for (int i = 0; i < DECODE_AHEAD; i++) {
+    rgb_bufs.push_back(std::make_unique<uint8_t[]>(rgb_size));
+    free_bufs.push(i);
+  }
+  std::thread decoder(decode_thread, s, &rgb_bufs, &free_bufs, &ready_bufs);
+
+  using clock = std::chrono::steady_clock;
+  const auto period = std::chrono::nanoseconds(1000000000LL / s->fps);
+  auto deadline = clock::now();
+
+  struct {
+    int frames = 0, late = 0;
+    double jitter_sum_ms = 0, jitter_max_ms = 0;
+    clock::time_point start = clock::now();
+  } stats;
+
+  uint32_t frame_id = 0;
   size_t buf_idx = 0;
-  std::unique_ptr<uint8_t[]> rgb_buf = std::make_unique<uint8_t[]>(s->frame->getRGBSize());
-  std::unique_ptr<uint8_t[]> yuv_buf = std::make_unique<uint8_t[]>(s->frame->getYUVSize());
   while (!do_exit) {
-    if (stream_frame_id == s->frame->getFrameCount()) {
-      // loop stream
-      stream_frame_id = 0;
+    int idx;
+    if (!ready_bufs.try_pop(idx, 100)) continue;
+
+    std::this_thread::sleep_until(deadline);
+    auto now = clock::now();
+    double jitter_ms = std::chrono::duration<double, std::milli>(now - deadline).count();
+    stats.jitter_sum_ms += jitter_ms;
+    stats.jitter_max_ms = std::max(stats.jitter_max_ms, jitter_ms);
+    if (now - deadline > period) {
+      // more than a frame behind, start over from now instead of sending a burst
+      stats.late++;
+      deadline = now;
     }
-    if (s->frame->get(stream_frame_id++, rgb_buf.get(), yuv_buf.get())) {
-      s->buf.camera_bufs_metadata[buf_idx] = {.frame_id = frame_id};
-      auto &buf = s->buf.camera_bufs[buf_idx];
-      CL_CHECK(clEnqueueWriteBuffer(buf.copy_q, buf.buf_cl, CL_TRUE, 0, s->frame->getRGBSize(), rgb_buf.get(), 0, NULL, NULL));
-      s->buf.queue(buf_idx);
-      ++frame_id;
-      buf_idx = (buf_idx + 1) % FRAME_BUF_COUNT;
+    deadline += period;
+
+    s->buf.camera_bufs_metadata[buf_idx] = {.frame_id = frame_id, .timestamp_eof = nanos_since_boot()};
+    auto &buf = s->buf.camera_bufs[buf_idx];
+    CL_CHECK(clEnqueueWriteBuffer(buf.copy_q, buf.buf_cl, CL_TRUE, 0, rgb_size, rgb_bufs[idx].get(), 0, NULL, NULL));
+    free_bufs.push(idx);
+    s->buf.queue(buf_idx);
+    ++frame_id;
+    buf_idx = (buf_idx + 1) % FRAME_BUF_COUNT;
+
+    stats.frames++;
+    double elapsed = std::chrono::duration<double>(now - stats.start).count();
+    if (elapsed >= STATS_INTERVAL_S) {
+      LOGW("%s: %.2f fps, jitter avg %.2f ms max %.2f ms, %d late", s->name, stats.frames / elapsed,
+           stats.jitter_sum_ms / stats.frames, stats.jitter_max_ms, stats.late);
+      stats = {};
+      stats.start = now;
     }
-    util::sleep_for(1000 / s->fps);
   }
-}
 
-void road_camera_thread(CameraState *s) {
-  util::set_thread_name("replay_road_camera_thread");
-  run_camera(s);
+  decoder.join();
 }
 
-// void driver_camera_thread(CameraState *s) {
-//   util::set_thread_name("replay_driver_camera_thread");
-//   run_camera(s);
-// }
-
 void process_road_camera(MultiCameraState *s, CameraState *c, int cnt) {
   const CameraBuf *b = &c->buf;
   MessageBuilder msg;
-  auto framed = msg.initEvent().initRoadCameraState();
+  auto framed = c == &s->road_cam ? msg.initEvent().initRoadCameraState() : msg.initEvent().initWideRoadCameraState();
   fill_frame_data(framed, b->cur_frame_data);
-  framed.setImage(kj::arrayPtr((const uint8_t *)b->cur_yuv_buf->addr, b->cur_yuv_buf->len));
-  framed.setTransform(b->yuv_transform.v);
-  s->pm->send("roadCameraState", msg);
+  if (c == &s->road_cam) {
+    framed.setImage(kj::arrayPtr((const uint8_t *)b->cur_yuv_buf->addr, b->cur_yuv_buf->len));
+    framed.setTransform(b->yuv_transform.v);
+  }
+  s->pm->send(c == &s->road_cam ? "roadCameraState" : "wideRoadCameraState", msg);
 }
 
-// void process_driver_camera(MultiCameraState *s, CameraState *c, int cnt) {
-//   MessageBuilder msg;
-//   auto framed = msg.initEvent().initDriverCameraState();
-//   framed.setFrameType(cereal::FrameData::FrameType::FRONT);
-//   fill_frame_data(framed, c->buf.cur_frame_data);
-//   s->pm->send("driverCameraState", msg);
-// }
+void process_driver_camera(MultiCameraState *s, CameraState *c, int cnt) {
+  MessageBuilder msg;
+  auto framed = msg.initEvent().initDriverCameraState();
+  framed.setFrameType(cereal::FrameData::FrameType::FRONT);
+  fill_frame_data(framed, c->buf.cur_frame_data);
+  s->pm->send("driverCameraState", msg);
+}
 
 }  // namespace
 
 void cameras_init(VisionIpcServer *v, MultiCameraState *s, cl_device_id device_id, cl_context ctx) {
-  camera_init(v, &s->road_cam, CAMERA_ID_LGC920, 20, device_id, ctx,
-              VISION_STREAM_RGB_BACK, VISION_STREAM_ROAD, get_url(road_camera_route, "fcamera", 0));
-  // camera_init(v, &s->driver_cam, CAMERA_ID_LGC615, 10, device_id, ctx,
-  //             VISION_STREAM_RGB_FRONT, VISION_STREAM_DRIVER, get_url(driver_camera_route, "dcamera", 0));
-  s->pm = new PubMaster({"roadCameraState", "driverCameraState", "thumbnail"});
+  // CAMERA_REPLAY_ROUTE is a local route directory with a directory per segment
+  const std::string route_dir = util::getenv("CAMERA_REPLAY_ROUTE", "");
+  std::vector<std::string> road_files, driver_files, wide_road_files;
+  if (!route_dir.empty()) {
+    auto segments = route_segments(route_dir);
+    if (segments.empty()) {
+      LOGE("no segments in %s", route_dir.c_str());
+      assert(0);
+    }
+    road_files = camera_files(segments, "fcamera");
+    driver_files = camera_files(segments, "dcamera");
+    wide_road_files = camera_files(segments, "ecamera");
+  } else {
+    road_files = {get_url(road_camera_route, "fcamera", 0)};
+  }
+
+  camera_init(v, &s->road_cam, CAMERA_ID_LGC920, "road", 20, device_id, ctx,
+              VISION_STREAM_RGB_BACK, VISION_STREAM_ROAD, road_files);
+  camera_init(v, &s->driver_cam, CAMERA_ID_LGC615, "driver", 20, device_id, ctx,
+              VISION_STREAM_RGB_FRONT, VISION_STREAM_DRIVER, driver_files);
+  camera_init(v, &s->wide_road_cam, CAMERA_ID_LGC920, "wide_road", 20, device_id, ctx,
+              VISION_STREAM_RGB_WIDE, VISION_STREAM_WIDE_ROAD, wide_road_files);
+  s->pm = new PubMaster({"roadCameraState", "driverCameraState", "wideRoadCameraState", "thumbnail"});
 }
 
 void cameras_open(MultiCameraState *s) {}
 
 void cameras_close(MultiCameraState *s) {
-  camera_close(&s->road_cam);
-  camera_close(&s->driver_cam);
   delete s->pm;
 }
 
 void cameras_run(MultiCameraState *s) {
   std::vector<std::thread> threads;
-  threads.push_back(start_process_thread(s, &s->road_cam, process_road_camera));
-  // threads.push_back(start_process_thread(s, &s->driver_cam, process_driver_camera));
-  // threads.push_back(std::thread(driver_camera_thread, &s->driver_cam));
-  road_camera_thread(&s->road_cam);
+  const std::tuple<CameraState *, process_thread_cb> cameras[] = {
+    {&s->road_cam, process_road_camera},
+    {&s->driver_cam, process_driver_camera},
+    {&s->wide_road_cam, process_road_camera},
+  };
+  for (auto &[c, process] : cameras) {
+    if (c->files.empty()) continue;
+    threads.push_back(start_process_thread(s, c, process));
+    threads.push_back(std::thread(run_camera, c));
+  }
 
   for (auto &t : threads) t.join();
 
@@ -1,5 +1,9 @@
 #pragma once
 
+#include <memory>
+#include <string>
+#include <vector>
+
 #include "selfdrive/camerad/cameras/camera_common.h"
 #include "selfdrive/ui/replay/framereader.h"
 
@@ -13,12 +17,15 @@ typedef struct CameraState {
   float digital_gain = 0;
 
   CameraBuf buf;
-  FrameReader *frame = nullptr;
+  const char *name;
+  std::vector<std::string> files;  // the camera's video of every segment, in order
+  std::unique_ptr<FrameReader> frame;  // first segment, loaded to size the buffers
 } CameraState;
 
 typedef struct MultiCameraState {
   CameraState road_cam;
   CameraState driver_cam;
+  CameraState wide_road_cam;
 
   SubMaster *sm = nullptr;
   PubMaster *pm = nullptr;
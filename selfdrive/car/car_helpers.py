@@ -1,7 +1,8 @@
 import os
 from common.params import Params
 from common.basedir import BASEDIR
-from selfdrive.car.fingerprints import eliminate_incompatible_cars, all_legacy_fingerprint_cars
+from selfdrive.car.fingerprints import FINGERPRINT_INDEX
+from selfdrive.car.fingerprint_matcher_pyx import FingerprintMatcher  # pylint: disable=no-name-in-module, import-error
 from selfdrive.car.vin import get_vin, VIN_UNKNOWN
 from selfdrive.car.fw_versions import get_fw_versions, match_fw_to_car
 from selfdrive.swaglog import cloudlog
@@ -109,7 +110,7 @@ def fingerprint(logcan, sendcan):
   Params().put("CarVin", vin)
 
   finger = gen_empty_fingerprint()
-  candidate_cars = {i: all_legacy_fingerprint_cars() for i in [0, 1]}  # attempt fingerprint on both bus 0 and 1
+  matcher = FingerprintMatcher(FINGERPRINT_INDEX, [0, 1])  # attempt fingerprint on both bus 0 and 1
   frame = 0
   frame_fingerprint = 10  # 0.1s
   car_fingerprint = None
@@ -126,20 +127,19 @@ def fingerprint(logcan, sendcan):
           finger[can.src] = {}
         finger[can.src][can.address] = len(can.dat)
 
-      for b in candidate_cars:
-        # Ignore extended messages and VIN query response.
-        if can.src == b and can.address < 0x800 and can.address not in (0x7df, 0x7e0, 0x7e8):
-          candidate_cars[b] = eliminate_incompatible_cars(can, candidate_cars[b])
+    # eliminates the cars that couldn't have sent the messages, ignoring
+    # extended messages and VIN query response
+    matcher.update(a.can)
 
     # if we only have one car choice and the time since we got our first
     # message has elapsed, exit
-    for b in candidate_cars:
-      if len(candidate_cars[b]) == 1 and frame > frame_fingerprint:
+    for b in [0, 1]:
+      if matcher.count(b) == 1 and frame > frame_fingerprint:
         # fingerprint done
-        car_fingerprint = candidate_cars[b][0]
+        car_fingerprint = matcher.candidates(b)[0]
 
     # bail if no cars left or we've been waiting for more than 2s
-    failed = (all(len(cc) == 0 for cc in candidate_cars.values()) and frame > frame_fingerprint) or frame > 200
+    failed = (all(matcher.count(b) == 0 for b in [0, 1]) and frame > frame_fingerprint) or frame > 200
     succeeded = car_fingerprint is not None
     done = failed or succeeded
 
@@ -0,0 +1,73 @@
+#include "selfdrive/car/fingerprint_matcher.h"
+
+// FingerprintIndex
+
+void FingerprintIndex::add(const std::string &car, const std::map<uint32_t, uint32_t> &fingerprint) {
+  auto [it, inserted] = car_index.try_emplace(car, cars.size());
+  if (inserted) {
+    cars.push_back(car);
+    // grow every bitset when the cars outgrow a word
+    for (auto &[k, mask] : masks) {
+      mask.resize(words(), 0);
+    }
+  }
+
+  const size_t i = it->second;
+  for (auto &[address, len] : fingerprint) {
+    auto &mask = masks[key(address, len)];
+    mask.resize(words(), 0);
+    mask[i / 64] |= 1ULL << (i % 64);
+  }
+}
+
+const uint64_t *FingerprintIndex::mask(uint32_t address, uint32_t len) const {
+  auto it = masks.find(key(address, len));
+  return it == masks.end() ? nullptr : it->second.data();
+}
+
+// FingerprintMatcher
+
+FingerprintMatcher::FingerprintMatcher(const FingerprintIndex &index, const std::vector<uint8_t> &buses) : index(index) {
+  for (uint8_t bus : buses) {
+    auto &candidates = candidate_sets[bus];
+    candidates.assign(index.words(), ~0ULL);
+    if (index.size() % 64 != 0) {
+      candidates.back() = (1ULL << (index.size() % 64)) - 1;
+    }
+  }
+}
+
+void FingerprintMatcher::update(uint8_t src, uint32_t address, uint32_t len) {
+  // Ignore extended messages and VIN query response.
+  if (address >= 0x800 || address == 0x7df || address == 0x7e0 || address == 0x7e8) {
+    return;
+  }
+  auto it = candidate_sets.find(src);
+  if (it == candidate_sets.end()) {
+    return;
+  }
+
+  const uint64_t *mask = index.mask(address, len);
+  for (size_t w = 0; w < it->second.size(); w++) {
+    it->second[w] &= mask ? mask[w] : 0;
+  }
+}
+
+size_t FingerprintMatcher::count(uint8_t bus) const {
+  size_t n = 0;
+  for (uint64_t w : candidate_sets.at(bus)) {
+    n += __builtin_popcountll(w);
+  }
+  return n;
+}
+
+std::vector<std::string> FingerprintMatcher::candidates(uint8_t bus) const {
+  std::vector<std::string> ret;
+  const auto &candidates = candidate_sets.at(bus);
+  for (size_t i = 0; i < index.size(); i++) {
+    if (candidates[i / 64] & (1ULL << (i % 64))) {
+      ret.push_back(index.car(i));
+    }
+  }
+  return ret;
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// The legacy CAN fingerprints indexed by (address, length): every pair maps to
+// the set of cars with a fingerprint containing it, as a bitset over the cars.
+// A received message then eliminates candidates with one AND, instead of
+// looking it up in every fingerprint of every remaining car.
+class FingerprintIndex {
+public:
+  // adds one of a car's fingerprints, cars are numbered in the order they're first added
+  void add(const std::string &car, const std::map<uint32_t, uint32_t> &fingerprint);
+  inline size_t size() const { return cars.size(); }
+  inline size_t words() const { return (cars.size() + 63) / 64; }
+  inline const std::string &car(size_t i) const { return cars[i]; }
+  // the cars that could have sent a message, nullptr if none
+  const uint64_t *mask(uint32_t address, uint32_t len) const;
+
+private:
+  static inline uint64_t key(uint32_t address, uint32_t len) { return ((uint64_t)address << 32) | len; }
+
+  std::vector<std::string> cars;
+  std::unordered_map<std::string, size_t> car_index;
+  // a bitset of words() words per (address, length)
+  std::unordered_map<uint64_t, std::vector<uint64_t>> masks;
+};
+
+// The candidates of one fingerprinting run on each of the buses, all cars at the start
+class FingerprintMatcher {
+public:
+  FingerprintMatcher(const FingerprintIndex &index, const std::vector<uint8_t> &buses);
+  // eliminates the cars that couldn't have sent the message
+  void update(uint8_t src, uint32_t address, uint32_t len);
+  size_t count(uint8_t bus) const;
+  // the remaining cars in the order they were added to the index
+  std::vector<std::string> candidates(uint8_t bus) const;
+
+private:
+  const FingerprintIndex &index;
+  std::map<uint8_t, std::vector<uint64_t>> candidate_sets;
+};
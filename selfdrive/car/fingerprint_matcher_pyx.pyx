@@ -0,0 +1,56 @@
+# distutils: language = c++
+# cython: language_level = 3
+from libc.stdint cimport uint8_t, uint32_t
+from libcpp.map cimport map
+from libcpp.string cimport string
+from libcpp.vector cimport vector
+
+cdef extern from "selfdrive/car/fingerprint_matcher.h":
+  cdef cppclass c_FingerprintIndex "FingerprintIndex":
+    void add(string, map[uint32_t, uint32_t])
+    size_t size()
+
+  cdef cppclass c_FingerprintMatcher "FingerprintMatcher":
+    c_FingerprintMatcher(c_FingerprintIndex&, vector[uint8_t])
+    void update(uint8_t, uint32_t, uint32_t)
+    size_t count(uint8_t)
+    vector[string] candidates(uint8_t)
+
+
+cdef class FingerprintIndex:
+  cdef c_FingerprintIndex index
+
+  def __init__(self, fingerprints, extra_addresses=None):
+    """fingerprints: {car: [{address: length}, ...]}, extra_addresses are added to every fingerprint"""
+    cdef map[uint32_t, uint32_t] fp
+    for car, car_fingerprints in fingerprints.items():
+      for f in car_fingerprints:
+        fp = {**f, **(extra_addresses or {})}
+        self.index.add(car.encode(), fp)
+
+  def __len__(self):
+    return self.index.size()
+
+
+cdef class FingerprintMatcher:
+  cdef c_FingerprintMatcher *matcher
+  cdef FingerprintIndex index
+
+  def __cinit__(self, FingerprintIndex index, buses):
+    # keeps the index alive as long as the matcher
+    self.index = index
+    self.matcher = new c_FingerprintMatcher(index.index, buses)
+
+  def __dealloc__(self):
+    del self.matcher
+
+  def update(self, can_msgs):
+    """eliminates the candidates that couldn't have sent the CanData messages"""
+    for can in can_msgs:
+      self.matcher.update(can.src, can.address, len(can.dat))
+
+  def count(self, bus):
+    return self.matcher.count(bus)
+
+  def candidates(self, bus):
+    return [c.decode() for c in self.matcher.candidates(bus)]
@@ -1,5 +1,6 @@
 import os
 from common.basedir import BASEDIR
+from selfdrive.car.fingerprint_matcher_pyx import FingerprintIndex  # pylint: disable=no-name-in-module, import-error
 
 
 def get_attr_from_cars(attr, result=dict, combine_brands=True):
@@ -39,6 +40,9 @@ _FINGERPRINTS = get_attr_from_cars('FINGERPRINTS')
 
 _DEBUG_ADDRESS = {1880: 8}   # reserved for debug purposes
 
+# (address, length) -> cars, for matching many messages against all the fingerprints at once
+FINGERPRINT_INDEX = FingerprintIndex(_FINGERPRINTS, _DEBUG_ADDRESS)
+
 def is_valid_for_fingerprint(msg, car_fingerprint):
   adr = msg.address
   # ignore addresses that are more than 11 bits
@@ -0,0 +1,58 @@
+#!/usr/bin/env python3
+import random
+import unittest
+from collections import namedtuple
+
+from selfdrive.car.fingerprints import FINGERPRINT_INDEX, _FINGERPRINTS, all_legacy_fingerprint_cars, eliminate_incompatible_cars
+from selfdrive.car.fingerprint_matcher_pyx import FingerprintMatcher  # pylint: disable=no-name-in-module, import-error
+
+CanData = namedtuple("CanData", ["src", "address", "dat"])
+
+
+def startup_can(car_name, rnd):
+  """what the car sends in the first seconds, split into the frames get_one_can returns"""
+  fingerprint = rnd.choice(_FINGERPRINTS[car_name])
+  msgs = [CanData(rnd.choice([0, 0, 1, 2, 128]), addr, b"\x00" * length) for addr, length in fingerprint.items()]
+  # messages no fingerprint has, the debug address, VIN query and extended addresses
+  for _ in range(20):
+    addr = rnd.choice([rnd.randint(0, 0x7ff), 1880, 0x7df, 0x7e0, 0x7e8, rnd.randint(0x800, 0x1fffffff)])
+    msgs.append(CanData(rnd.choice([0, 1]), addr, b"\x00" * rnd.choice([1, 4, 8, 32])))
+  rnd.shuffle(msgs)
+  return [msgs[i:i+16] for i in range(0, len(msgs), 16)]
+
+
+def eliminate(candidate_cars, can_msgs):
+  # the loop car_helpers.fingerprint had before the matcher
+  for can in can_msgs:
+    for b in candidate_cars:
+      if can.src == b and can.address < 0x800 and can.address not in (0x7df, 0x7e0, 0x7e8):
+        candidate_cars[b] = eliminate_incompatible_cars(can, candidate_cars[b])
+
+
+class TestFingerprintMatcher(unittest.TestCase):
+  def test_index(self):
+    self.assertEqual(len(FINGERPRINT_INDEX), len(_FINGERPRINTS))
+
+  def test_same_candidates(self):
+    rnd = random.Random(0)
+    for car_name in all_legacy_fingerprint_cars():
+      for _ in range(5):
+        candidate_cars = {b: all_legacy_fingerprint_cars() for b in [0, 1]}
+        matcher = FingerprintMatcher(FINGERPRINT_INDEX, [0, 1])
+        for frame in startup_can(car_name, rnd):
+          eliminate(candidate_cars, frame)
+          matcher.update(frame)
+          for b in [0, 1]:
+            self.assertEqual(matcher.candidates(b), candidate_cars[b])
+            self.assertEqual(matcher.count(b), len(candidate_cars[b]))
+
+  def test_own_fingerprint(self):
+    for car_name, fingerprints in _FINGERPRINTS.items():
+      for fingerprint in fingerprints:
+        matcher = FingerprintMatcher(FINGERPRINT_INDEX, [0])
+        matcher.update([CanData(0, addr, b"\x00" * length) for addr, length in fingerprint.items() if addr != 1880])
+        self.assertIn(car_name, matcher.candidates(0))
+
+
+if __name__ == "__main__":
+  unittest.main()
@@ -1,10 +1,15 @@
 #include "selfdrive/common/clutil.h"
 
+#include <unistd.h>
+
 #include <cassert>
+#include <cinttypes>
+#include <cstdio>
 #include <iostream>
 #include <memory>
 
 #include "selfdrive/common/util.h"
+#include "selfdrive/hardware/hw.h"
 
 namespace {  // helper functions
 
@@ -52,6 +57,94 @@ void cl_print_build_errors(cl_program program, cl_device_id device) {
   std::cout << "build failed; status=" << status << ", log:" << std::endl << log << std::endl; 
 }
 
+// Program binary cache
+//
+// Building from source costs hundreds of ms per program on the adreno
+// compiler and every CL user does it on each start. Built binaries are kept in
+// Path::cl_cache(), one file per program named by the hash of its key. The key
+// covers the source, the build args and the device and driver, and is stored
+// in front of the binary so a hash collision or a stale file is caught on load.
+// Anything that doesn't load falls back to building from source. CL_CACHE=0
+// turns the cache off.
+
+uint64_t fnv1a_64(const std::string &s, uint64_t h = 0xcbf29ce484222325ULL) {
+  for (unsigned char c : s) {
+    h = (h ^ c) * 0x100000001b3ULL;
+  }
+  return h;
+}
+
+std::string hash_str(uint64_t h) {
+  char buf[17];
+  snprintf(buf, sizeof(buf), "%016" PRIx64, h);
+  return buf;
+}
+
+std::string cache_key(cl_device_id device_id, const std::string &src, const char *args) {
+  cl_platform_id platform;
+  CL_CHECK(clGetDeviceInfo(device_id, CL_DEVICE_PLATFORM, sizeof(platform), &platform, NULL));
+  // the info strings come with their null terminator
+  auto line = [](const std::string &s) { return std::string(s.c_str()) + "\n"; };
+  return "clcache v1\n" +
+         line(get_platform_info(platform, CL_PLATFORM_VERSION)) +
+         line(get_device_info(device_id, CL_DEVICE_NAME)) +
+         line(get_device_info(device_id, CL_DEVICE_VERSION)) +
+         line(get_device_info(device_id, CL_DRIVER_VERSION)) +
+         line(args ? args : "") +
+         line(hash_str(fnv1a_64(src)));
+}
+
+std::string cache_path(const std::string &key) {
+  return Path::cl_cache() + "/" + hash_str(fnv1a_64(key)) + ".bin";
+}
+
+cl_program cache_load(cl_context ctx, cl_device_id device_id, const std::string &key, const char *args) {
+  std::string file = util::read_file(cache_path(key));
+  if (file.size() <= key.size() || file.compare(0, key.size(), key) != 0) {
+    return nullptr;
+  }
+
+  const uint8_t *binary = (const uint8_t *)file.data() + key.size();
+  size_t length = file.size() - key.size();
+  cl_int status = CL_SUCCESS, err = CL_SUCCESS;
+  cl_program prg = clCreateProgramWithBinary(ctx, 1, &device_id, &length, &binary, &status, &err);
+  if (err != CL_SUCCESS || status != CL_SUCCESS) {
+    if (prg) clReleaseProgram(prg);
+    return nullptr;
+  }
+  if (clBuildProgram(prg, 1, &device_id, args, NULL, NULL) != CL_SUCCESS) {
+    clReleaseProgram(prg);
+    return nullptr;
+  }
+  return prg;
+}
+
+void cache_store(cl_program prg, const std::string &key) {
+  size_t length = 0;
+  if (clGetProgramInfo(prg, CL_PROGRAM_BINARY_SIZES, sizeof(length), &length, NULL) != CL_SUCCESS || length == 0) {
+    return;
+  }
+  std::string file = key;
+  file.resize(key.size() + length);
+  uint8_t *binary = (uint8_t *)file.data() + key.size();
+  if (clGetProgramInfo(prg, CL_PROGRAM_BINARIES, sizeof(binary), &binary, NULL) != CL_SUCCESS) {
+    return;
+  }
+
+  // write to a temp file and rename, other processes may be loading the same program
+  const std::string dir = Path::cl_cache();
+  if (!util::create_directories(dir, 0775)) return;
+  std::string tmp_path = dir + "/.tmp_XXXXXX";
+  int fd = mkstemp(tmp_path.data());
+  if (fd < 0) return;
+  ssize_t written = HANDLE_EINTR(write(fd, file.data(), file.size()));
+  bool ok = written == (ssize_t)file.size() && fsync(fd) == 0;
+  close(fd);
+  if (!ok || rename(tmp_path.c_str(), cache_path(key).c_str()) != 0) {
+    unlink(tmp_path.c_str());
+  }
+}
+
 }  // namespace
 
 cl_device_id cl_get_device_id(cl_device_type device_type) {
@@ -78,11 +171,23 @@ cl_program cl_program_from_file(cl_context ctx, cl_device_id device_id, const ch
 }
 
 cl_program cl_program_from_source(cl_context ctx, cl_device_id device_id, const std::string& src, const char* args) {
+  const bool use_cache = util::getenv("CL_CACHE", 1) != 0;
+  std::string key;
+  if (use_cache) {
+    key = cache_key(device_id, src, args);
+    if (cl_program prg = cache_load(ctx, device_id, key, args)) {
+      return prg;
+    }
+  }
+
   cl_program prg = CL_CHECK_ERR(clCreateProgramWithSource(ctx, 1, (const char*[]){src.c_str()}, NULL, &err));
   if (int err = clBuildProgram(prg, 1, &device_id, args, NULL, NULL); err != 0) {
     cl_print_build_errors(prg, device_id);
     assert(0);
   }
+  if (use_cache) {
+    cache_store(prg, key);
+  }
   return prg;
 }
 
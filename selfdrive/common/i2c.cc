@@ -17,6 +17,7 @@
 #ifdef QCOM2
 // TODO: decide if we want to isntall libi2c-dev everywhere
 extern "C" {
+  #include <linux/i2c.h>
   #include <linux/i2c-dev.h>
   #include <i2c/smbus.h>
 }
@@ -61,6 +62,18 @@ fail:
   return ret;
 }
 
+int I2CBus::read_burst(uint8_t device_address, uint register_address, uint8_t *buffer, uint16_t len) {
+  uint8_t reg = register_address;
+  struct i2c_msg msgs[2] = {
+    {.addr = device_address, .flags = 0, .len = 1, .buf = &reg},
+    {.addr = device_address, .flags = I2C_M_RD, .len = len, .buf = buffer},
+  };
+  struct i2c_rdwr_ioctl_data data = {.msgs = msgs, .nmsgs = 2};
+
+  int ret = HANDLE_EINTR(ioctl(i2c_fd, I2C_RDWR, &data));
+  return ret < 0 ? ret : len;
+}
+
 #else
 
 I2CBus::I2CBus(uint8_t bus_id) {
@@ -84,4 +97,12 @@ int I2CBus::set_register(uint8_t device_address, uint register_address, uint8_t
   UNUSED(data);
   return -1;
 }
+
+int I2CBus::read_burst(uint8_t device_address, uint register_address, uint8_t *buffer, uint16_t len) {
+  UNUSED(device_address);
+  UNUSED(register_address);
+  UNUSED(buffer);
+  UNUSED(len);
+  return -1;
+}
 #endif
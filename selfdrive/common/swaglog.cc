@@ -4,10 +4,19 @@
 
 #include "selfdrive/common/swaglog.h"
 
+#include <pthread.h>
+
+#include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <condition_variable>
+#include <cstdarg>
 #include <cstring>
+#include <memory>
 #include <mutex>
 #include <string>
+#include <thread>
+#include <vector>
 
 #include <zmq.h>
 #include "json11.hpp"
@@ -16,39 +25,113 @@
 #include "selfdrive/common/version.h"
 #include "selfdrive/hardware/hw.h"
 
+// Each logging thread owns a single-producer/single-consumer ring of fixed size
+// records. The caller only formats the message into its slot; building the json
+// and sending it to logmessaged happens on a background thread, which sleeps
+// until a record arrives. Errors and above are sent before cloudlog returns,
+// since the process may be about to crash, and the rings are flushed at exit.
+const int LOG_RING_SIZE = 256;    // must be a power of two
+const int LOG_MSG_SIZE = 480;
+
+struct LogRecord {
+  int levelnum;
+  int lineno;
+  const char* filename;
+  const char* func;
+  double created;
+  char* overflow_msg;  // heap allocated when the message doesn't fit in msg
+  char msg[LOG_MSG_SIZE];
+};
+
+struct LogRing {
+  std::atomic<uint32_t> head = 0;  // written by the producer
+  std::atomic<uint32_t> tail = 0;  // written by the consumer
+  std::atomic<uint32_t> dropped = 0;
+  std::atomic<bool> retired = false;
+  LogRecord records[LOG_RING_SIZE];
+};
+
+// the socket and the thread draining the rings into it. A forked child
+// starts its own when it first logs, the parent's thread doesn't exist there
+// and its zmq context can't be used
+struct LogSender {
+  void *zctx;
+  void *sock;
+  std::mutex wake_lock;
+  std::condition_variable wake;
+  std::thread thread;
+};
+
 class LogState {
  public:
   LogState() = default;
   ~LogState();
   std::mutex lock;
-  bool inited;
+  std::atomic<bool> inited = false;
+  std::atomic<bool> exit = false;
+  std::atomic<bool> waiting = false;  // the log thread is going to sleep
   json11::Json::object ctx_j;
-  void *zctx;
-  void *sock;
+  std::string ctx_s;
   int print_level;
+
+  std::mutex rings_lock;
+  std::vector<std::unique_ptr<LogRing>> rings;
+  std::unique_ptr<LogSender> sender;
+
+  // set in a forked child until its first log call. The first parent_rings
+  // rings were inherited from the parent, of their threads only the one
+  // owning fork_ring exists in the child
+  std::atomic<bool> forked = false;
+  size_t parent_rings = 0;
+  LogRing *fork_ring = nullptr;
 };
 
+static LogState s = {};
+
+static void log_thread(LogSender *sender);
+
 LogState::~LogState() {
-  zmq_close(sock);
-  zmq_ctx_destroy(zctx);
+  if (sender) {
+    {
+      std::lock_guard lk(sender->wake_lock);
+      exit = true;
+    }
+    sender->wake.notify_one();
+    sender->thread.join();
+    zmq_close(sender->sock);
+    zmq_ctx_destroy(sender->zctx);
+  }
 }
 
-static LogState s = {};
+// called with s.lock held
+static void start_sender() {
+  s.sender = std::make_unique<LogSender>();
+  s.sender->zctx = zmq_ctx_new();
+  s.sender->sock = zmq_socket(s.sender->zctx, ZMQ_PUSH);
+
+  int timeout = 100; // 100 ms timeout on shutdown for messages to be received by logmessaged
+  zmq_setsockopt(s.sender->sock, ZMQ_LINGER, &timeout, sizeof(timeout));
+
+  zmq_connect(s.sender->sock, "ipc:///tmp/logmessage");
+  s.sender->thread = std::thread(log_thread, s.sender.get());
+}
+
+static void cloudlog_flush();
+static void atfork_prepare();
+static void atfork_parent();
+static void atfork_child();
 
 static void cloudlog_bind_locked(const char* k, const char* v) {
   s.ctx_j[k] = v;
+  s.ctx_s = json11::Json(s.ctx_j).dump();
 }
 
 static void cloudlog_init() {
   if (s.inited) return;
-  s.ctx_j = json11::Json::object {};
-  s.zctx = zmq_ctx_new();
-  s.sock = zmq_socket(s.zctx, ZMQ_PUSH);
-
-  int timeout = 100; // 100 ms timeout on shutdown for messages to be received by logmessaged
-  zmq_setsockopt(s.sock, ZMQ_LINGER, &timeout, sizeof(timeout));
+  std::lock_guard lk(s.lock);
+  if (s.inited) return;
 
-  zmq_connect(s.sock, "ipc:///tmp/logmessage");
+  s.ctx_j = json11::Json::object {};
 
   s.print_level = CLOUDLOG_WARNING;
   const char* print_level = getenv("LOGPRINT");
@@ -79,45 +162,225 @@ static void cloudlog_init() {
     cloudlog_bind_locked("device", "pc");
   }
 
+  start_sender();
+  pthread_atfork(atfork_prepare, atfork_parent, atfork_child);
+  atexit(cloudlog_flush);
   s.inited = true;
 }
 
-void log(int levelnum, const char* filename, int lineno, const char* func, const char* msg, const std::string& log_s) {
+// marks the ring of an exiting thread so the log thread can free it once drained
+struct ThreadLogRing {
+  LogRing *ring = nullptr;
+  ~ThreadLogRing() {
+    if (ring) ring->retired = true;
+  }
+};
+
+static thread_local ThreadLogRing thread_ring;
+
+static LogRing *get_thread_ring() {
+  if (!thread_ring.ring) {
+    auto ring = std::make_unique<LogRing>();
+    thread_ring.ring = ring.get();
+    std::lock_guard lk(s.rings_lock);
+    s.rings.push_back(std::move(ring));
+  }
+  return thread_ring.ring;
+}
+
+static void send_record(const LogRecord &r, std::string &out) {
+  const char *msg = r.overflow_msg ? r.overflow_msg : r.msg;
+
+  out.clear();
+  out += (char)r.levelnum;
+  out += "{\"msg\": ";
+  json11::Json(msg).dump(out);
+  out += ", \"ctx\": ";
+  out += s.ctx_s;
+  out += ", \"levelnum\": ";
+  out += std::to_string(r.levelnum);
+  out += ", \"filename\": ";
+  json11::Json(r.filename).dump(out);
+  out += ", \"lineno\": ";
+  out += std::to_string(r.lineno);
+  out += ", \"funcname\": ";
+  json11::Json(r.func).dump(out);
+  out += ", \"created\": ";
+  json11::Json(r.created).dump(out);
+  out += "}";
+  zmq_send(s.sender->sock, out.data(), out.length(), ZMQ_NOBLOCK);
+}
+
+static void send_dropped(uint32_t dropped, std::string &out) {
+  LogRecord r = {};
+  r.levelnum = CLOUDLOG_WARNING;
+  r.lineno = __LINE__;
+  r.filename = __FILE__;
+  r.func = __func__;
+  r.created = seconds_since_epoch();
+  snprintf(r.msg, sizeof(r.msg), "cloudlog: %u messages dropped", dropped);
+  send_record(r, out);
+}
+
+// returns the number of records sent
+static int drain_rings(std::string &out) {
+  int sent = 0;
+  std::lock_guard lk(s.lock);  // protects ctx_s
+  std::lock_guard rings_lk(s.rings_lock);
+  for (auto it = s.rings.begin(); it != s.rings.end();) {
+    LogRing *ring = it->get();
+    bool retired = ring->retired;
+    uint32_t tail = ring->tail.load(std::memory_order_relaxed);
+    uint32_t head = ring->head.load(std::memory_order_acquire);
+    for (; tail != head; tail++, sent++) {
+      LogRecord &r = ring->records[tail & (LOG_RING_SIZE - 1)];
+      send_record(r, out);
+      free(r.overflow_msg);
+    }
+    ring->tail.store(tail, std::memory_order_release);
+
+    if (uint32_t dropped = ring->dropped.exchange(0)) {
+      send_dropped(dropped, out);
+    }
+
+    // retired was read before head, so nothing can be left in the ring
+    it = retired ? s.rings.erase(it) : it + 1;
+  }
+  return sent;
+}
+
+static bool rings_pending() {
+  std::lock_guard lk(s.rings_lock);
+  return std::any_of(s.rings.begin(), s.rings.end(), [](auto &ring) {
+    return ring->head.load() != ring->tail.load(std::memory_order_relaxed);
+  });
+}
+
+static void log_thread(LogSender *sender) {
+  util::set_thread_name("swaglog");
+  std::string out;
+  out.reserve(4096);
+  while (!s.exit) {
+    if (drain_rings(out) > 0) continue;
+
+    std::unique_lock lk(sender->wake_lock);
+    // a record published before waiting is set is seen by rings_pending,
+    // the producer of one published after it sees waiting and notifies
+    s.waiting = true;
+    if (!s.exit && !rings_pending()) {
+      sender->wake.wait(lk);
+    }
+    s.waiting = false;
+  }
+  drain_rings(out);
+}
+
+static void cloudlog_flush() {
+  // a forked child that hasn't logged has nothing of its own to send
+  if (s.forked) return;
+  std::string out;
+  drain_rings(out);
+}
+
+// the rings are consistent in the child when neither lock is held across fork
+static void atfork_prepare() {
+  s.lock.lock();
+  s.rings_lock.lock();
+}
+
+static void atfork_parent() {
+  s.rings_lock.unlock();
+  s.lock.unlock();
+}
+
+// Only resets the state, children that exec right away never start a thread
+// or a zmq context. The child's first log call finishes in init_child().
+static void atfork_child() {
+  s.sender.release();  // leaked, its thread and zmq context belong to the parent
+  s.waiting = false;
+  s.parent_rings = s.rings.size();
+  s.fork_ring = thread_ring.ring;
+  s.forked = true;
+
+  s.rings_lock.unlock();
+  s.lock.unlock();
+}
+
+static void init_child() {
   std::lock_guard lk(s.lock);
-  cloudlog_init();
-  if (levelnum >= s.print_level) {
-    printf("%s: %s\n", filename, msg);
+  std::lock_guard rings_lk(s.rings_lock);
+  if (!s.forked) return;
+
+  // the records still in the inherited rings are the parent's to send, and
+  // the rings of the parent's other threads are gone
+  auto inherited = s.rings.begin() + s.parent_rings;
+  for (auto it = s.rings.begin(); it != inherited; ++it) {
+    LogRing *ring = it->get();
+    uint32_t head = ring->head.load(std::memory_order_relaxed);
+    for (uint32_t tail = ring->tail.load(std::memory_order_relaxed); tail != head; tail++) {
+      free(ring->records[tail & (LOG_RING_SIZE - 1)].overflow_msg);
+    }
+    ring->tail = head;
+    ring->dropped = 0;
   }
-  char levelnum_c = levelnum;
-  zmq_send(s.sock, (levelnum_c + log_s).c_str(), log_s.length() + 1, ZMQ_NOBLOCK);
+  s.rings.erase(std::remove_if(s.rings.begin(), inherited, [](auto &ring) {
+    return ring.get() != s.fork_ring;
+  }), inherited);
+
+  start_sender();
+  s.forked = false;
 }
 
 void cloudlog_e(int levelnum, const char* filename, int lineno, const char* func,
                 const char* fmt, ...) {
-  char* msg_buf = nullptr;
+  cloudlog_init();
+  if (s.forked) init_child();
+  LogRing *ring = get_thread_ring();
+
+  uint32_t head = ring->head.load(std::memory_order_relaxed);
+  if (head - ring->tail.load(std::memory_order_acquire) >= LOG_RING_SIZE) {
+    ring->dropped.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+
+  LogRecord &r = ring->records[head & (LOG_RING_SIZE - 1)];
+  r.levelnum = levelnum;
+  r.lineno = lineno;
+  r.filename = filename;
+  r.func = func;
+  r.created = seconds_since_epoch();
+  r.overflow_msg = nullptr;
+
   va_list args;
   va_start(args, fmt);
-  vasprintf(&msg_buf, fmt, args);
+  int len = vsnprintf(r.msg, sizeof(r.msg), fmt, args);
   va_end(args);
+  if (len < 0) return;
+
+  if (len >= (int)sizeof(r.msg)) {
+    va_start(args, fmt);
+    vasprintf(&r.overflow_msg, fmt, args);
+    va_end(args);
+  }
+
+  if (levelnum >= s.print_level) {
+    printf("%s: %s\n", filename, r.overflow_msg ? r.overflow_msg : r.msg);
+  }
 
-  if (!msg_buf) return;
+  ring->head.store(head + 1);
 
-  json11::Json log_j = json11::Json::object {
-    {"msg", msg_buf},
-    {"ctx", s.ctx_j},
-    {"levelnum", levelnum},
-    {"filename", filename},
-    {"lineno", lineno},
-    {"funcname", func},
-    {"created", seconds_since_epoch()}
-  };
-  std::string log_s = log_j.dump();
-  log(levelnum, filename, lineno, func, msg_buf, log_s);
-  free(msg_buf);
+  if (levelnum >= CLOUDLOG_ERROR) {
+    cloudlog_flush();
+    // zmq writes to the socket from its io thread, let it run before a possible crash
+    std::this_thread::yield();
+  } else if (s.waiting.exchange(false)) {
+    std::lock_guard lk(s.sender->wake_lock);
+    s.sender->wake.notify_one();
+  }
 }
 
 void cloudlog_bind(const char* k, const char* v) {
-  std::lock_guard lk(s.lock);
   cloudlog_init();
+  std::lock_guard lk(s.lock);
   cloudlog_bind_locked(k, v);
 }
@@ -0,0 +1,38 @@
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+#include "selfdrive/common/swaglog.h"
+#include "selfdrive/common/timing.h"
+
+// measures the caller-side cost of cloudlog. run with logmessaged stopped to
+// exclude its cpu usage, messages are dropped by zmq once the hwm is reached.
+static double bench_thread(int n) {
+  uint64_t start = nanos_since_boot();
+  for (int i = 0; i < n; i++) {
+    LOGD("bench %d: missed cycles %d, can %x", i, i % 7, 0x1a0 + (i & 0xf));
+    if ((i & 0x7f) == 0) {
+      // give the log thread a chance to drain instead of measuring drops
+      std::this_thread::yield();
+    }
+  }
+  return (nanos_since_boot() - start) / (double)n;
+}
+
+int main(int argc, char *argv[]) {
+  int num_threads = argc > 1 ? atoi(argv[1]) : 4;
+  const int n = argc > 2 ? atoi(argv[2]) : 100000;
+
+  std::vector<double> ns_per_call(num_threads);
+  std::vector<std::thread> threads;
+  for (int i = 0; i < num_threads; i++) {
+    threads.emplace_back([&, i]() { ns_per_call[i] = bench_thread(n); });
+  }
+  for (auto &t : threads) t.join();
+
+  for (int i = 0; i < num_threads; i++) {
+    printf("thread %d: %.1f ns/call, %.0f calls/s\n", i, ns_per_call[i], 1e9 / ns_per_call[i]);
+  }
+  return 0;
+}
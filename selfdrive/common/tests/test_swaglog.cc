@@ -0,0 +1,125 @@
+#include <dirent.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <zmq.h>
+
+#include <csignal>
+#include <cstdlib>
+#include <string>
+
+#define CATCH_CONFIG_MAIN
+#include "catch2/catch.hpp"
+#include "selfdrive/common/swaglog.h"
+#include "selfdrive/common/util.h"
+
+// stands in for logmessaged
+class LogReceiver {
+public:
+  LogReceiver() {
+    ctx = zmq_ctx_new();
+    sock = zmq_socket(ctx, ZMQ_PULL);
+    int timeout = 2000;
+    zmq_setsockopt(sock, ZMQ_RCVTIMEO, &timeout, sizeof(timeout));
+    REQUIRE(zmq_bind(sock, "ipc:///tmp/logmessage") == 0);
+  }
+  ~LogReceiver() {
+    zmq_close(sock);
+    zmq_ctx_destroy(ctx);
+  }
+
+  // true once a message containing msg arrives, false when nothing arrives for two seconds
+  bool received(const std::string &msg) {
+    char buf[4096];
+    int len;
+    while ((len = zmq_recv(sock, buf, sizeof(buf), 0)) >= 0) {
+      if (std::string(buf, std::min<size_t>(len, sizeof(buf))).find(msg) != std::string::npos) return true;
+    }
+    return false;
+  }
+
+private:
+  void *ctx;
+  void *sock;
+};
+
+static int wait_child(pid_t pid) {
+  int status = 0;
+  waitpid(pid, &status, 0);
+  return status;
+}
+
+TEST_CASE("errors are sent before cloudlog returns") {
+  LogReceiver receiver;
+  pid_t pid = fork();
+  if (pid == 0) {
+    // a process that has been running for a while, connected to logmessaged
+    LOGW("test_swaglog: started");
+    util::sleep_for(100);
+    LOGE("test_swaglog: error before abort");
+    signal(SIGABRT, SIG_DFL);  // not catch's handler
+    abort();
+  }
+  REQUIRE(receiver.received("test_swaglog: error before abort"));
+  int status = wait_child(pid);
+  REQUIRE((WIFSIGNALED(status) && WTERMSIG(status) == SIGABRT));
+}
+
+TEST_CASE("a forked child logs through its own thread") {
+  LogReceiver receiver;
+  LOGW("test_swaglog: parent before fork");
+  REQUIRE(receiver.received("test_swaglog: parent before fork"));
+
+  pid_t pid = fork();
+  if (pid == 0) {
+    LOGW("test_swaglog: forked child");
+    util::sleep_for(200);
+    _exit(0);  // skips the flush at exit, only the child's log thread can send it
+  }
+  REQUIRE(receiver.received("test_swaglog: forked child"));
+  REQUIRE(wait_child(pid) == 0);
+
+  // and the parent still logs
+  LOGW("test_swaglog: parent after fork");
+  REQUIRE(receiver.received("test_swaglog: parent after fork"));
+}
+
+static int thread_count() {
+  int count = 0;
+  DIR *d = opendir("/proc/self/task");
+  while (struct dirent *de = readdir(d)) {
+    if (de->d_name[0] != '.') count++;
+  }
+  closedir(d);
+  return count;
+}
+
+TEST_CASE("a forked child starts no threads until it logs") {
+  LogReceiver receiver;
+  LOGW("test_swaglog: parent before fork");
+  REQUIRE(receiver.received("test_swaglog: parent before fork"));
+
+  pid_t pid = fork();
+  if (pid == 0) {
+    // like a child that execs right away
+    int before = thread_count();
+    LOGW("test_swaglog: child logs");
+    int after = thread_count();
+    util::sleep_for(200);
+    _exit(before == 1 && after > 1 ? 0 : 1);
+  }
+  REQUIRE(receiver.received("test_swaglog: child logs"));
+  REQUIRE(wait_child(pid) == 0);
+}
+
+TEST_CASE("pending records are sent at exit") {
+  LogReceiver receiver;
+  pid_t pid = fork();
+  if (pid == 0) {
+    for (int i = 0; i < 100; i++) {
+      LOGW("test_swaglog: before exit %d", i);
+    }
+    exit(0);
+  }
+  REQUIRE(receiver.received("test_swaglog: before exit 99"));
+  REQUIRE(wait_child(pid) == 0);
+}
@@ -13,6 +13,10 @@ int hclust_fast(int n, double* distmat, int method, int* merge, double* height);
 void cutree_cdist(int n, const int* merge, double* height, double cdist, int* labels);
 void hclust_pdist(int n, int m, double* pts, double* out);
 void cluster_points_centroid(int n, int m, double* pts, double dist, int* idx);
+
+void* grid_cluster_init();
+void grid_cluster_free(void* gc);
+int grid_cluster_update(void* gc, int n, int m, const double* pts, const uint64_t* track_ids, double dist, int* labels, int* ids);
 """)
 
 hclust = ffi.dlopen(cluster_fn)
@@ -26,3 +30,22 @@ def cluster_points_centroid(pts, dist):
   labels_ptr = ffi.new("int[]", n)
   hclust.cluster_points_centroid(n, m, pts_ptr, dist**2, labels_ptr)
   return list(labels_ptr)
+
+
+class GridCluster:
+  """Same labels as cluster_points_centroid, but only compares nearby points.
+  Also gives each cluster an id that persists between updates."""
+  def __init__(self):
+    self.gc = ffi.gc(hclust.grid_cluster_init(), hclust.grid_cluster_free)
+    self.ids = []
+
+  def update(self, track_ids, pts, dist):
+    pts = np.ascontiguousarray(pts, dtype=np.float64)
+    pts_ptr = ffi.cast("double *", pts.ctypes.data)
+    n, m = pts.shape
+
+    labels_ptr = ffi.new("int[]", n)
+    ids_ptr = ffi.new("int[]", n)
+    hclust.grid_cluster_update(self.gc, n, m, pts_ptr, ffi.new("uint64_t[]", list(track_ids)), dist**2, labels_ptr, ids_ptr)
+    self.ids = list(ids_ptr)
+    return list(labels_ptr)
@@ -0,0 +1,212 @@
+#include <algorithm>
+#include <array>
+#include <climits>
+#include <cmath>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+extern "C" {
+#include "grid_cluster.h"
+}
+
+namespace {
+
+// squared distance between two clusters and their indices, heap order puts
+// the smallest first
+struct Pair {
+  double d;
+  int i, j;
+  bool operator<(const Pair &o) const { return std::tie(d, i, j) > std::tie(o.d, o.i, o.j); }
+};
+
+class GridCluster {
+public:
+  int update(int n, int m, const double* pts, const uint64_t* track_ids, double dist, int* labels, int* ids) {
+    // every merge adds a cluster, so at most 2n-1
+    const int max_clusters = std::max(2 * n - 1, 0);
+    this->m = m;
+    centroid.resize(max_clusters * m);
+    size.resize(max_clusters);
+    parent.resize(max_clusters);
+    alive.resize(max_clusters);
+    cell_of.resize(max_clusters);
+    next_in_cell.resize(max_clusters);
+    heap.clear();
+
+    // cells along the first dimension at least the cutoff wide, over the range
+    // of the points. merged centroids stay inside it
+    double lo = INFINITY, hi = -INFINITY;
+    for (int i = 0; i < n; i++) {
+      lo = std::min(lo, pts[i * m]);
+      hi = std::max(hi, pts[i * m]);
+    }
+    const int max_cells = 4 * n + 1;
+    cell_origin = lo;
+    cell_size = std::max(dist > 0 ? std::sqrt(dist) : 0., (hi - lo) / (max_cells - 1));
+    if (!(cell_size > 0)) cell_size = 1.0;
+    cell_heads.assign(n > 0 ? (int)((hi - lo) / cell_size) + 1 : 0, -1);
+
+    for (int i = 0; i < n; i++) {
+      std::copy(pts + i * m, pts + (i + 1) * m, &centroid[i * m]);
+      size[i] = 1;
+      parent[i] = i;
+      alive[i] = true;
+      insert(i);
+    }
+    for (int i = 0; i < n; i++) {
+      add_pairs(i, dist, true);
+    }
+
+    // merge the closest pair until none is closer than the cutoff. pairs with
+    // a cluster that was merged since are stale
+    int count = n;
+    while (!heap.empty()) {
+      std::pop_heap(heap.begin(), heap.end());
+      const auto [d, i, j] = heap.back();
+      heap.pop_back();
+      if (!alive[i] || !alive[j]) continue;
+
+      const int k = count++;
+      for (int l = 0; l < m; l++) {
+        centroid[k * m + l] = (size[i] * centroid[i * m + l] + size[j] * centroid[j * m + l]) / (size[i] + size[j]);
+      }
+      size[k] = size[i] + size[j];
+      parent[i] = parent[j] = parent[k] = k;
+      alive[i] = alive[j] = false;
+      alive[k] = true;
+      insert(k);
+      add_pairs(k, dist, false);
+    }
+
+    // label clusters in order of first appearance
+    root_label.assign(count, -1);
+    int nclust = 0;
+    for (int i = 0; i < n; i++) {
+      int r = i;
+      while (parent[r] != r) r = parent[r];
+      if (root_label[r] < 0) root_label[r] = nclust++;
+      labels[i] = root_label[r];
+    }
+
+    assign_ids(n, track_ids, labels, nclust, ids);
+    return nclust;
+  }
+
+private:
+  // clusters are linked into the list of their cell. merged clusters are left
+  // in their list and skipped because they are no longer alive
+  void insert(int i) {
+    const int cell = std::clamp((int)((centroid[i * m] - cell_origin) / cell_size), 0, (int)cell_heads.size() - 1);
+    cell_of[i] = cell;
+    next_in_cell[i] = cell_heads[cell];
+    cell_heads[cell] = i;
+  }
+
+  // queues the pairs of i with the clusters in its and the neighbouring
+  // cells that are closer than the cutoff. a distance below the cutoff is
+  // below it along the first dimension, so nothing further can match
+  void add_pairs(int i, double dist, bool higher_only) {
+    const int first = std::max(cell_of[i] - 1, 0);
+    const int last = std::min(cell_of[i] + 1, (int)cell_heads.size() - 1);
+    for (int cell = first; cell <= last; cell++) {
+      for (int j = cell_heads[cell]; j >= 0; j = next_in_cell[j]) {
+        if (j == i || !alive[j] || (higher_only && j < i)) continue;
+        double d = 0;
+        for (int l = 0; l < m; l++) {
+          double e = centroid[i * m + l] - centroid[j * m + l];
+          d += e * e;
+        }
+        if (d < dist) {
+          heap.push_back({d, std::min(i, j), std::max(i, j)});
+          std::push_heap(heap.begin(), heap.end());
+        }
+      }
+    }
+  }
+
+  // gives each cluster the id most of its tracks had last time, larger
+  // overlaps first, and new ids to the rest
+  void assign_ids(int n, const uint64_t* track_ids, const int* labels, int nclust, int* ids) {
+    votes.clear();
+    for (int i = 0; i < n; i++) {
+      auto it = std::lower_bound(prev_ids.begin(), prev_ids.end(), std::make_pair(track_ids[i], INT_MIN));
+      if (it != prev_ids.end() && it->first == track_ids[i]) {
+        votes.push_back({0, labels[i], it->second});
+      }
+    }
+    std::sort(votes.begin(), votes.end(), [](auto &a, auto &b) {
+      return std::tie(a[1], a[2]) < std::tie(b[1], b[2]);
+    });
+    // collapse to one entry per (label, id) with its count
+    size_t w = 0;
+    for (size_t r = 0; r < votes.size(); r++) {
+      if (w > 0 && votes[w - 1][1] == votes[r][1] && votes[w - 1][2] == votes[r][2]) {
+        votes[w - 1][0]--;
+      } else {
+        votes[w++] = {-1, votes[r][1], votes[r][2]};
+      }
+    }
+    votes.resize(w);
+    std::sort(votes.begin(), votes.end());
+
+    cluster_id.assign(nclust, -1);
+    used_ids.clear();
+    for (auto &[neg_count, label, id] : votes) {
+      if (cluster_id[label] < 0 && std::find(used_ids.begin(), used_ids.end(), id) == used_ids.end()) {
+        cluster_id[label] = id;
+        used_ids.push_back(id);
+      }
+    }
+    for (int &id : cluster_id) {
+      if (id < 0) id = next_id++;
+    }
+
+    prev_ids.clear();
+    for (int i = 0; i < n; i++) {
+      ids[i] = cluster_id[labels[i]];
+      prev_ids.push_back({track_ids[i], ids[i]});
+    }
+    std::sort(prev_ids.begin(), prev_ids.end());
+  }
+
+  int m;
+
+  std::vector<double> centroid;  // m per cluster, points first then merges
+  std::vector<int> size;
+  std::vector<int> parent;
+  std::vector<char> alive;
+  std::vector<Pair> heap;
+
+  // grid
+  double cell_origin, cell_size;
+  std::vector<int> cell_heads;  // first cluster in the cell, -1 if empty
+  std::vector<int> next_in_cell;
+  std::vector<int> cell_of;
+  std::vector<int> root_label;
+
+  // cluster ids
+  std::vector<std::pair<uint64_t, int>> prev_ids;  // track id, cluster id sorted by track
+  std::vector<std::array<int, 3>> votes;  // -count, label, previous id
+  std::vector<int> cluster_id;
+  std::vector<int> used_ids;
+  int next_id = 0;
+};
+
+}  // namespace
+
+extern "C" {
+
+  void* grid_cluster_init() {
+    return new GridCluster();
+  }
+
+  void grid_cluster_free(void* gc) {
+    delete (GridCluster*)gc;
+  }
+
+  int grid_cluster_update(void* gc, int n, int m, const double* pts, const uint64_t* track_ids, double dist, int* labels, int* ids) {
+    return ((GridCluster*)gc)->update(n, m, pts, track_ids, dist, labels, ids);
+  }
+
+}
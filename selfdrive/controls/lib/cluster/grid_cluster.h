@@ -0,0 +1,37 @@
+#ifndef gridcluster_H
+#define gridcluster_H
+
+#include <stdint.h>
+
+//
+// Centroid linkage clustering of points cut at a squared distance, like
+// cluster_points_centroid, for radard's tracks. Candidate pairs come from a
+// uniform grid along the first dimension with cells at least the size of the
+// cutoff, so only clusters in neighbouring cells are compared and merges stop
+// at the cutoff instead of building the full dendrogram.
+//
+// The clusterer is reused between calls and gives every cluster an id
+// that stays the same across calls as long as it keeps most of its tracks.
+//
+
+void* grid_cluster_init();
+void grid_cluster_free(void* gc);
+
+//
+// Input arguments:
+//   gc        = clusterer from grid_cluster_init
+//   n         = number of points
+//   m         = dimension of the points, the grid is along the first
+//   pts       = n*m array of points
+//   track_ids = n unique ids of the tracks the points belong to
+//   dist      = squared cutoff distance
+// Output arguments:
+//   labels    = allocated array of size n, labels 0, ..., nclust-1 numbered
+//               in order of first appearance like cutree_cdist
+//   ids       = allocated array of size n, persistent id of each point's cluster
+// Return value:
+//   number of clusters
+//
+int grid_cluster_update(void* gc, int n, int m, const double* pts, const uint64_t* track_ids, double dist, int* labels, int* ids);
+
+#endif
@@ -2,6 +2,7 @@
 
 extern "C" {
 #include "fastcluster.h"
+#include "grid_cluster.h"
 }
 
 
@@ -29,6 +30,41 @@ int main(int argc, const char* argv[]){
     assert(idx[i] == correct_idx[i]);
   }
 
+  uint64_t* track_ids = new uint64_t[n];
+  int* ids = new int[n];
+  for (int i = 0; i < n; i++){
+    track_ids[i] = 100 + i;
+  }
+  void* gc = grid_cluster_init();
+  int nclust = grid_cluster_update(gc, n, m, pts, track_ids, 2.5 * 2.5, idx, ids);
+  assert(nclust == 7);
+  for (int i = 0; i < n; i++){
+    assert(idx[i] == correct_idx[i]);
+  }
+
+  // ids stay with their tracks when the points move and come in a different order
+  int* prev_ids = new int[n];
+  for (int i = 0; i < n; i++){
+    prev_ids[n - 1 - i] = ids[i];
+    track_ids[n - 1 - i] = 100 + i;
+  }
+  double* moved = new double[n*m];
+  for (int i = 0; i < n; i++){
+    for (int j = 0; j < m; j++){
+      moved[(n - 1 - i) * m + j] = pts[i * m + j] + 0.5;
+    }
+  }
+  grid_cluster_update(gc, n, m, moved, track_ids, 2.5 * 2.5, idx, ids);
+  for (int i = 0; i < n; i++){
+    assert(ids[i] == prev_ids[i]);
+  }
+  grid_cluster_free(gc);
+
+  delete[] moved;
+  delete[] prev_ids;
+  delete[] ids;
+  delete[] track_ids;
+
   delete[] idx;
   delete[] correct_idx;
   delete[] pts;
@@ -217,15 +217,12 @@ class LongitudinalMpc:
     self.prev_a = np.array(self.a_solution)
     self.j_solution = np.zeros(N)
     self.yref = np.zeros((N+1, COST_DIM))
-    for i in range(N):
-      self.solver.cost_set(i, "yref", self.yref[i])
-    self.solver.cost_set(N, "yref", self.yref[N][:COST_E_DIM])
+    self.solver.cost_set_all("yref", self.yref)
     self.x_sol = np.zeros((N+1, X_DIM))
     self.u_sol = np.zeros((N,1))
     self.params = np.zeros((N+1, PARAM_DIM))
     self.param_tr = T_FOLLOW
-    for i in range(N+1):
-      self.solver.set(i, 'x', np.zeros(X_DIM))
+    self.solver.set_all('x', np.zeros((N+1, X_DIM)))
     self.last_cloudlog_t = 0
     self.status = False
     self.crash_cnt = 0.0
@@ -246,38 +243,30 @@ class LongitudinalMpc:
     _J_EGO_COST = J_EGO_COST * interp(self.v_ego, [0.1, 8.0], [0.1, 0.8])
     _A_CHANGE_COST = A_CHANGE_COST * interp(self.v_ego, [0.1, 8.0], [0.1, 0.8])
     
-    W = np.asfortranarray(np.diag([X_EGO_OBSTACLE_COST, X_EGO_COST, V_EGO_COST, A_EGO_COST, _A_CHANGE_COST, _J_EGO_COST]))
-    for i in range(N):
-      W[4,4] = _A_CHANGE_COST * np.interp(T_IDXS[i], [0.0, 1.0, 2.0], [1.0, 1.0, 0.0])
-      self.solver.cost_set(i, 'W', W)
-    # Setting the slice without the copy make the array not contiguous,
-    # causing issues with the C interface.
-    self.solver.cost_set(N, 'W', np.copy(W[:COST_E_DIM, :COST_E_DIM]))
+    W = np.tile(np.diag([X_EGO_OBSTACLE_COST, X_EGO_COST, V_EGO_COST, A_EGO_COST, _A_CHANGE_COST, _J_EGO_COST]), (N+1, 1, 1))
+    W[:N,4,4] = _A_CHANGE_COST * np.interp(T_IDXS[:N], [0.0, 1.0, 2.0], [1.0, 1.0, 0.0])
+    # the terminal stage uses the leading COST_E_DIM block
+    W[N] = W[N-1]
+    self.solver.cost_set_all('W', W)
 
     # Set L2 slack cost on lower bound constraints
     Zl = np.array([LIMIT_COST, LIMIT_COST, LIMIT_COST, DANGER_ZONE_COST])
-    for i in range(N):
-      self.solver.cost_set(i, 'Zl', Zl)
+    self.solver.cost_set_all('Zl', np.tile(Zl, (N, 1)))
 
   def set_weights_for_xva_policy(self):
-    W = np.asfortranarray(np.diag([0., 10., 1., 10., 0.0, 1.]))
-    for i in range(N):
-      self.solver.cost_set(i, 'W', W)
-    # Setting the slice without the copy make the array not contiguous,
-    # causing issues with the C interface.
-    self.solver.cost_set(N, 'W', np.copy(W[:COST_E_DIM, :COST_E_DIM]))
+    W = np.diag([0., 10., 1., 10., 0.0, 1.])
+    # the terminal stage uses the leading COST_E_DIM block
+    self.solver.cost_set_all('W', np.tile(W, (N+1, 1, 1)))
 
     # Set L2 slack cost on lower bound constraints
     Zl = np.array([LIMIT_COST, LIMIT_COST, LIMIT_COST, 0.0])
-    for i in range(N):
-      self.solver.cost_set(i, 'Zl', Zl)
+    self.solver.cost_set_all('Zl', np.tile(Zl, (N, 1)))
 
   def set_cur_state(self, v, a):
     if abs(self.x0[1] - v) > 2.:
       self.x0[1] = v
       self.x0[2] = a
-      for i in range(0, N+1):
-        self.solver.set(i, 'x', self.x0)
+      self.solver.set_all('x', np.tile(self.x0, (N+1, 1)))
     else:
       self.x0[1] = v
       self.x0[2] = a
@@ -374,16 +363,13 @@ class LongitudinalMpc:
     self.yref[:,1] = x
     self.yref[:,2] = v
     self.yref[:,3] = a
-    for i in range(N):
-      self.solver.cost_set(i, "yref", self.yref[i])
-    self.solver.cost_set(N, "yref", self.yref[N][:COST_E_DIM])
+    self.solver.cost_set_all("yref", self.yref)
     self.params[:,3] = np.copy(self.prev_a)
     self.params[:,4] = self.param_tr
     self.run()
 
   def run(self):
-    for i in range(N+1):
-      self.solver.set(i, 'p', self.params[i])
+    self.solver.set_all('p', self.params)
     self.solver.constraints_set(0, "lbx", self.x0)
     self.solver.constraints_set(0, "ubx", self.x0)
     self.solution_status = self.solver.solve()
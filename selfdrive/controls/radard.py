@@ -9,7 +9,7 @@ from common.numpy_fast import interp
 from common.params import Params
 from common.realtime import Ratekeeper, Priority, config_realtime_process
 from selfdrive.config import RADAR_TO_CAMERA
-from selfdrive.controls.lib.cluster.fastcluster_py import cluster_points_centroid
+from selfdrive.controls.lib.cluster.fastcluster_py import GridCluster
 from selfdrive.controls.lib.radar_helpers import Cluster, Track
 from selfdrive.swaglog import cloudlog
 from selfdrive.hardware import TICI
@@ -96,6 +96,7 @@ class RadarD():
     self.current_time = 0
 
     self.tracks = defaultdict(dict)
+    self.clusterer = GridCluster()
     self.kalman_params = KalmanParams(radar_ts)
 
     # v_ego
@@ -137,9 +138,9 @@ class RadarD():
     idens = list(sorted(self.tracks.keys()))
     track_pts = [self.tracks[iden].get_key_for_cluster() for iden in idens]
 
-    # If we have multiple points, cluster them
-    if len(track_pts) > 1:
-      cluster_idxs = cluster_points_centroid(track_pts, 2.5)
+    # If we have points, cluster them
+    if len(track_pts) > 0:
+      cluster_idxs = self.clusterer.update(idens, track_pts, 2.5)
       clusters = [None] * (max(cluster_idxs) + 1)
 
       for idx in range(len(track_pts)):
@@ -147,11 +148,6 @@ class RadarD():
         if clusters[cluster_i] is None:
           clusters[cluster_i] = Cluster()
         clusters[cluster_i].add(self.tracks[idens[idx]])
-    elif len(track_pts) == 1:
-      # FIXME: cluster_point_centroid hangs forever if len(track_pts) == 1
-      cluster_idxs = [0]
-      clusters = [Cluster()]
-      clusters[0].add(self.tracks[idens[0]])
     else:
       clusters = []
 
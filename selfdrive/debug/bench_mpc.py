@@ -0,0 +1,80 @@
+#!/usr/bin/env python3
+# Time per planner tick of the longitudinal and lateral MPC, and of setting the
+# stage data stage by stage as the planners used to compared to the bulk setters.
+import argparse
+import time
+
+import numpy as np
+
+import cereal.messaging as messaging
+from selfdrive.controls.lib.lateral_mpc_lib import lat_mpc
+from selfdrive.controls.lib.longitudinal_mpc_lib import long_mpc
+
+
+def timeit(f, ticks):
+  f()  # warm up
+  t = time.monotonic()
+  for _ in range(ticks):
+    f()
+  return (time.monotonic() - t) / ticks * 1e6
+
+
+def long_setters_per_stage(mpc):
+  N = long_mpc.N
+  for i in range(N):
+    mpc.solver.cost_set(i, "yref", mpc.yref[i])
+  mpc.solver.cost_set(N, "yref", mpc.yref[N][:long_mpc.COST_E_DIM])
+  for i in range(N+1):
+    mpc.solver.set(i, 'p', mpc.params[i])
+
+
+def long_setters_bulk(mpc):
+  mpc.solver.cost_set_all("yref", mpc.yref)
+  mpc.solver.set_all('p', mpc.params)
+
+
+def lat_setters_per_stage(mpc):
+  N = lat_mpc.N
+  for i in range(N):
+    mpc.solver.cost_set(i, "yref", mpc.yref[i])
+  mpc.solver.cost_set(N, "yref", mpc.yref[N][:2])
+
+
+def lat_setters_bulk(mpc):
+  mpc.solver.cost_set_all("yref", mpc.yref)
+
+
+if __name__ == "__main__":
+  parser = argparse.ArgumentParser(description="Benchmark the MPC planner ticks")
+  parser.add_argument("--ticks", type=int, default=2000)
+  args = parser.parse_args()
+
+  # a lead 30m ahead while cruising at 20m/s
+  carstate = messaging.new_message('carState').carState
+  carstate.vEgo = 20.
+  carstate.cruiseGap = 2
+  radarstate = messaging.new_message('radarState').radarState
+  radarstate.leadOne.status = True
+  radarstate.leadOne.dRel = 30.
+  radarstate.leadOne.vLead = 18.
+  radarstate.leadOne.aLeadTau = 1.5
+
+  lon = long_mpc.LongitudinalMpc()
+  lon.set_accel_limits(-1.2, 1.2)
+  lon.set_cur_state(20., 0.)
+
+  lat = lat_mpc.LateralMpc()
+  lat.set_weights(1., 1., 1.)
+  y_pts = np.linspace(0., 1., lat_mpc.N+1)
+  heading_pts = np.linspace(0., 0.05, lat_mpc.N+1)
+
+  results = [
+    ("long tick", timeit(lambda: lon.update(carstate, radarstate, 25.), args.ticks)),
+    ("long setters per stage", timeit(lambda: long_setters_per_stage(lon), args.ticks)),
+    ("long setters bulk", timeit(lambda: long_setters_bulk(lon), args.ticks)),
+    ("lat tick", timeit(lambda: lat.run(np.zeros(lat_mpc.X_DIM), 20., 100., y_pts, heading_pts), args.ticks)),
+    ("lat setters per stage", timeit(lambda: lat_setters_per_stage(lat), args.ticks)),
+    ("lat setters bulk", timeit(lambda: lat_setters_bulk(lat), args.ticks)),
+  ]
+  for name, us in results:
+    print(f"{name:24} {us:8.1f} us")
@@ -0,0 +1,66 @@
+#!/usr/bin/env python3
+# Time from process start to first output for camerad and modeld, with an
+# empty OpenCL program cache (every program built from source) and with a warm one.
+import argparse
+import os
+import shutil
+import tempfile
+import time
+
+import numpy as np
+
+import cereal.messaging as messaging
+from selfdrive.manager.process_config import managed_processes
+
+TIMEOUT = 60.
+
+
+def time_to_first(proc, service):
+  sock = messaging.sub_sock(service, conflate=True, timeout=100)
+  start = time.monotonic()
+  managed_processes[proc].start()
+  while time.monotonic() - start < TIMEOUT:
+    if messaging.recv_one(sock) is not None:
+      return time.monotonic() - start
+  raise TimeoutError(f"no {service} from {proc} after {TIMEOUT}s")
+
+
+def run(cache_dir):
+  os.environ["CL_CACHE_DIR"] = cache_dir
+  try:
+    camerad = time_to_first("camerad", "roadCameraState")
+    modeld = time_to_first("modeld", "modelV2")
+  finally:
+    managed_processes["modeld"].stop()
+    managed_processes["camerad"].stop()
+  return camerad, modeld
+
+
+def report(name, times):
+  times = np.array(times)
+  print(f"{name:5} camerad {np.mean(times[:, 0]):6.2f}s (min {np.min(times[:, 0]):.2f}s)   "
+        f"modeld {np.mean(times[:, 1]):6.2f}s (min {np.min(times[:, 1]):.2f}s)")
+
+
+if __name__ == "__main__":
+  parser = argparse.ArgumentParser(description="Benchmark camerad and modeld startup with and without the OpenCL program cache")
+  parser.add_argument("--runs", type=int, default=5)
+  args = parser.parse_args()
+
+  cold, warm = [], []
+  warm_dir = tempfile.mkdtemp(prefix="cl_cache_")
+  try:
+    run(warm_dir)  # fill the cache
+    for i in range(args.runs):
+      cold_dir = tempfile.mkdtemp(prefix="cl_cache_")
+      try:
+        cold.append(run(cold_dir))
+      finally:
+        shutil.rmtree(cold_dir)
+      warm.append(run(warm_dir))
+      print(f"run {i}: cold {cold[-1][0]:.2f}s {cold[-1][1]:.2f}s, warm {warm[-1][0]:.2f}s {warm[-1][1]:.2f}s")
+  finally:
+    shutil.rmtree(warm_dir)
+
+  report("cold", cold)
+  report("warm", warm)
@@ -0,0 +1,44 @@
+#!/usr/bin/env python3
+# Clusters the radar tracks logged in liveTracks with both the full hierarchical
+# clustering and GridCluster, and reports frames where the labels differ.
+import argparse
+import time
+
+from selfdrive.controls.lib.cluster.fastcluster_py import GridCluster, cluster_points_centroid
+from tools.lib.logreader import MultiLogIterator
+from tools.lib.route import Route
+
+if __name__ == "__main__":
+  parser = argparse.ArgumentParser(description="Compare radard's cluster labels on the liveTracks of a route")
+  parser.add_argument("route", help="route name")
+  args = parser.parse_args()
+
+  lr = MultiLogIterator(Route(args.route).log_paths())
+  grid = GridCluster()
+
+  frames, mismatches = 0, 0
+  t_full, t_grid = 0., 0.
+  for msg in lr:
+    if msg.which() != "liveTracks" or len(msg.liveTracks) == 0:
+      continue
+
+    # same key as Track.get_key_for_cluster
+    track_ids = [t.trackId for t in msg.liveTracks]
+    pts = [[t.dRel, t.yRel*2, t.vRel] for t in msg.liveTracks]
+
+    t1 = time.monotonic()
+    labels = cluster_points_centroid(pts, 2.5) if len(pts) > 1 else [0]
+    t2 = time.monotonic()
+    grid_labels = grid.update(track_ids, pts, 2.5)
+    t3 = time.monotonic()
+    t_full += t2 - t1
+    t_grid += t3 - t2
+
+    frames += 1
+    if labels != grid_labels:
+      mismatches += 1
+      print(f"mismatch at {msg.logMonoTime}: {labels} != {grid_labels}")
+
+  print(f"{frames} frames, {mismatches} mismatches")
+  if frames > 0:
+    print(f"full {t_full / frames * 1e6:.1f} us/frame, grid {t_grid / frames * 1e6:.1f} us/frame")
@@ -0,0 +1,56 @@
+#include "selfdrive/locationd/locationd.h"
+#include "selfdrive/locationd/ublox_msg.h"
+#include "selfdrive/test/process_replay/inprocess_replay.h"
+
+// locationd and ubloxd for the in-process replay, their main loops without msgq:
+//   inprocess_replay locationd [-o output] <rlog>...
+
+// Localizer::locationd_thread, except for saving the last gps position
+class LocationdReplay : public ReplayProcess {
+public:
+  std::vector<const char *> inputs() const override {
+    return {"gpsLocationExternal", "sensorEvents", "cameraOdometry", "liveCalibration", "carState"};
+  }
+
+  void handle(const char *service, const cereal::Event::Reader &event, ReplayContext &ctx) override {
+    if (event.getValid()) {
+      localizer.handle_msg(event);
+    }
+
+    if (event.isCameraOdometry()) {
+      bool inputsOK = ctx.allAliveAndValid({"gpsLocationExternal"});
+      bool sensorsOK = ctx.alive("sensorEvents") && ctx.valid("sensorEvents");
+
+      MessageBuilder msg_builder;
+      auto bytes = localizer.get_message_bytes(msg_builder, ctx.time(), inputsOK, sensorsOK, localizer.isGpsOK());
+      ctx.send("liveLocationKalman", bytes);
+    }
+  }
+
+private:
+  Localizer localizer;
+};
+
+class UbloxdReplay : public ReplayProcess {
+public:
+  std::vector<const char *> inputs() const override {
+    return {"ubloxRaw"};
+  }
+
+  void handle(const char *service, const cereal::Event::Reader &event, ReplayContext &ctx) override {
+    auto ubloxRaw = event.getUbloxRaw();
+    parser.process(ubloxRaw.begin(), ubloxRaw.size(), [&](const std::string &service, kj::Array<capnp::word> msg) {
+      ctx.send(service.c_str(), msg.asPtr());
+    });
+  }
+
+private:
+  UbloxMsgParser parser;
+};
+
+int main(int argc, char **argv) {
+  return inprocess_replay_main(argc, argv, {
+    {"locationd", [] { return std::make_unique<LocationdReplay>(); }},
+    {"ubloxd", [] { return std::make_unique<UbloxdReplay>(); }},
+  });
+}
@@ -529,10 +529,3 @@ int Localizer::locationd_thread() {
   }
   return 0;
 }
-
-int main() {
-  util::set_realtime_priority(5);
-
-  Localizer localizer;
-  return localizer.locationd_thread();
-}
@@ -0,0 +1,272 @@
+#include <getopt.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <future>
+#include <map>
+#include <mutex>
+#include <regex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "cereal/services.h"
+#include "selfdrive/common/timing.h"
+#include "selfdrive/locationd/locationd.h"
+#include "selfdrive/ui/replay/filereader.h"
+#include "selfdrive/ui/replay/util.h"
+
+// Runs locationd over rlogs offline, as fast as the cpu allows, and writes the
+// liveLocationKalman it would have published to a file.
+//
+// Consecutive segments of a route are one chain and go through the same
+// Localizer in order, so the filter state carries over like it does on the
+// device. A chain ends at a missing segment: the gap is longer than the 10s
+// after which locationd resets the filter anyway. Chains run in parallel and
+// their output is written in input order.
+
+const char *usage = "usage: locationd_replay [-j threads] <output> <rlog>...\n";
+
+const std::vector<const char *> INPUTS = {"gpsLocationExternal", "sensorEvents", "cameraOdometry", "liveCalibration", "carState"};
+
+enum Handler { SENSORS, GPS, CAM_ODO, CAR_STATE, LIVE_CALIB, HANDLER_COUNT };
+const char *handler_names[HANDLER_COUNT] = {"sensors", "gps", "cam_odo", "car_state", "live_calib"};
+
+struct Stats {
+  uint64_t events = 0;      // all events in the logs
+  uint64_t count[HANDLER_COUNT] = {};
+  double time[HANDLER_COUNT] = {};  // seconds in handle_msg
+  double load_time = 0;     // seconds reading and decompressing logs
+
+  void add(const Stats &s) {
+    events += s.events;
+    for (int i = 0; i < HANDLER_COUNT; i++) {
+      count[i] += s.count[i];
+      time[i] += s.time[i];
+    }
+    load_time += s.load_time;
+  }
+};
+
+struct Chain {
+  std::vector<std::string> logs;
+  std::string output;
+  Stats stats;
+  bool done = false;
+};
+
+// SubMaster's alive and valid for the locationd inputs, on log time
+class InputTracker {
+  struct Input {
+    int freq = 0;
+    uint64_t rcv_time = 0;
+    bool seen = false, valid = true;
+  };
+
+public:
+  InputTracker() {
+    for (auto name : INPUTS) {
+      for (const auto &s : services) {
+        if (strcmp(s.name, name) == 0) inputs[name].freq = s.frequency;
+      }
+    }
+  }
+
+  void update(const std::string &name, uint64_t t, bool valid) {
+    Input &in = inputs.at(name);
+    in.rcv_time = t;
+    in.seen = true;
+    in.valid = valid;
+  }
+
+  bool alive(const Input &in, uint64_t t) const {
+    return in.seen && (in.freq <= 1e-5 || (int64_t)(t - in.rcv_time) * 1e-9 < 10.0 / in.freq);
+  }
+
+  bool ok(const char *name, uint64_t t) const {
+    const Input &in = inputs.at(name);
+    return alive(in, t) && in.valid;
+  }
+
+  bool all_ok(uint64_t t) const {
+    for (auto &[name, in] : inputs) {
+      // gpsLocationExternal is in locationd's ignore_alive
+      if (!in.valid || (!alive(in, t) && name != "gpsLocationExternal")) return false;
+    }
+    return true;
+  }
+
+private:
+  std::map<std::string, Input> inputs;
+};
+
+static std::string read_log(const std::string &path) {
+  std::string data = FileReader(false).read(path);
+  if (data.empty()) return {};
+  return data.compare(0, 3, "BZh") == 0 ? decompressBZ2(data) : data;
+}
+
+static void run_chain(Chain &chain) {
+  Localizer localizer;
+  InputTracker tracker;
+
+  auto load = [](const std::string &path) {
+    double t1 = millis_since_boot();
+    std::string raw = read_log(path);
+    return std::make_pair(raw, (millis_since_boot() - t1) / 1000.);
+  };
+
+  // decompress the next segment while this one runs
+  std::future<std::pair<std::string, double>> next = std::async(std::launch::async, load, chain.logs[0]);
+  for (int i = 0; i < chain.logs.size(); i++) {
+    auto [raw, load_time] = next.get();
+    if (i + 1 < chain.logs.size()) {
+      next = std::async(std::launch::async, load, chain.logs[i + 1]);
+    }
+    chain.stats.load_time += load_time;
+    if (raw.empty()) {
+      fprintf(stderr, "failed to read %s\n", chain.logs[i].c_str());
+      continue;
+    }
+
+    kj::ArrayPtr<const capnp::word> words((const capnp::word *)raw.data(), raw.size() / sizeof(capnp::word));
+    try {
+      while (words.size() > 0) {
+        capnp::ReaderOptions options;
+        options.traversalLimitInWords = kj::maxValue;
+        capnp::FlatArrayMessageReader reader(words, options);
+        words = kj::arrayPtr(reader.getEnd(), words.end());
+        chain.stats.events++;
+
+        cereal::Event::Reader event = reader.getRoot<cereal::Event>();
+        Handler handler;
+        const char *name;
+        switch (event.which()) {
+          case cereal::Event::SENSOR_EVENTS: handler = SENSORS, name = "sensorEvents"; break;
+          case cereal::Event::GPS_LOCATION_EXTERNAL: handler = GPS, name = "gpsLocationExternal"; break;
+          case cereal::Event::CAMERA_ODOMETRY: handler = CAM_ODO, name = "cameraOdometry"; break;
+          case cereal::Event::CAR_STATE: handler = CAR_STATE, name = "carState"; break;
+          case cereal::Event::LIVE_CALIBRATION: handler = LIVE_CALIB, name = "liveCalibration"; break;
+          default: continue;
+        }
+
+        const uint64_t t = event.getLogMonoTime();
+        tracker.update(name, t, event.getValid());
+        // locationd_thread only handles valid messages
+        if (event.getValid()) {
+          double t1 = nanos_since_boot();
+          localizer.handle_msg(event);
+          chain.stats.time[handler] += (nanos_since_boot() - t1) * 1e-9;
+          chain.stats.count[handler]++;
+        }
+
+        if (handler == CAM_ODO) {
+          MessageBuilder msg;
+          auto bytes = localizer.get_message_bytes(msg, t, tracker.all_ok(t), tracker.ok("sensorEvents", t), localizer.isGpsOK());
+          chain.output.append((const char *)bytes.begin(), bytes.size());
+        }
+      }
+    } catch (const kj::Exception &e) {
+      fprintf(stderr, "failed to parse %s: %s\n", chain.logs[i].c_str(), e.getDescription().cStr());
+    }
+  }
+}
+
+// group the logs into chains of consecutive segments of the same route
+static std::vector<Chain> make_chains(const std::vector<std::string> &logs) {
+  const std::regex segment_regex("([a-z0-9]{16}[|_/][0-9]{4}-[0-9]{2}-[0-9]{2}--[0-9]{2}-[0-9]{2}-[0-9]{2})--([0-9]+)");
+  std::vector<Chain> chains;
+  std::string last_route;
+  int last_segment = -1;
+  for (const std::string &log : logs) {
+    std::smatch match;
+    std::string route;
+    int segment = -1;
+    if (std::regex_search(log, match, segment_regex)) {
+      route = match[1].str();
+      route[16] = '|';
+      segment = std::stoi(match[2].str());
+    }
+    if (chains.empty() || route.empty() || route != last_route || segment != last_segment + 1) {
+      chains.emplace_back();
+    }
+    chains.back().logs.push_back(log);
+    last_route = route;
+    last_segment = segment;
+  }
+  return chains;
+}
+
+int main(int argc, char **argv) {
+  int threads = std::thread::hardware_concurrency();
+  int opt;
+  while ((opt = getopt(argc, argv, "j:")) != -1) {
+    switch (opt) {
+      case 'j': threads = std::atoi(optarg); break;
+      default: fprintf(stderr, "%s", usage); return 1;
+    }
+  }
+  if (argc - optind < 2 || threads < 1) {
+    fprintf(stderr, "%s", usage);
+    return 1;
+  }
+
+  FILE *out = fopen(argv[optind], "wb");
+  if (!out) {
+    fprintf(stderr, "failed to open %s\n", argv[optind]);
+    return 1;
+  }
+  std::vector<Chain> chains = make_chains(std::vector<std::string>(argv + optind + 1, argv + argc));
+  threads = std::min<int>(threads, chains.size());
+  printf("%d logs in %zu chains on %d threads\n", argc - optind - 1, chains.size(), threads);
+
+  std::mutex lock;
+  std::atomic<int> next_chain = 0;
+  int next_write = 0;
+  Stats stats;
+  const double start = millis_since_boot();
+
+  auto worker = [&]() {
+    for (int i = next_chain++; i < chains.size(); i = next_chain++) {
+      run_chain(chains[i]);
+
+      std::lock_guard lk(lock);
+      chains[i].done = true;
+      // write whatever is ready in input order
+      for (; next_write < chains.size() && chains[next_write].done; next_write++) {
+        Chain &c = chains[next_write];
+        fwrite(c.output.data(), 1, c.output.size(), out);
+        stats.add(c.stats);
+        c.output = std::string();
+      }
+    }
+  };
+  std::vector<std::thread> workers;
+  for (int i = 0; i < threads; i++) {
+    workers.emplace_back(worker);
+  }
+  for (auto &t : workers) {
+    t.join();
+  }
+  fclose(out);
+
+  const double wall = (millis_since_boot() - start) / 1000.;
+  uint64_t handled = 0;
+  double handle_time = 0;
+  for (int i = 0; i < HANDLER_COUNT; i++) {
+    handled += stats.count[i];
+    handle_time += stats.time[i];
+  }
+  printf("%lu events, %lu handled in %.2fs: %.0f events/s, %.0f handled/s\n",
+         stats.events, handled, wall, stats.events / wall, handled / wall);
+  printf("cpu time: %.2fs loading logs, %.2fs in handle_msg\n", stats.load_time, handle_time);
+  for (int i = 0; i < HANDLER_COUNT; i++) {
+    if (stats.count[i] == 0) continue;
+    printf("  %-10s %10lu msgs %8.2f us/msg %8.2fs\n", handler_names[i], stats.count[i],
+           stats.time[i] / stats.count[i] * 1e6, stats.time[i]);
+  }
+  return 0;
+}
@@ -42,30 +42,28 @@ LiveKalman::LiveKalman() {
   }
 
   // init filter
-  this->filter = std::make_shared<EKFSym>(this->name, get_mapmat(this->Q), get_mapvec(this->initial_x),
-    get_mapmat(initial_P),  this->dim_state, this->dim_state_err, 0, 0, 0, std::vector<int>(),
-    std::vector<int>{3}, std::vector<std::string>(), 0.2);
+  this->filter = std::make_shared<Filter>(this->name, this->Q, this->initial_x, this->initial_P, std::vector<int>{3}, 0.2);
 }
 
 void LiveKalman::init_state(VectorXd& state, VectorXd& covs_diag, double filter_time) {
-  MatrixXdr covs = covs_diag.asDiagonal();
-  this->filter->init_state(get_mapvec(state), get_mapmat(covs), filter_time);
+  Filter::MatrixP covs = covs_diag.asDiagonal();
+  this->filter->init_state(state, covs, filter_time);
 }
 
 void LiveKalman::init_state(VectorXd& state, MatrixXdr& covs, double filter_time) {
-  this->filter->init_state(get_mapvec(state), get_mapmat(covs), filter_time);
+  this->filter->init_state(state, covs, filter_time);
 }
 
 void LiveKalman::init_state(VectorXd& state, double filter_time) {
-  MatrixXdr covs = this->filter->covs();
-  this->filter->init_state(get_mapvec(state), get_mapmat(covs), filter_time);
+  Filter::MatrixP covs = this->filter->covs();
+  this->filter->init_state(state, covs, filter_time);
 }
 
-VectorXd LiveKalman::get_x() {
+const LiveKalman::Filter::VectorX &LiveKalman::get_x() {
   return this->filter->state();
 }
 
-MatrixXdr LiveKalman::get_P() {
+const LiveKalman::Filter::MatrixP &LiveKalman::get_P() {
   return this->filter->covs();
 }
 
@@ -81,13 +79,12 @@ std::vector<MatrixXdr> LiveKalman::get_R(int kind, int n) {
   return R;
 }
 
-std::optional<Estimate> LiveKalman::predict_and_observe(double t, int kind, std::vector<VectorXd> meas, std::vector<MatrixXdr> R) {
-  std::optional<Estimate> r;
+bool LiveKalman::predict_and_observe(double t, int kind, const std::vector<VectorXd> &meas, const std::vector<MatrixXdr> &R,
+                                     Filter::Estimate *res) {
   if (R.size() == 0) {
-    R = this->get_R(kind, meas.size());
+    return this->filter->predict_and_update_batch(t, kind, meas, this->get_R(kind, meas.size()), res);
   }
-  r = this->filter->predict_and_update_batch(t, kind, get_vec_mapvec(meas), get_vec_mapmat(R));
-  return r;
+  return this->filter->predict_and_update_batch(t, kind, meas, R, res);
 }
 
 void LiveKalman::predict(double t) {
@@ -9,6 +9,7 @@
 
 #include "generated/live_kf_constants.h"
 #include "rednose/helpers/ekf_sym.h"
+#include "rednose/helpers/ekf_sym_fixed.h"
 
 #define EARTH_GM 3.986005e14  // m^3/s^2 (gravitational constant * mass of earth)
 
@@ -21,18 +22,22 @@ std::vector<Eigen::Map<MatrixXdr>> get_vec_mapmat(std::vector<MatrixXdr>& mat_ve
 
 class LiveKalman {
 public:
+  typedef EKFSymFixed<LIVE_DIM_STATE, LIVE_DIM_STATE_ERR, LIVE_DIM_OBS> Filter;
+
   LiveKalman();
 
   void init_state(Eigen::VectorXd& state, Eigen::VectorXd& covs_diag, double filter_time);
   void init_state(Eigen::VectorXd& state, MatrixXdr& covs, double filter_time);
   void init_state(Eigen::VectorXd& state, double filter_time);
 
-  Eigen::VectorXd get_x();
-  MatrixXdr get_P();
+  const Filter::VectorX &get_x();
+  const Filter::MatrixP &get_P();
   double get_filter_time();
   std::vector<MatrixXdr> get_R(int kind, int n);
 
-  std::optional<Estimate> predict_and_observe(double t, int kind, std::vector<Eigen::VectorXd> meas, std::vector<MatrixXdr> R = {});
+  // res is only filled in when given
+  bool predict_and_observe(double t, int kind, const std::vector<Eigen::VectorXd> &meas, const std::vector<MatrixXdr> &R = {},
+                           Filter::Estimate *res = nullptr);
   std::optional<Estimate> predict_and_update_odo_speed(std::vector<Eigen::VectorXd> speed, double t, int kind);
   std::optional<Estimate> predict_and_update_odo_trans(std::vector<Eigen::VectorXd> trans, double t, int kind);
   std::optional<Estimate> predict_and_update_odo_rot(std::vector<Eigen::VectorXd> rot, double t, int kind);
@@ -49,7 +54,7 @@ public:
 private:
   std::string name = "live";
 
-  std::shared_ptr<EKFSym> filter;
+  std::shared_ptr<Filter> filter;
 
   int dim_state;
   int dim_state_err;
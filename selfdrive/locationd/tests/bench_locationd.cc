@@ -0,0 +1,88 @@
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "selfdrive/common/timing.h"
+#include "selfdrive/common/util.h"
+#include "selfdrive/locationd/locationd.h"
+
+// Feeds the locationd inputs of a route, dumped with dump_locationd_events.py,
+// through Localizer::handle_msg as fast as possible and reports the time per
+// message by service. On cameraOdometry it also builds liveLocationKalman the
+// way locationd_thread does.
+//
+// usage: bench_locationd <events> [passes]
+
+struct Stats {
+  int count = 0;
+  double total_us = 0;
+};
+
+int main(int argc, char **argv) {
+  if (argc < 2) {
+    printf("usage: %s <events> [passes]\n", argv[0]);
+    return 1;
+  }
+  const int passes = argc > 2 ? std::atoi(argv[2]) : 1;
+
+  std::string data = util::read_file(argv[1]);
+  if (data.empty()) {
+    printf("failed to read %s\n", argv[1]);
+    return 1;
+  }
+  auto words = kj::heapArray<capnp::word>(data.size() / sizeof(capnp::word));
+  memcpy(words.begin(), data.data(), words.size() * sizeof(capnp::word));
+
+  std::vector<kj::ArrayPtr<const capnp::word>> events;
+  kj::ArrayPtr<const capnp::word> remaining = words;
+  while (remaining.size() > 0) {
+    capnp::FlatArrayMessageReader reader(remaining);
+    const capnp::word *end = reader.getEnd();
+    events.push_back(kj::arrayPtr(remaining.begin(), end));
+    remaining = kj::arrayPtr(end, remaining.end());
+  }
+  printf("%zu events\n", events.size());
+
+  std::map<std::string, Stats> stats;
+  Stats total, live_location;
+  for (int pass = 0; pass < passes; pass++) {
+    Localizer localizer;
+    for (auto &event : events) {
+      capnp::FlatArrayMessageReader reader(event);
+      cereal::Event::Reader log = reader.getRoot<cereal::Event>();
+
+      double t1 = nanos_since_boot();
+      localizer.handle_msg(log);
+      double t2 = nanos_since_boot();
+
+      Stats &s = stats[log.isSensorEvents() ? "sensorEvents" :
+                       log.isGpsLocationExternal() ? "gpsLocationExternal" :
+                       log.isCarState() ? "carState" :
+                       log.isCameraOdometry() ? "cameraOdometry" :
+                       log.isLiveCalibration() ? "liveCalibration" : "other"];
+      s.count++;
+      s.total_us += (t2 - t1) / 1e3;
+      total.count++;
+      total.total_us += (t2 - t1) / 1e3;
+
+      if (log.isCameraOdometry()) {
+        MessageBuilder msg;
+        double t3 = nanos_since_boot();
+        localizer.get_message_bytes(msg, log.getLogMonoTime(), true, true, localizer.isGpsOK());
+        live_location.count++;
+        live_location.total_us += (nanos_since_boot() - t3) / 1e3;
+      }
+    }
+  }
+
+  for (auto &[name, s] : stats) {
+    printf("%-20s %8d msgs %8.2f us/msg\n", name.c_str(), s.count, s.total_us / s.count);
+  }
+  if (live_location.count > 0) {
+    printf("%-20s %8d msgs %8.2f us/msg\n", "liveLocationKalman", live_location.count, live_location.total_us / live_location.count);
+  }
+  printf("handle_msg: %.0f msgs/s\n", total.count / (total.total_us / 1e6));
+  return 0;
+}
@@ -0,0 +1,22 @@
+#!/usr/bin/env python3
+import argparse
+
+from tools.lib.logreader import LogReader
+
+SERVICES = {"sensorEvents", "gpsLocationExternal", "carState", "cameraOdometry", "liveCalibration"}
+
+if __name__ == "__main__":
+  parser = argparse.ArgumentParser(description="Write the locationd inputs of rlogs to a file for bench_locationd")
+  parser.add_argument("out", help="output file")
+  parser.add_argument("logs", nargs="+", help="rlog paths or urls")
+  args = parser.parse_args()
+
+  count = 0
+  with open(args.out, "wb") as f:
+    for log in args.logs:
+      for msg in LogReader(log):
+        if msg.which() in SERVICES:
+          f.write(msg.as_builder().to_bytes())
+          count += 1
+
+  print(f"wrote {count} events")
@@ -0,0 +1,16 @@
+#!/usr/bin/env python3
+import argparse
+
+from tools.lib.logreader import LogReader
+
+if __name__ == "__main__":
+  parser = argparse.ArgumentParser(description="Write the ubloxRaw stream of rlogs to a file for test_ublox_parser")
+  parser.add_argument("out", help="output file")
+  parser.add_argument("logs", nargs="+", help="rlog paths or urls")
+  args = parser.parse_args()
+
+  with open(args.out, "wb") as f:
+    for log in args.logs:
+      for msg in LogReader(log):
+        if msg.which() == "ubloxRaw":
+          f.write(msg.ubloxRaw)
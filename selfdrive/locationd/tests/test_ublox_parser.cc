@@ -0,0 +1,172 @@
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "selfdrive/common/timing.h"
+#include "selfdrive/common/util.h"
+#include "selfdrive/locationd/tests/ublox_kaitai.h"
+#include "selfdrive/locationd/ublox_msg.h"
+
+// Checks UbloxMsgParser against the kaitai reference on a raw ublox stream
+// (see dump_ublox_raw.py), on randomly mutated copies of its messages, and
+// benchmarks both per message type.
+
+struct Result {
+  bool error;
+  std::string service;
+  std::string data;
+};
+
+template <typename F>
+static Result run(F gen) {
+  try {
+    auto [service, words] = gen();
+    auto bytes = words.asBytes();
+    return {false, service, std::string(bytes.begin(), bytes.end())};
+  } catch (const std::exception &e) {
+    return {true, "", ""};
+  }
+}
+
+static bool load(UbloxMsgParser &parser, const std::string &msg) {
+  parser.reset();
+  size_t consumed = 0;
+  return parser.add_data((const uint8_t *)msg.data(), msg.size(), consumed) && consumed == msg.size();
+}
+
+static std::string fix_checksum(std::string msg) {
+  uint8_t ck_a = 0, ck_b = 0;
+  for (int i = 2; i < msg.size() - 2; i++) {
+    ck_a += (uint8_t)msg[i];
+    ck_b += ck_a;
+  }
+  msg[msg.size() - 2] = ck_a;
+  msg[msg.size() - 1] = ck_b;
+  return msg;
+}
+
+static int compare(UbloxMsgParser &parser, KaitaiUbloxMsgParser &kaitai_parser, const std::string &msg) {
+  if (!load(parser, msg)) return 0;
+  Result view = run([&]() { return parser.gen_msg(); });
+  Result ref = run([&]() { return kaitai_parser.gen_msg(msg); });
+  if (view.error != ref.error || view.service != ref.service || view.data != ref.data) {
+    printf("mismatch on msg type %02x%02x len %zu: error %d/%d, size %zu/%zu\n", (uint8_t)msg[2], (uint8_t)msg[3],
+           msg.size(), view.error, ref.error, view.data.size(), ref.data.size());
+    return 1;
+  }
+  return 0;
+}
+
+// runs f in a child, so a parser aborting on a malformed message is reported
+// as a failure instead of ending the test
+template <typename F>
+static int without_abort(const char *name, F f) {
+  fflush(stdout);
+  pid_t pid = fork();
+  if (pid == 0) {
+    int ret = f();
+    fflush(stdout);
+    _exit(ret);
+  }
+  int status = 0;
+  waitpid(pid, &status, 0);
+  if (WIFSIGNALED(status)) {
+    printf("%s: aborted with signal %d\n", name, WTERMSIG(status));
+    return 1;
+  }
+  return WEXITSTATUS(status);
+}
+
+int main(int argc, char *argv[]) {
+  if (argc < 2) {
+    printf("usage: %s <ublox raw file> [fuzz iterations]\n", argv[0]);
+    return 1;
+  }
+  const int fuzz_iterations = argc > 2 ? atoi(argv[2]) : 100000;
+
+  // split the stream into messages
+  std::string raw = util::read_file(argv[1]);
+  std::vector<std::string> msgs;
+  UbloxMsgParser splitter;
+  for (size_t pos = 0; pos < raw.size();) {
+    size_t consumed = 0;
+    if (splitter.add_data((const uint8_t *)raw.data() + pos, raw.size() - pos, consumed)) {
+      msgs.push_back(splitter.data());
+      splitter.reset();
+    }
+    pos += consumed;
+  }
+  printf("%zu messages\n", msgs.size());
+  if (msgs.empty()) return 1;
+
+  int failures = without_abort("recorded", [&]() {
+    int mismatches = 0;
+    UbloxMsgParser parser;
+    KaitaiUbloxMsgParser kaitai_parser;
+    for (auto &msg : msgs) {
+      mismatches += compare(parser, kaitai_parser, msg);
+    }
+    printf("recorded: %d mismatches\n", mismatches);
+    return mismatches > 0;
+  });
+
+  int fuzz_failures = without_abort("fuzzed", [&]() {
+    std::mt19937 rng(0);
+    int mismatches = 0;
+    UbloxMsgParser parser;
+    KaitaiUbloxMsgParser kaitai_parser;
+    for (int i = 0; i < fuzz_iterations; i++) {
+      std::string msg = msgs[rng() % msgs.size()];
+      // mutate the payload only, the length has to match for the message to be framed
+      int payload_len = msg.size() - ublox::UBLOX_HEADER_SIZE - ublox::UBLOX_CHECKSUM_SIZE;
+      if (payload_len <= 0) continue;
+      for (int n = 1 + rng() % 4; n > 0; n--) {
+        msg[ublox::UBLOX_HEADER_SIZE + rng() % payload_len] = rng();
+      }
+      // RXM-SFRBX with a GPS gnss id and a word count other than 10
+      if (msg[2] == 0x02 && msg[3] == 0x13 && payload_len > 4 && rng() % 2) {
+        msg[ublox::UBLOX_HEADER_SIZE + 0] = 0;
+        msg[ublox::UBLOX_HEADER_SIZE + 4] = rng() % 16;
+      }
+      mismatches += compare(parser, kaitai_parser, fix_checksum(msg));
+    }
+    printf("fuzzed: %d mismatches in %d iterations\n", mismatches, fuzz_iterations);
+    return mismatches > 0;
+  });
+
+  // per message type timing
+  std::map<uint16_t, std::vector<const std::string *>> by_type;
+  for (auto &msg : msgs) {
+    by_type[((uint8_t)msg[2] << 8) | (uint8_t)msg[3]].push_back(&msg);
+  }
+  for (auto &[type, type_msgs] : by_type) {
+    const int reps = std::max(1, 20000 / (int)type_msgs.size());
+    UbloxMsgParser parser;
+    KaitaiUbloxMsgParser kaitai_parser;
+
+    uint64_t view_ns = 0, kaitai_ns = 0;
+    for (int r = 0; r < reps; r++) {
+      for (auto msg : type_msgs) {
+        load(parser, *msg);
+        uint64_t t0 = nanos_since_boot();
+        run([&]() { return parser.gen_msg(); });
+        uint64_t t1 = nanos_since_boot();
+        run([&]() { return kaitai_parser.gen_msg(*msg); });
+        uint64_t t2 = nanos_since_boot();
+        view_ns += t1 - t0;
+        kaitai_ns += t2 - t1;
+      }
+    }
+    int n = reps * type_msgs.size();
+    printf("type %04x: %zu msgs, view %.0f ns/msg, kaitai %.0f ns/msg\n", type, type_msgs.size(),
+           (double)view_ns / n, (double)kaitai_ns / n);
+  }
+
+  return (failures + fuzz_failures) > 0;
+}
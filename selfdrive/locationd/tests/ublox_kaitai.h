@@ -0,0 +1,24 @@
+#pragma once
+
+#include <string>
+#include <unordered_map>
+
+#include "cereal/messaging/messaging.h"
+#include "selfdrive/locationd/generated/gps.h"
+#include "selfdrive/locationd/generated/ubx.h"
+
+// The kaitai based parser ubloxd used before UbxView. Kept as the reference
+// the view based parser is checked against.
+class KaitaiUbloxMsgParser {
+  public:
+    // dat is a complete message, as returned by UbloxMsgParser::data()
+    std::pair<std::string, kj::Array<capnp::word>> gen_msg(const std::string &dat);
+    kj::Array<capnp::word> gen_nav_pvt(ubx_t::nav_pvt_t *msg);
+    kj::Array<capnp::word> gen_rxm_sfrbx(ubx_t::rxm_sfrbx_t *msg);
+    kj::Array<capnp::word> gen_rxm_rawx(ubx_t::rxm_rawx_t *msg);
+    kj::Array<capnp::word> gen_mon_hw(ubx_t::mon_hw_t *msg);
+    kj::Array<capnp::word> gen_mon_hw2(ubx_t::mon_hw2_t *msg);
+
+  private:
+    std::unordered_map<int, std::unordered_map<int, std::string>> gps_subframes;
+};
@@ -2,7 +2,6 @@
 
 #include <unistd.h>
 
-#include <cassert>
 #include <chrono>
 #include <cmath>
 #include <cstdio>
@@ -93,165 +92,200 @@ bool UbloxMsgParser::add_data(const uint8_t *incoming_data, uint32_t incoming_da
 }
 
 
-std::pair<std::string, kj::Array<capnp::word>> UbloxMsgParser::gen_msg() {
-  std::string dat = data();
-  kaitai::kstream stream(dat);
+static inline uint16_t read_u2be(const uint8_t *p) {
+  return (p[0] << 8) | p[1];
+}
+
+static inline uint32_t read_u4be(const uint8_t *p) {
+  return ((uint32_t)p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+}
+
+// sign extends the lowest n bits
+static inline int32_t sign_extend(uint32_t val, int bits) {
+  return (val & (1 << (bits - 1))) ? (int32_t)(val - (1 << bits)) : (int32_t)val;
+}
 
-  ubx_t ubx_message(&stream);
-  auto body = ubx_message.body();
+std::pair<std::string, kj::Array<capnp::word>> UbloxMsgParser::gen_msg() {
+  UbxView msg(msg_parse_buf, bytes_in_parse_buf);
 
-  switch (ubx_message.msg_type()) {
+  switch (msg.msg_type()) {
   case 0x0107:
-    return {"gpsLocationExternal", gen_nav_pvt(static_cast<ubx_t::nav_pvt_t*>(body))};
+    return {"gpsLocationExternal", gen_nav_pvt(msg)};
     break;
   case 0x0213:
-    return {"ubloxGnss", gen_rxm_sfrbx(static_cast<ubx_t::rxm_sfrbx_t*>(body))};
+    return {"ubloxGnss", gen_rxm_sfrbx(msg)};
     break;
   case 0x0215:
-    return {"ubloxGnss", gen_rxm_rawx(static_cast<ubx_t::rxm_rawx_t*>(body))};
+    return {"ubloxGnss", gen_rxm_rawx(msg)};
     break;
   case 0x0a09:
-    return {"ubloxGnss", gen_mon_hw(static_cast<ubx_t::mon_hw_t*>(body))};
+    return {"ubloxGnss", gen_mon_hw(msg)};
     break;
   case 0x0a0b:
-    return {"ubloxGnss", gen_mon_hw2(static_cast<ubx_t::mon_hw2_t*>(body))};
+    return {"ubloxGnss", gen_mon_hw2(msg)};
     break;
   default:
-    LOGE("Unknown message type %x", ubx_message.msg_type());
+    LOGE("Unknown message type %x", msg.msg_type());
     return {"ubloxGnss", kj::Array<capnp::word>()};
     break;
   }
 }
 
+void UbloxMsgParser::process(const uint8_t *data, size_t len, const std::function<void(const std::string &, kj::Array<capnp::word>)> &send) {
+  size_t bytes_consumed = 0;
+  while (bytes_consumed < len) {
+    size_t bytes_consumed_this_time = 0U;
+    if (add_data(data + bytes_consumed, (uint32_t)(len - bytes_consumed), bytes_consumed_this_time)) {
+      try {
+        auto ublox_msg = gen_msg();
+        if (ublox_msg.second.size() > 0) {
+          send(ublox_msg.first, std::move(ublox_msg.second));
+        }
+      } catch (const std::exception& e) {
+        LOGE("Error parsing ublox message %s", e.what());
+      }
+
+      reset();
+    }
+    bytes_consumed += bytes_consumed_this_time;
+  }
+}
+
+
+kj::Array<capnp::word> UbloxMsgParser::gen_nav_pvt(const UbxView &msg) {
+  msg.require(0, 92);
 
-kj::Array<capnp::word> UbloxMsgParser::gen_nav_pvt(ubx_t::nav_pvt_t *msg) {
   MessageBuilder msg_builder;
   auto gpsLoc = msg_builder.initEvent().initGpsLocationExternal();
   gpsLoc.setSource(cereal::GpsLocationData::SensorSource::UBLOX);
-  gpsLoc.setFlags(msg->flags());
-  gpsLoc.setLatitude(msg->lat() * 1e-07);
-  gpsLoc.setLongitude(msg->lon() * 1e-07);
-  gpsLoc.setAltitude(msg->height() * 1e-03);
-  gpsLoc.setSpeed(msg->g_speed() * 1e-03);
-  gpsLoc.setBearingDeg(msg->head_mot() * 1e-5);
-  gpsLoc.setAccuracy(msg->h_acc() * 1e-03);
+  gpsLoc.setFlags(msg.get<uint8_t>(21));
+  gpsLoc.setLatitude(msg.get<int32_t>(28) * 1e-07);
+  gpsLoc.setLongitude(msg.get<int32_t>(24) * 1e-07);
+  gpsLoc.setAltitude(msg.get<int32_t>(32) * 1e-03);
+  gpsLoc.setSpeed(msg.get<int32_t>(60) * 1e-03);
+  gpsLoc.setBearingDeg(msg.get<int32_t>(64) * 1e-5);
+  gpsLoc.setAccuracy(msg.get<uint32_t>(40) * 1e-03);
   std::tm timeinfo = std::tm();
-  timeinfo.tm_year = msg->year() - 1900;
-  timeinfo.tm_mon = msg->month() - 1;
-  timeinfo.tm_mday = msg->day();
-  timeinfo.tm_hour = msg->hour();
-  timeinfo.tm_min = msg->min();
-  timeinfo.tm_sec = msg->sec();
+  timeinfo.tm_year = msg.get<uint16_t>(4) - 1900;
+  timeinfo.tm_mon = msg.get<uint8_t>(6) - 1;
+  timeinfo.tm_mday = msg.get<uint8_t>(7);
+  timeinfo.tm_hour = msg.get<uint8_t>(8);
+  timeinfo.tm_min = msg.get<uint8_t>(9);
+  timeinfo.tm_sec = msg.get<uint8_t>(10);
 
   std::time_t utc_tt = timegm(&timeinfo);
-  gpsLoc.setTimestamp(utc_tt * 1e+03 + msg->nano() * 1e-06);
-  float f[] = { msg->vel_n() * 1e-03f, msg->vel_e() * 1e-03f, msg->vel_d() * 1e-03f };
+  gpsLoc.setTimestamp(utc_tt * 1e+03 + msg.get<int32_t>(16) * 1e-06);
+  float f[] = { msg.get<int32_t>(48) * 1e-03f, msg.get<int32_t>(52) * 1e-03f, msg.get<int32_t>(56) * 1e-03f };
   gpsLoc.setVNED(f);
-  gpsLoc.setVerticalAccuracy(msg->v_acc() * 1e-03);
-  gpsLoc.setSpeedAccuracy(msg->s_acc() * 1e-03);
-  gpsLoc.setBearingAccuracyDeg(msg->head_acc() * 1e-05);
+  gpsLoc.setVerticalAccuracy(msg.get<uint32_t>(44) * 1e-03);
+  gpsLoc.setSpeedAccuracy(msg.get<int32_t>(68) * 1e-03);
+  gpsLoc.setBearingAccuracyDeg(msg.get<uint32_t>(72) * 1e-05);
   return capnp::messageToFlatArray(msg_builder);
 }
 
 
-kj::Array<capnp::word> UbloxMsgParser::gen_rxm_sfrbx(ubx_t::rxm_sfrbx_t *msg) {
-  auto body = *msg->body();
+kj::Array<capnp::word> UbloxMsgParser::gen_rxm_sfrbx(const UbxView &msg) {
+  msg.require(0, 8);
+  uint8_t gnss_id = msg.get<uint8_t>(0);
+  uint8_t sv_id = msg.get<uint8_t>(1);
+  uint8_t num_words = msg.get<uint8_t>(4);
+  msg.require(8, num_words * 4);
 
-  if (msg->gnss_id() == ubx_t::gnss_type_t::GNSS_TYPE_GPS) {
+  if (gnss_id == 0) {  // GPS
     // GPS subframes are packed into 10x 4 bytes, each containing 3 actual bytes
     // We will first need to separate the data from the padding and parity
-    assert(body.size() == 10);
-
-    std::string subframe_data;
-    subframe_data.reserve(30);
-    for (uint32_t word : body) {
-      word = word >> 6; // TODO: Verify parity
-      subframe_data.push_back(word >> 16);
-      subframe_data.push_back(word >> 8);
-      subframe_data.push_back(word >> 0);
+    if (num_words != 10) {
+      throw std::runtime_error("invalid GPS subframe word count");
     }
 
-    // Collect subframes in map and parse when we have all the parts
-    {
-      kaitai::kstream stream(subframe_data);
-      gps_t subframe(&stream);
-      int subframe_id = subframe.how()->subframe_id();
+    uint8_t subframe_data[GPS_SUBFRAME_SIZE];
+    for (int i = 0; i < 10; i++) {
+      uint32_t word = msg.get<uint32_t>(8 + i * 4) >> 6; // TODO: Verify parity
+      subframe_data[i * 3 + 0] = word >> 16;
+      subframe_data[i * 3 + 1] = word >> 8;
+      subframe_data[i * 3 + 2] = word >> 0;
+    }
 
-      if (subframe_id == 1) gps_subframes[msg->sv_id()].clear();
-      gps_subframes[msg->sv_id()][subframe_id] = subframe_data;
+    // Collect subframes and parse when we have all the parts
+    if (subframe_data[0] != 0x8B) {
+      throw std::runtime_error("invalid GPS subframe preamble");
     }
+    int subframe_id = (subframe_data[5] >> 2) & 0x7;
+
+    GpsSubframes &subframes = gps_subframes[sv_id];
+    if (subframe_id == 1) subframes.present = 0;
+    subframes.present |= 1 << subframe_id;
+    memcpy(subframes.data[subframe_id], subframe_data, GPS_SUBFRAME_SIZE);
+
+    if (__builtin_popcount(subframes.present) == 5) {
+      const uint8_t required = 0b11110;
+      if ((subframes.present & required) != required) {
+        // an incomplete set never produces an ephemeris until the next subframe 1
+        subframes.present |= required;
+        throw std::runtime_error("incomplete GPS subframes");
+      }
 
-    if (gps_subframes[msg->sv_id()].size() == 5) {
       MessageBuilder msg_builder;
       auto eph = msg_builder.initEvent().initUbloxGnss().initEphemeris();
-      eph.setSvId(msg->sv_id());
+      eph.setSvId(sv_id);
 
       // Subframe 1
       {
-        kaitai::kstream stream(gps_subframes[msg->sv_id()][1]);
-        gps_t subframe(&stream);
-        gps_t::subframe_1_t* subframe_1 = static_cast<gps_t::subframe_1_t*>(subframe.body());
-
-        eph.setGpsWeek(subframe_1->week_no());
-        eph.setTgd(subframe_1->t_gd() * pow(2, -31));
-        eph.setToc(subframe_1->t_oc() * pow(2, 4));
-        eph.setAf2(subframe_1->af_2() * pow(2, -55));
-        eph.setAf1(subframe_1->af_1() * pow(2, -43));
-        eph.setAf0(subframe_1->af_0() * pow(2, -31));
+        const uint8_t *s = subframes.data[1];
+        eph.setGpsWeek((s[6] << 2) | (s[7] >> 6));
+        eph.setTgd((int8_t)s[20] * pow(2, -31));
+        eph.setToc(read_u2be(&s[22]) * pow(2, 4));
+        eph.setAf2((int8_t)s[24] * pow(2, -55));
+        eph.setAf1((int16_t)read_u2be(&s[25]) * pow(2, -43));
+        eph.setAf0(sign_extend(((s[27] << 16) | (s[28] << 8) | s[29]) >> 2, 22) * pow(2, -31));
       }
 
       // Subframe 2
       {
-        kaitai::kstream stream(gps_subframes[msg->sv_id()][2]);
-        gps_t subframe(&stream);
-        gps_t::subframe_2_t* subframe_2 = static_cast<gps_t::subframe_2_t*>(subframe.body());
-
-        eph.setCrs(subframe_2->c_rs() * pow(2, -5));
-        eph.setDeltaN(subframe_2->delta_n() * pow(2, -43) * gpsPi);
-        eph.setM0(subframe_2->m_0() * pow(2, -31) * gpsPi);
-        eph.setCuc(subframe_2->c_uc() * pow(2, -29));
-        eph.setEcc(subframe_2->e() * pow(2, -33));
-        eph.setCus(subframe_2->c_us() * pow(2, -29));
-        eph.setA(pow(subframe_2->sqrt_a() * pow(2, -19), 2.0));
-        eph.setToe(subframe_2->t_oe() * pow(2, 4));
+        const uint8_t *s = subframes.data[2];
+        eph.setCrs((int16_t)read_u2be(&s[7]) * pow(2, -5));
+        eph.setDeltaN((int16_t)read_u2be(&s[9]) * pow(2, -43) * gpsPi);
+        eph.setM0((int32_t)read_u4be(&s[11]) * pow(2, -31) * gpsPi);
+        eph.setCuc((int16_t)read_u2be(&s[15]) * pow(2, -29));
+        eph.setEcc((int32_t)read_u4be(&s[17]) * pow(2, -33));
+        eph.setCus((int16_t)read_u2be(&s[21]) * pow(2, -29));
+        eph.setA(pow(read_u4be(&s[23]) * pow(2, -19), 2.0));
+        eph.setToe(read_u2be(&s[27]) * pow(2, 4));
       }
 
       // Subframe 3
       {
-        kaitai::kstream stream(gps_subframes[msg->sv_id()][3]);
-        gps_t subframe(&stream);
-        gps_t::subframe_3_t* subframe_3 = static_cast<gps_t::subframe_3_t*>(subframe.body());
-
-        eph.setCic(subframe_3->c_ic() * pow(2, -29));
-        eph.setOmega0(subframe_3->omega_0() * pow(2, -31) * gpsPi);
-        eph.setCis(subframe_3->c_is() * pow(2, -29));
-        eph.setI0(subframe_3->i_0() * pow(2, -31) * gpsPi);
-        eph.setCrc(subframe_3->c_rc() * pow(2, -5));
-        eph.setOmega(subframe_3->omega() * pow(2, -31) * gpsPi);
-        eph.setOmegaDot(subframe_3->omega_dot() * pow(2, -43) * gpsPi);
-        eph.setIode(subframe_3->iode());
-        eph.setIDot(subframe_3->idot() * pow(2, -43) * gpsPi);
+        const uint8_t *s = subframes.data[3];
+        eph.setCic((int16_t)read_u2be(&s[6]) * pow(2, -29));
+        eph.setOmega0((int32_t)read_u4be(&s[8]) * pow(2, -31) * gpsPi);
+        eph.setCis((int16_t)read_u2be(&s[12]) * pow(2, -29));
+        eph.setI0((int32_t)read_u4be(&s[14]) * pow(2, -31) * gpsPi);
+        eph.setCrc((int16_t)read_u2be(&s[18]) * pow(2, -5));
+        eph.setOmega((int32_t)read_u4be(&s[20]) * pow(2, -31) * gpsPi);
+        eph.setOmegaDot(sign_extend((s[24] << 16) | (s[25] << 8) | s[26], 24) * pow(2, -43) * gpsPi);
+        eph.setIode(s[27]);
+        eph.setIDot(sign_extend(read_u2be(&s[28]) >> 2, 14) * pow(2, -43) * gpsPi);
       }
 
       // Subframe 4
       {
-        kaitai::kstream stream(gps_subframes[msg->sv_id()][4]);
-        gps_t subframe(&stream);
-        gps_t::subframe_4_t* subframe_4 = static_cast<gps_t::subframe_4_t*>(subframe.body());
+        const uint8_t *s = subframes.data[4];
+        int data_id = s[6] >> 6;
+        int page_id = s[6] & 0x3F;
 
         // This is page 18, why is the page id 56?
-        if (subframe_4->data_id() == 1 && subframe_4->page_id() == 56) {
-          auto iono = static_cast<gps_t::subframe_4_t::ionosphere_data_t*>(subframe_4->body());
-          double a0 = iono->a0() * pow(2, -30);
-          double a1 = iono->a1() * pow(2, -27);
-          double a2 = iono->a2() * pow(2, -24);
-          double a3 = iono->a3() * pow(2, -24);
+        if (data_id == 1 && page_id == 56) {
+          const int8_t *iono = (const int8_t *)&s[7];
+          double a0 = iono[0] * pow(2, -30);
+          double a1 = iono[1] * pow(2, -27);
+          double a2 = iono[2] * pow(2, -24);
+          double a3 = iono[3] * pow(2, -24);
           eph.setIonoAlpha({a0, a1, a2, a3});
 
-          double b0 = iono->b0() * pow(2, 11);
-          double b1 = iono->b1() * pow(2, 14);
-          double b2 = iono->b2() * pow(2, 16);
-          double b3 = iono->b3() * pow(2, 16);
+          double b0 = iono[4] * pow(2, 11);
+          double b1 = iono[5] * pow(2, 14);
+          double b2 = iono[6] * pow(2, 16);
+          double b3 = iono[7] * pow(2, 16);
           eph.setIonoBeta({b0, b1, b2, b3});
         }
       }
@@ -262,75 +296,83 @@ kj::Array<capnp::word> UbloxMsgParser::gen_rxm_sfrbx(ubx_t::rxm_sfrbx_t *msg) {
   return kj::Array<capnp::word>();
 }
 
-kj::Array<capnp::word> UbloxMsgParser::gen_rxm_rawx(ubx_t::rxm_rawx_t *msg) {
+kj::Array<capnp::word> UbloxMsgParser::gen_rxm_rawx(const UbxView &msg) {
+  msg.require(0, 16);
+  uint8_t num_meas = msg.get<uint8_t>(11);
+  uint8_t rec_stat = msg.get<uint8_t>(12);
+  msg.require(16, num_meas * 32);
+
   MessageBuilder msg_builder;
   auto mr = msg_builder.initEvent().initUbloxGnss().initMeasurementReport();
-  mr.setRcvTow(msg->rcv_tow());
-  mr.setGpsWeek(msg->week());
-  mr.setLeapSeconds(msg->leap_s());
-  mr.setGpsWeek(msg->week());
-
-  auto mb = mr.initMeasurements(msg->num_meas());
-  auto measurements = *msg->measurements();
-  for(int8_t i = 0; i < msg->num_meas(); i++) {
-    mb[i].setSvId(measurements[i]->sv_id());
-    mb[i].setPseudorange(measurements[i]->pr_mes());
-    mb[i].setCarrierCycles(measurements[i]->cp_mes());
-    mb[i].setDoppler(measurements[i]->do_mes());
-    mb[i].setGnssId(measurements[i]->gnss_id());
-    mb[i].setGlonassFrequencyIndex(measurements[i]->freq_id());
-    mb[i].setLocktime(measurements[i]->lock_time());
-    mb[i].setCno(measurements[i]->cno());
-    mb[i].setPseudorangeStdev(0.01 * (pow(2, (measurements[i]->pr_stdev() & 15)))); // weird scaling, might be wrong
-    mb[i].setCarrierPhaseStdev(0.004 * (measurements[i]->cp_stdev() & 15));
-    mb[i].setDopplerStdev(0.002 * (pow(2, (measurements[i]->do_stdev() & 15)))); // weird scaling, might be wrong
+  mr.setRcvTow(msg.get<double>(0));
+  mr.setGpsWeek(msg.get<uint16_t>(8));
+  mr.setLeapSeconds(msg.get<int8_t>(10));
+
+  auto mb = mr.initMeasurements(num_meas);
+  for(int i = 0; i < num_meas; i++) {
+    const size_t m = 16 + i * 32;
+    mb[i].setSvId(msg.get<uint8_t>(m + 21));
+    mb[i].setPseudorange(msg.get<double>(m + 0));
+    mb[i].setCarrierCycles(msg.get<double>(m + 8));
+    mb[i].setDoppler(msg.get<float>(m + 16));
+    mb[i].setGnssId(msg.get<uint8_t>(m + 20));
+    mb[i].setGlonassFrequencyIndex(msg.get<uint8_t>(m + 23));
+    mb[i].setLocktime(msg.get<uint16_t>(m + 24));
+    mb[i].setCno(msg.get<uint8_t>(m + 26));
+    mb[i].setPseudorangeStdev(0.01 * (pow(2, (msg.get<uint8_t>(m + 27) & 15)))); // weird scaling, might be wrong
+    mb[i].setCarrierPhaseStdev(0.004 * (msg.get<uint8_t>(m + 28) & 15));
+    mb[i].setDopplerStdev(0.002 * (pow(2, (msg.get<uint8_t>(m + 29) & 15)))); // weird scaling, might be wrong
 
     auto ts = mb[i].initTrackingStatus();
-    auto trk_stat = measurements[i]->trk_stat();
+    auto trk_stat = msg.get<uint8_t>(m + 30);
     ts.setPseudorangeValid(bit_to_bool(trk_stat, 0));
     ts.setCarrierPhaseValid(bit_to_bool(trk_stat, 1));
     ts.setHalfCycleValid(bit_to_bool(trk_stat, 2));
     ts.setHalfCycleSubtracted(bit_to_bool(trk_stat, 3));
   }
 
-  mr.setNumMeas(msg->num_meas());
+  mr.setNumMeas(num_meas);
   auto rs = mr.initReceiverStatus();
-  rs.setLeapSecValid(bit_to_bool(msg->rec_stat(), 0));
-  rs.setClkReset(bit_to_bool(msg->rec_stat(), 2));
+  rs.setLeapSecValid(bit_to_bool(rec_stat, 0));
+  rs.setClkReset(bit_to_bool(rec_stat, 2));
   return capnp::messageToFlatArray(msg_builder);
 }
 
-kj::Array<capnp::word> UbloxMsgParser::gen_mon_hw(ubx_t::mon_hw_t *msg) {
+kj::Array<capnp::word> UbloxMsgParser::gen_mon_hw(const UbxView &msg) {
+  msg.require(0, 60);
+
   MessageBuilder msg_builder;
   auto hwStatus = msg_builder.initEvent().initUbloxGnss().initHwStatus();
-  hwStatus.setNoisePerMS(msg->noise_per_ms());
-  hwStatus.setFlags(msg->flags());
-  hwStatus.setAgcCnt(msg->agc_cnt());
-  hwStatus.setAStatus((cereal::UbloxGnss::HwStatus::AntennaSupervisorState) msg->a_status());
-  hwStatus.setAPower((cereal::UbloxGnss::HwStatus::AntennaPowerStatus) msg->a_power());
-  hwStatus.setJamInd(msg->jam_ind());
+  hwStatus.setNoisePerMS(msg.get<uint16_t>(16));
+  hwStatus.setFlags(msg.get<uint8_t>(22));
+  hwStatus.setAgcCnt(msg.get<uint16_t>(18));
+  hwStatus.setAStatus((cereal::UbloxGnss::HwStatus::AntennaSupervisorState) msg.get<uint8_t>(20));
+  hwStatus.setAPower((cereal::UbloxGnss::HwStatus::AntennaPowerStatus) msg.get<uint8_t>(21));
+  hwStatus.setJamInd(msg.get<uint8_t>(45));
   return capnp::messageToFlatArray(msg_builder);
 }
 
-kj::Array<capnp::word> UbloxMsgParser::gen_mon_hw2(ubx_t::mon_hw2_t *msg) {
+kj::Array<capnp::word> UbloxMsgParser::gen_mon_hw2(const UbxView &msg) {
+  msg.require(0, 28);
+
   MessageBuilder msg_builder;
   auto hwStatus = msg_builder.initEvent().initUbloxGnss().initHwStatus2();
-  hwStatus.setOfsI(msg->ofs_i());
-  hwStatus.setMagI(msg->mag_i());
-  hwStatus.setOfsQ(msg->ofs_q());
-  hwStatus.setMagQ(msg->mag_q());
+  hwStatus.setOfsI(msg.get<int8_t>(0));
+  hwStatus.setMagI(msg.get<uint8_t>(1));
+  hwStatus.setOfsQ(msg.get<int8_t>(2));
+  hwStatus.setMagQ(msg.get<uint8_t>(3));
 
-  switch (msg->cfg_source()) {
-    case ubx_t::mon_hw2_t::config_source_t::CONFIG_SOURCE_ROM:
+  switch (msg.get<uint8_t>(4)) {
+    case 113:
       hwStatus.setCfgSource(cereal::UbloxGnss::HwStatus2::ConfigSource::ROM);
       break;
-    case ubx_t::mon_hw2_t::config_source_t::CONFIG_SOURCE_OTP:
+    case 111:
       hwStatus.setCfgSource(cereal::UbloxGnss::HwStatus2::ConfigSource::OTP);
       break;
-    case ubx_t::mon_hw2_t::config_source_t::CONFIG_SOURCE_CONFIG_PINS:
+    case 112:
       hwStatus.setCfgSource(cereal::UbloxGnss::HwStatus2::ConfigSource::CONFIGPINS);
       break;
-    case ubx_t::mon_hw2_t::config_source_t::CONFIG_SOURCE_FLASH:
+    case 102:
       hwStatus.setCfgSource(cereal::UbloxGnss::HwStatus2::ConfigSource::FLASH);
       break;
     default:
@@ -338,8 +380,8 @@ kj::Array<capnp::word> UbloxMsgParser::gen_mon_hw2(ubx_t::mon_hw2_t *msg) {
       break;
   }
 
-  hwStatus.setLowLevCfg(msg->low_lev_cfg());
-  hwStatus.setPostStatus(msg->post_status());
+  hwStatus.setLowLevCfg(msg.get<uint32_t>(8));
+  hwStatus.setPostStatus(msg.get<uint32_t>(20));
 
   return capnp::messageToFlatArray(msg_builder);
 }
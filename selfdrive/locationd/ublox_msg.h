@@ -2,15 +2,16 @@
 
 #include <cassert>
 #include <cstdint>
+#include <cstring>
+#include <functional>
 #include <memory>
+#include <stdexcept>
 #include <string>
 #include <unordered_map>
 #include <ctime>
 
 #include "cereal/messaging/messaging.h"
 #include "selfdrive/common/util.h"
-#include "selfdrive/locationd/generated/gps.h"
-#include "selfdrive/locationd/generated/ubx.h"
 
 using namespace std::string_literals;
 
@@ -83,6 +84,30 @@ namespace ublox {
   }
 }
 
+// Bounds checked little endian view over a complete message in the parse buffer.
+// Offsets are relative to the payload. Like the kaitai stream the parser used to
+// be built on, reads are bounded by the whole message including the checksum.
+class UbxView {
+  public:
+    UbxView(const uint8_t *msg, size_t msg_len) : payload(msg + ublox::UBLOX_HEADER_SIZE),
+                                                   len(msg_len - ublox::UBLOX_HEADER_SIZE) {}
+    inline uint16_t msg_type() const {return (payload[-4] << 8) | payload[-3];}
+    inline void require(size_t offset, size_t size) const {
+      if (offset + size > len) throw std::out_of_range("ublox message too short");
+    }
+    template <typename T>
+    inline T get(size_t offset) const {
+      static_assert(__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__);
+      T v;
+      memcpy(&v, payload + offset, sizeof(T));
+      return v;
+    }
+
+  private:
+    const uint8_t *payload;
+    size_t len;
+};
+
 class UbloxMsgParser {
   public:
     bool add_data(const uint8_t *incoming_data, uint32_t incoming_data_len, size_t &bytes_consumed);
@@ -91,18 +116,26 @@ class UbloxMsgParser {
     inline std::string data() {return std::string((const char*)msg_parse_buf, bytes_in_parse_buf);}
 
     std::pair<std::string, kj::Array<capnp::word>> gen_msg();
-    kj::Array<capnp::word> gen_nav_pvt(ubx_t::nav_pvt_t *msg);
-    kj::Array<capnp::word> gen_rxm_sfrbx(ubx_t::rxm_sfrbx_t *msg);
-    kj::Array<capnp::word> gen_rxm_rawx(ubx_t::rxm_rawx_t *msg);
-    kj::Array<capnp::word> gen_mon_hw(ubx_t::mon_hw_t *msg);
-    kj::Array<capnp::word> gen_mon_hw2(ubx_t::mon_hw2_t *msg);
+    // feeds a chunk of the receiver's stream through the parser and calls send with every message it completes
+    void process(const uint8_t *data, size_t len, const std::function<void(const std::string &, kj::Array<capnp::word>)> &send);
+    kj::Array<capnp::word> gen_nav_pvt(const UbxView &msg);
+    kj::Array<capnp::word> gen_rxm_sfrbx(const UbxView &msg);
+    kj::Array<capnp::word> gen_rxm_rawx(const UbxView &msg);
+    kj::Array<capnp::word> gen_mon_hw(const UbxView &msg);
+    kj::Array<capnp::word> gen_mon_hw2(const UbxView &msg);
 
   private:
     inline bool valid_cheksum();
     inline bool valid();
     inline bool valid_so_far();
 
-    std::unordered_map<int, std::unordered_map<int, std::string>> gps_subframes;
+    // GPS subframes with parity stripped, indexed by the 3 bit subframe id
+    static const int GPS_SUBFRAME_SIZE = 30;
+    struct GpsSubframes {
+      uint8_t present = 0;
+      uint8_t data[8][GPS_SUBFRAME_SIZE];
+    };
+    std::unordered_map<int, GpsSubframes> gps_subframes;
 
     size_t bytes_in_parse_buf = 0;
     uint8_t msg_parse_buf[ublox::UBLOX_HEADER_SIZE + ublox::UBLOX_MAX_MSG_SIZE];
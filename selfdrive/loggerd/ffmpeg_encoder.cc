@@ -0,0 +1,195 @@
+#pragma clang diagnostic ignored "-Wdeprecated-declarations"
+
+#include "selfdrive/loggerd/ffmpeg_encoder.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cassert>
+#include <cstdio>
+#include <cstdlib>
+
+#define __STDC_CONSTANT_MACROS
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavformat/avformat.h>
+#include <libavutil/opt.h>
+}
+
+#include "libyuv.h"
+
+#include "selfdrive/common/swaglog.h"
+#include "selfdrive/common/util.h"
+
+FfmpegEncoder::FfmpegEncoder(const char* filename, int width, int height, int fps, int bitrate, bool h265, bool downscale,
+                             bool write, int threads)
+  : filename(filename), width(width), height(height), fps(fps), bitrate(bitrate), threads(threads),
+    h265(h265), downscale(downscale), write(write) {
+
+  if (this->threads == 0 && getenv("ENCODER_THREADS")) {
+    this->threads = atoi(getenv("ENCODER_THREADS"));
+  }
+
+  av_register_all();
+  codec = avcodec_find_encoder(h265 ? AV_CODEC_ID_HEVC : AV_CODEC_ID_H264);
+  assert(codec);
+
+  frame = av_frame_alloc();
+  assert(frame);
+  frame->format = AV_PIX_FMT_YUV420P;
+  frame->width = width;
+  frame->height = height;
+  frame->linesize[0] = width;
+  frame->linesize[1] = width/2;
+  frame->linesize[2] = width/2;
+
+  pkt = av_packet_alloc();
+  assert(pkt);
+
+  if (downscale) {
+    scaled.resize(width * height * 3 / 2);
+  }
+}
+
+FfmpegEncoder::~FfmpegEncoder() {
+  assert(!is_open);
+  av_packet_free(&pkt);
+  av_frame_free(&frame);
+}
+
+void FfmpegEncoder::encoder_open(const char* path) {
+  counter = 0;
+  is_open = true;
+  // nothing is encoded if the video isn't kept
+  if (!write) return;
+
+  vid_path = util::string_format("%s/%s", path, filename);
+  LOGD("encoder_open %s", vid_path.c_str());
+
+  // the codec is opened for every segment, so each file starts with a keyframe and
+  // its parameter sets
+  codec_ctx = avcodec_alloc_context3(codec);
+  assert(codec_ctx);
+  codec_ctx->width = width;
+  codec_ctx->height = height;
+  codec_ctx->pix_fmt = AV_PIX_FMT_YUV420P;
+  codec_ctx->time_base = (AVRational){ 1, fps };
+  codec_ctx->bit_rate = bitrate;
+  codec_ctx->gop_size = fps;
+  // no reordering, frames come out in the order of the encode index
+  codec_ctx->max_b_frames = 0;
+  codec_ctx->thread_count = threads;
+
+  // fastest presets that keep up with the full size cameras in real time
+  av_opt_set(codec_ctx->priv_data, "preset", h265 ? "ultrafast" : "veryfast", 0);
+  if (h265) {
+    av_opt_set(codec_ctx->priv_data, "x265-params", "log-level=error", 0);
+  }
+
+  format_ctx = NULL;
+  avformat_alloc_output_context2(&format_ctx, NULL, NULL, vid_path.c_str());
+  assert(format_ctx);
+  if (format_ctx->oformat->flags & AVFMT_GLOBALHEADER) {
+    codec_ctx->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
+  }
+
+  int err = avcodec_open2(codec_ctx, codec, NULL);
+  assert(err >= 0);
+
+  stream = avformat_new_stream(format_ctx, NULL);
+  assert(stream);
+  stream->id = 0;
+  stream->time_base = codec_ctx->time_base;
+  err = avcodec_parameters_from_context(stream->codecpar, codec_ctx);
+  assert(err >= 0);
+
+  err = avio_open(&format_ctx->pb, vid_path.c_str(), AVIO_FLAG_WRITE);
+  assert(err >= 0);
+
+  err = avformat_write_header(format_ctx, NULL);
+  assert(err >= 0);
+
+  // create camera lock file
+  lock_path = util::string_format("%s/%s.lock", path, filename);
+  int lock_fd = HANDLE_EINTR(open(lock_path.c_str(), O_RDWR | O_CREAT, 0664));
+  assert(lock_fd >= 0);
+  close(lock_fd);
+}
+
+void FfmpegEncoder::encoder_close() {
+  if (!is_open) return;
+  is_open = false;
+  if (!write) return;
+
+  // drain the frames still in the encoder
+  int err = avcodec_send_frame(codec_ctx, NULL);
+  if (err >= 0) err = write_packets();
+  if (err < 0) LOGE("failed to flush encoder %s", vid_path.c_str());
+
+  av_write_trailer(format_ctx);
+  avcodec_free_context(&codec_ctx);
+  avio_closep(&format_ctx->pb);
+  avformat_free_context(format_ctx);
+  format_ctx = NULL;
+  stream = NULL;
+
+  unlink(lock_path.c_str());
+}
+
+// writes everything the encoder has output so far
+int FfmpegEncoder::write_packets() {
+  while (true) {
+    int err = avcodec_receive_packet(codec_ctx, pkt);
+    if (err == AVERROR(EAGAIN) || err == AVERROR_EOF) return 0;
+    if (err < 0) return err;
+
+    av_packet_rescale_ts(pkt, codec_ctx->time_base, stream->time_base);
+    pkt->stream_index = 0;
+    // takes the packet's reference
+    err = av_interleaved_write_frame(format_ctx, pkt);
+    if (err < 0) return err;
+  }
+}
+
+int FfmpegEncoder::encode_frame(const uint8_t *y_ptr, const uint8_t *u_ptr, const uint8_t *v_ptr,
+                                int in_width, int in_height, uint64_t ts) {
+  if (!is_open) return -1;
+
+  int ret = counter++;
+  if (!write) return ret;
+
+  if (downscale && (in_width != width || in_height != height)) {
+    uint8_t *y = scaled.data(), *u = y + width * height, *v = u + width * height / 4;
+    libyuv::I420Scale(y_ptr, in_width,
+                      u_ptr, in_width/2,
+                      v_ptr, in_width/2,
+                      in_width, in_height,
+                      y, width,
+                      u, width/2,
+                      v, width/2,
+                      width, height,
+                      libyuv::kFilterNone);
+    y_ptr = y;
+    u_ptr = u;
+    v_ptr = v;
+  }
+
+  // not refcounted, the encoder copies the frame if it keeps it
+  frame->data[0] = (uint8_t*)y_ptr;
+  frame->data[1] = (uint8_t*)u_ptr;
+  frame->data[2] = (uint8_t*)v_ptr;
+  frame->pts = ret;
+
+  int err = avcodec_send_frame(codec_ctx, frame);
+  if (err < 0) {
+    LOGE("encoding error\n");
+    return -1;
+  }
+  err = write_packets();
+  if (err < 0) {
+    LOGE("encoder writer error\n");
+    return -1;
+  }
+  return ret;
+}
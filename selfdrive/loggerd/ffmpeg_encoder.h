@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavformat/avformat.h>
+}
+
+#include "selfdrive/loggerd/encoder.h"
+
+// FfmpegEncoder, lossy codec using libavcodec's software hevc/h264 encoders
+class FfmpegEncoder : public VideoEncoder {
+public:
+  // threads is the encoder's thread count, 0 takes ENCODER_THREADS from the
+  // environment or lets libavcodec pick from the number of cores
+  FfmpegEncoder(const char* filename, int width, int height, int fps, int bitrate, bool h265, bool downscale,
+                bool write = true, int threads = 0);
+  ~FfmpegEncoder();
+  int encode_frame(const uint8_t *y_ptr, const uint8_t *u_ptr, const uint8_t *v_ptr,
+                   int in_width, int in_height, uint64_t ts);
+  void encoder_open(const char* path);
+  void encoder_close();
+
+private:
+  int write_packets();
+
+  const char* filename;
+  int width, height, fps, bitrate, threads;
+  bool h265, downscale, write;
+  int counter = 0;
+  bool is_open = false;
+
+  std::string vid_path, lock_path;
+
+  AVCodec *codec = NULL;
+  AVCodecContext *codec_ctx = NULL;
+
+  AVStream *stream = NULL;
+  AVFormatContext *format_ctx = NULL;
+
+  AVFrame *frame = NULL;
+  AVPacket *pkt = NULL;
+
+  // frames from a larger camera are scaled down in here
+  std::vector<uint8_t> scaled;
+};
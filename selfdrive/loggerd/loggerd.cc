@@ -1,5 +1,11 @@
 #include "selfdrive/loggerd/loggerd.h"
 
+#include <memory>
+
+#include "libyuv.h"
+
+#include "selfdrive/common/queue.h"
+
 ExitHandler do_exit;
 
 // Handle initial encoder syncing by waiting for all encoders to reach the same frame id
@@ -37,13 +43,198 @@ bool trigger_rotate_if_needed(LoggerdState *s, int cur_seg, uint32_t frame_id) {
   return false;
 }
 
+// A camera frame scaled down for the encoders that downscale. It's scaled once
+// per frame and shared by every encoder of the same size.
+struct ScaledFrame {
+  int width, height;
+  std::vector<uint8_t> yuv;
+  uint8_t *y, *u, *v;
+
+  ScaledFrame(int width, int height) : width(width), height(height), yuv(width * height * 3 / 2) {
+    y = yuv.data();
+    u = y + width * height;
+    v = u + width * height / 4;
+  }
+
+  void scale(const VisionBuf *buf) {
+    libyuv::I420Scale(buf->y, buf->width,
+                      buf->u, buf->width/2,
+                      buf->v, buf->width/2,
+                      buf->width, buf->height,
+                      y, width,
+                      u, width/2,
+                      v, width/2,
+                      width, height,
+                      libyuv::kFilterNone);
+  }
+};
+
+// Scaled frames of one size, reused once the encoders are done with them.
+// Must outlive the frames it handed out.
+class ScaledFramePool {
+public:
+  ScaledFramePool(int width, int height) : width(width), height(height) {}
+
+  std::shared_ptr<const ScaledFrame> get(const VisionBuf *buf) {
+    ScaledFrame *f = nullptr;
+    if (!free.try_pop(f)) {
+      f = frames.emplace_back(std::make_unique<ScaledFrame>(width, height)).get();
+    }
+    f->scale(buf);
+    return std::shared_ptr<const ScaledFrame>(f, [this](const ScaledFrame *f) { free.push((ScaledFrame *)f); });
+  }
+
+private:
+  int width, height;
+  std::vector<std::unique_ptr<ScaledFrame>> frames;
+  SafeQueue<ScaledFrame *> free;
+};
+
+// The segment the encoders write to. The logger handle is closed once the
+// last frame of the segment is encoded.
+struct EncoderSegment {
+  int num;
+  std::string path;
+  LoggerHandle *lh;
+
+  EncoderSegment(int num, const std::string &path, LoggerHandle *lh) : num(num), path(path), lh(lh) {}
+  ~EncoderSegment() {
+    if (lh) lh_close(lh);
+  }
+};
+
+// A camera frame fanned out to the encoder workers. Every worker holds a
+// reference until it's done encoding, and the VisionBuf stays acquired, so
+// camerad doesn't write to it, until the last one lets go.
+struct EncoderFrame {
+  VisionIpcClient *vipc_client;
+  VisionBuf *buf;
+  VisionIpcBufExtra extra;
+  int encode_idx;
+  std::shared_ptr<EncoderSegment> segment;
+  std::vector<std::shared_ptr<const ScaledFrame>> scaled;  // one per downscaled size
+
+  EncoderFrame(VisionIpcClient *vipc_client, VisionBuf *buf) : vipc_client(vipc_client), buf(buf) {
+    vipc_client->acquire(buf);
+  }
+  ~EncoderFrame() {
+    vipc_client->release(buf);
+  }
+};
+
+// Runs one encoder on its own thread, so encoders of the same camera don't
+// wait on each other. Frames are dropped when its queue is full instead of
+// holding up the camera.
+class EncoderWorker {
+public:
+  EncoderWorker(const LogCameraInfo &cam_info, Encoder *encoder, const char *name,
+                int scaled_idx, int max_queued, bool publish_idx)
+    : cam_info(cam_info), encoder(encoder), name(name), scaled_idx(scaled_idx),
+      max_queued(max_queued), publish_idx(publish_idx) {
+    thread = std::thread(&EncoderWorker::run, this);
+  }
+
+  ~EncoderWorker() {
+    thread.join();
+    encoder->encoder_close();
+    delete encoder;
+  }
+
+  void push(const std::shared_ptr<EncoderFrame> &frame) {
+    if (queue.size() >= max_queued) {
+      ++dropped;
+      return;
+    }
+    queue.push(frame);
+  }
+
+private:
+  void run() {
+    util::set_thread_name(name);
+
+    std::shared_ptr<EncoderSegment> segment;
+    while (!do_exit) {
+      std::shared_ptr<EncoderFrame> frame;
+      if (!queue.try_pop(frame, 50)) continue;
+
+      // rotate the encoder when the frame is from a newer segment
+      if (frame->segment != segment) {
+        if (segment) log_drops(segment->num);
+        segment = frame->segment;
+        encoder->encoder_close();
+        encoder->encoder_open(segment->path.c_str());
+      }
+
+      int out_id;
+      if (scaled_idx < 0) {
+        VisionBuf *buf = frame->buf;
+        out_id = encoder->encode_frame(buf->y, buf->u, buf->v, buf->width, buf->height, frame->extra.timestamp_eof);
+      } else {
+        const ScaledFrame *f = frame->scaled[scaled_idx].get();
+        out_id = encoder->encode_frame(f->y, f->u, f->v, f->width, f->height, frame->extra.timestamp_eof);
+      }
+      if (out_id == -1) {
+        LOGE("Failed to encode frame. frame_id: %d encode_id: %d", frame->extra.frame_id, frame->encode_idx);
+      }
+
+      // camerad may have reused the buffer while it waited in the queue
+      bool valid = (frame->buf->get_frame_id() == frame->extra.frame_id);
+      if (!valid) ++overwritten;
+
+      // publish encode index
+      if (publish_idx && out_id != -1) {
+        MessageBuilder msg;
+        // this is really ugly
+        auto eidx = cam_info.type == DriverCam ? msg.initEvent(valid).initDriverEncodeIdx() :
+                   (cam_info.type == WideRoadCam ? msg.initEvent(valid).initWideRoadEncodeIdx() : msg.initEvent(valid).initRoadEncodeIdx());
+        eidx.setFrameId(frame->extra.frame_id);
+        eidx.setTimestampSof(frame->extra.timestamp_sof);
+        eidx.setTimestampEof(frame->extra.timestamp_eof);
+        if (Hardware::TICI()) {
+          eidx.setType(cereal::EncodeIndex::Type::FULL_H_E_V_C);
+        } else {
+          eidx.setType(cam_info.type == DriverCam ? cereal::EncodeIndex::Type::FRONT : cereal::EncodeIndex::Type::FULL_H_E_V_C);
+        }
+        eidx.setEncodeId(frame->encode_idx);
+        eidx.setSegmentNum(segment->num);
+        eidx.setSegmentId(out_id);
+        if (segment->lh) {
+          // TODO: this should read cereal/services.h for qlog decimation
+          auto bytes = msg.toBytes();
+          lh_log(segment->lh, bytes.begin(), bytes.size(), true);
+        }
+      }
+    }
+    if (segment) log_drops(segment->num);
+  }
+
+  void log_drops(int segment_num) {
+    int d = dropped.exchange(0), o = overwritten.exchange(0);
+    if (d > 0 || o > 0) {
+      LOGE("%s segment %d: %d frames dropped, %d overwritten before encoding", name, segment_num, d, o);
+    }
+  }
+
+  const LogCameraInfo &cam_info;
+  Encoder *encoder;
+  const char *name;
+  int scaled_idx;  // scaled frame to encode, -1 for the camera buffer
+  int max_queued;
+  bool publish_idx;
+
+  SafeQueue<std::shared_ptr<EncoderFrame>> queue;
+  std::atomic<int> dropped = 0, overwritten = 0;
+  std::thread thread;
+};
+
 void encoder_thread(LoggerdState *s, const LogCameraInfo &cam_info) {
   util::set_thread_name(cam_info.filename);
 
   int cur_seg = -1;
   int encode_idx = 0;
-  LoggerHandle *lh = NULL;
-  std::vector<Encoder *> encoders;
+  std::shared_ptr<EncoderSegment> segment;
+  std::vector<std::unique_ptr<ScaledFramePool>> scaled_pools;
+  std::vector<std::unique_ptr<EncoderWorker>> workers;
   VisionIpcClient vipc_client = VisionIpcClient("camerad", cam_info.stream_type, false);
 
   while (!do_exit) {
@@ -53,18 +244,26 @@ void encoder_thread(LoggerdState *s, const LogCameraInfo &cam_info) {
     }
 
     // init encoders
-    if (encoders.empty()) {
+    if (workers.empty()) {
       VisionBuf buf_info = vipc_client.buffers[0];
       LOGD("encoder init %dx%d", buf_info.width, buf_info.height);
 
+      // camerad skips the buffers of queued frames, leave it most of them
+      const int max_queued = std::max(vipc_client.num_buffers / 2, 1);
+
       // main encoder
-      encoders.push_back(new Encoder(cam_info.filename, buf_info.width, buf_info.height,
-                                     cam_info.fps, cam_info.bitrate, cam_info.is_h265,
-                                     cam_info.downscale, cam_info.record));
+      workers.push_back(std::make_unique<EncoderWorker>(cam_info,
+        new Encoder(cam_info.filename, buf_info.width, buf_info.height,
+                    cam_info.fps, cam_info.bitrate, cam_info.is_h265,
+                    cam_info.downscale, cam_info.record),
+        cam_info.filename, -1, max_queued, true));
       // qcamera encoder
       if (cam_info.has_qcamera) {
-        encoders.push_back(new Encoder(qcam_info.filename, qcam_info.frame_width, qcam_info.frame_height,
-                                       qcam_info.fps, qcam_info.bitrate, qcam_info.is_h265, qcam_info.downscale));
+        scaled_pools.push_back(std::make_unique<ScaledFramePool>(qcam_info.frame_width, qcam_info.frame_height));
+        workers.push_back(std::make_unique<EncoderWorker>(qcam_info,
+          new Encoder(qcam_info.filename, qcam_info.frame_width, qcam_info.frame_height,
+                      qcam_info.fps, qcam_info.bitrate, qcam_info.is_h265, qcam_info.downscale),
+          qcam_info.filename, scaled_pools.size() - 1, max_queued, false));
       }
     }
 
@@ -84,70 +283,31 @@ void encoder_thread(LoggerdState *s, const LogCameraInfo &cam_info) {
         if (do_exit) break;
       }
 
-      // rotate the encoder if the logger is on a newer segment
+      // move the encoders to the new segment if the logger is on a newer one
       if (s->rotate_segment > cur_seg) {
         cur_seg = s->rotate_segment;
 
         LOGW("camera %d rotate encoder to %s", cam_info.type, s->segment_path);
-        for (auto &e : encoders) {
-          e->encoder_close();
-          e->encoder_open(s->segment_path);
-        }
-        if (lh) {
-          lh_close(lh);
-        }
-        lh = logger_get_handle(&s->logger);
+        segment = std::make_shared<EncoderSegment>(cur_seg, s->segment_path, logger_get_handle(&s->logger));
       }
 
-      // encode a frame
-      for (int i = 0; i < encoders.size(); ++i) {
-        int out_id = encoders[i]->encode_frame(buf->y, buf->u, buf->v,
-                                               buf->width, buf->height, extra.timestamp_eof);
-
-        if (out_id == -1) {
-          LOGE("Failed to encode frame. frame_id: %d encode_id: %d", extra.frame_id, encode_idx);
-        }
-
-        // publish encode index
-        if (i == 0 && out_id != -1) {
-          MessageBuilder msg;
-          // this is really ugly
-          bool valid = (buf->get_frame_id() == extra.frame_id);
-          auto eidx = cam_info.type == DriverCam ? msg.initEvent(valid).initDriverEncodeIdx() :
-                     (cam_info.type == WideRoadCam ? msg.initEvent(valid).initWideRoadEncodeIdx() : msg.initEvent(valid).initRoadEncodeIdx());
-          eidx.setFrameId(extra.frame_id);
-          eidx.setTimestampSof(extra.timestamp_sof);
-          eidx.setTimestampEof(extra.timestamp_eof);
-          if (Hardware::TICI()) {
-            eidx.setType(cereal::EncodeIndex::Type::FULL_H_E_V_C);
-          } else {
-            eidx.setType(cam_info.type == DriverCam ? cereal::EncodeIndex::Type::FRONT : cereal::EncodeIndex::Type::FULL_H_E_V_C);
-          }
-          eidx.setEncodeId(encode_idx);
-          eidx.setSegmentNum(cur_seg);
-          eidx.setSegmentId(out_id);
-          if (lh) {
-            // TODO: this should read cereal/services.h for qlog decimation
-            auto bytes = msg.toBytes();
-            lh_log(lh, bytes.begin(), bytes.size(), true);
-          }
-        }
+      // hand the frame to every encoder
+      auto frame = std::make_shared<EncoderFrame>(&vipc_client, buf);
+      frame->extra = extra;
+      frame->encode_idx = encode_idx++;
+      frame->segment = segment;
+      for (auto &pool : scaled_pools) {
+        frame->scaled.push_back(pool->get(buf));
+      }
+      for (auto &w : workers) {
+        w->push(frame);
       }
-
-      encode_idx++;
-    }
-
-    if (lh) {
-      lh_close(lh);
-      lh = NULL;
     }
   }
 
   LOG("encoder destroy");
-  for(auto &e : encoders) {
-    e->encoder_close();
-    delete e;
-  }
+  // workers first, they hold frames from the pools
+  workers.clear();
 }
 
 void logger_rotate(LoggerdState *s) {
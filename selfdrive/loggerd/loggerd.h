@@ -28,8 +28,8 @@
 #include "selfdrive/loggerd/omx_encoder.h"
 #define Encoder OmxEncoder
 #else
-#include "selfdrive/loggerd/raw_logger.h"
-#define Encoder RawLogger
+#include "selfdrive/loggerd/ffmpeg_encoder.h"
+#define Encoder FfmpegEncoder
 #endif
 
 constexpr int MAIN_FPS = 20;
@@ -428,7 +428,7 @@ int OmxEncoder::encode_frame(const uint8_t *y_ptr, const uint8_t *u_ptr, const u
   // uint8_t *in_uv_ptr = in_buf_ptr + (this->width * this->height);
   uint8_t *in_uv_ptr = in_buf_ptr + (in_y_stride * VENUS_Y_SCANLINES(COLOR_FMT_NV12, this->height));
 
-  if (this->downscale) {
+  if (this->downscale && (in_width != this->width || in_height != this->height)) {
     I420Scale(y_ptr, in_width,
               u_ptr, in_width/2,
               v_ptr, in_width/2,
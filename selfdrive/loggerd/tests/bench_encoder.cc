@@ -0,0 +1,158 @@
+#include <getopt.h>
+#include <sys/stat.h>
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "libyuv.h"
+
+#include "selfdrive/common/timing.h"
+#include "selfdrive/common/util.h"
+#include "selfdrive/loggerd/ffmpeg_encoder.h"
+#include "selfdrive/loggerd/raw_logger.h"
+
+// Encodes synthetic frames for the three cameras at once, one thread per
+// camera like loggerd, with qcamera scaled from the road camera. Reports the
+// encode fps and the file size per minute of each encoder.
+//
+// usage: bench_encoder [-n frames] [-t threads] [-e ffmpeg|raw] [-o dir]
+
+const int FPS = 20;
+const int WIDTH = 1928, HEIGHT = 1208;
+
+struct BenchEncoder {
+  const char *filename;
+  int width, height, bitrate;
+  bool h265, downscale;
+  std::unique_ptr<VideoEncoder> encoder;
+  double encode_ms = 0;
+  size_t bytes = 0;
+};
+
+struct BenchCamera {
+  std::vector<BenchEncoder> encoders;
+};
+
+// a textured scene panning a little every frame, so there's motion to search
+static std::vector<std::vector<uint8_t>> make_frames(int count) {
+  const int pad = 2 * count;
+  std::vector<uint8_t> y((WIDTH + pad) * (HEIGHT + pad)), uv((WIDTH + pad) * (HEIGHT + pad) / 4);
+  srand(0);
+  for (int r = 0; r < HEIGHT + pad; r++) {
+    for (int c = 0; c < WIDTH + pad; c++) {
+      y[r * (WIDTH + pad) + c] = 128 + 60 * std::sin(c * 0.05) * std::cos(r * 0.07) + rand() % 16;
+    }
+  }
+  for (int i = 0; i < uv.size(); i++) {
+    uv[i] = 128 + rand() % 8;
+  }
+
+  std::vector<std::vector<uint8_t>> frames(count, std::vector<uint8_t>(WIDTH * HEIGHT * 3 / 2));
+  for (int i = 0; i < count; i++) {
+    uint8_t *dst = frames[i].data();
+    libyuv::CopyPlane(&y[2 * i * (WIDTH + pad) + 2 * i], WIDTH + pad, dst, WIDTH, WIDTH, HEIGHT);
+    libyuv::CopyPlane(&uv[i * (WIDTH + pad) / 2 + i], (WIDTH + pad) / 2, dst + WIDTH * HEIGHT, WIDTH / 2, WIDTH / 2, HEIGHT / 2);
+    libyuv::CopyPlane(&uv[i * (WIDTH + pad) / 2 + i], (WIDTH + pad) / 2, dst + WIDTH * HEIGHT * 5 / 4, WIDTH / 2, WIDTH / 2, HEIGHT / 2);
+  }
+  return frames;
+}
+
+static void run_camera(BenchCamera *cam, const std::vector<std::vector<uint8_t>> *frames, int n, const std::string &dir) {
+  // scaled once for all the encoders that downscale, like encoder_thread
+  std::vector<uint8_t> scaled;
+  for (auto &e : cam->encoders) {
+    if (e.downscale) scaled.resize(e.width * e.height * 3 / 2);
+    e.encoder->encoder_open(dir.c_str());
+  }
+
+  for (int i = 0; i < n; i++) {
+    const uint8_t *y = (*frames)[i % frames->size()].data();
+    const uint8_t *u = y + WIDTH * HEIGHT, *v = u + WIDTH * HEIGHT / 4;
+    for (auto &e : cam->encoders) {
+      double t1 = millis_since_boot();
+      if (e.downscale) {
+        uint8_t *sy = scaled.data(), *su = sy + e.width * e.height, *sv = su + e.width * e.height / 4;
+        libyuv::I420Scale(y, WIDTH, u, WIDTH / 2, v, WIDTH / 2, WIDTH, HEIGHT,
+                          sy, e.width, su, e.width / 2, sv, e.width / 2, e.width, e.height, libyuv::kFilterNone);
+        e.encoder->encode_frame(sy, su, sv, e.width, e.height, i * 1e9 / FPS);
+      } else {
+        e.encoder->encode_frame(y, u, v, WIDTH, HEIGHT, i * 1e9 / FPS);
+      }
+      e.encode_ms += millis_since_boot() - t1;
+    }
+  }
+
+  for (auto &e : cam->encoders) {
+    double t1 = millis_since_boot();
+    e.encoder->encoder_close();
+    e.encode_ms += millis_since_boot() - t1;
+  }
+}
+
+int main(int argc, char **argv) {
+  int n = 400, threads = 0;
+  std::string backend = "ffmpeg", dir = "/tmp/bench_encoder";
+  int opt;
+  while ((opt = getopt(argc, argv, "n:t:e:o:")) != -1) {
+    switch (opt) {
+      case 'n': n = atoi(optarg); break;
+      case 't': threads = atoi(optarg); break;
+      case 'e': backend = optarg; break;
+      case 'o': dir = optarg; break;
+      default:
+        printf("usage: %s [-n frames] [-t threads] [-e ffmpeg|raw] [-o dir]\n", argv[0]);
+        return 1;
+    }
+  }
+  if (backend != "ffmpeg" && backend != "raw") {
+    printf("unknown encoder %s\n", backend.c_str());
+    return 1;
+  }
+  util::create_directories(dir, 0775);
+
+  std::vector<BenchCamera> cameras(3);
+  cameras[0].encoders.push_back({"fcamera.hevc", WIDTH, HEIGHT, 10000000, true, false});
+  cameras[0].encoders.push_back({"qcamera.ts", 526, 330, 256000, false, true});
+  cameras[1].encoders.push_back({"dcamera.hevc", WIDTH, HEIGHT, 10000000, true, false});
+  cameras[2].encoders.push_back({"ecamera.hevc", WIDTH, HEIGHT, 10000000, true, false});
+  for (auto &cam : cameras) {
+    for (auto &e : cam.encoders) {
+      if (backend == "ffmpeg") {
+        e.encoder.reset(new FfmpegEncoder(e.filename, e.width, e.height, FPS, e.bitrate, e.h265, e.downscale, true, threads));
+      } else {
+        e.encoder.reset(new RawLogger(e.filename, e.width, e.height, FPS, e.bitrate, e.h265, e.downscale));
+      }
+    }
+  }
+
+  auto frames = make_frames(FPS);
+  printf("encoding %d frames of %dx%d with %s\n", n, WIDTH, HEIGHT, backend.c_str());
+
+  double t1 = millis_since_boot();
+  std::vector<std::thread> camera_threads;
+  for (auto &cam : cameras) {
+    camera_threads.emplace_back(run_camera, &cam, &frames, n, dir);
+  }
+  for (auto &t : camera_threads) t.join();
+  double wall_ms = millis_since_boot() - t1;
+
+  printf("%-14s %10s %10s %12s\n", "encoder", "size", "fps", "MB/minute");
+  for (auto &cam : cameras) {
+    for (auto &e : cam.encoders) {
+      // RawLogger adds its own extension
+      std::string path = dir + "/" + e.filename + (backend == "raw" ? ".mkv" : "");
+      struct stat st = {};
+      stat(path.c_str(), &st);
+      e.bytes = st.st_size;
+      printf("%-14s %4dx%-5d %10.1f %12.2f\n", e.filename, e.width, e.height,
+             n / (e.encode_ms / 1000.), e.bytes / 1e6 / n * FPS * 60);
+    }
+  }
+  printf("all cameras: %.1f fps, realtime is %d\n", n / (wall_ms / 1000.), FPS);
+  return 0;
+}
@@ -1,6 +1,10 @@
+#include <algorithm>
+#include <array>
 #include <cstdio>
 #include <cstdlib>
 #include <mutex>
+#include <thread>
+#include <vector>
 
 #include <eigen3/Eigen/Dense>
 
@@ -8,6 +12,7 @@
 #include "cereal/visionipc/visionipc_client.h"
 #include "selfdrive/common/clutil.h"
 #include "selfdrive/common/params.h"
+#include "selfdrive/common/queue.h"
 #include "selfdrive/common/swaglog.h"
 #include "selfdrive/common/util.h"
 #include "selfdrive/hardware/hw.h"
@@ -50,65 +55,154 @@ mat3 update_calibration(cereal::LiveCalibrationData::Reader live_calib, bool wid
   return matmul3(yuv_transform, transform);
 }
 
+// a frame on its way through modeld, owned by one stage at a time
+struct ModelJob {
+  std::vector<float> input;
+  std::array<float, NET_OUTPUT_SIZE> output;
+  float vec_desire[DESIRE_LEN];
+  VisionIpcBufExtra extra;
+  uint32_t frame_id;
+  uint32_t vipc_dropped_frames;
+  float frame_drop_ratio;
+  bool live_calib_seen;
+  // millis_since_boot at each stage boundary
+  double t_received, t_prepared, t_execute_start, t_executed;
+};
+
+// frames in flight: one being prepared, one in the net and one being published
+constexpr int MODEL_JOBS = 3;
+
+void inference_thread(ModelState &model, SafeQueue<ModelJob *> &prepared_jobs, SafeQueue<ModelJob *> &done_jobs) {
+  ModelJob *job;
+  while (!do_exit) {
+    if (!prepared_jobs.try_pop(job, 100)) continue;
+
+    job->t_execute_start = millis_since_boot();
+    model_execute(&model, job->input.data(), job->vec_desire);
+    job->t_executed = millis_since_boot();
+    job->output = model.output;
+    done_jobs.push(job);
+  }
+}
+
+void publish_thread(SafeQueue<ModelJob *> &done_jobs, SafeQueue<ModelJob *> &free_jobs) {
+  PubMaster pm({"modelV2", "cameraOdometry"});
+  // first segments sized to fit each message, reused every frame
+  auto model_buf = MessageBuilder::firstSegment(8192);
+  auto posenet_buf = MessageBuilder::firstSegment(256);
+
+  ModelJob *job;
+  while (!do_exit) {
+    if (!done_jobs.try_pop(job, 100)) continue;
+
+    const ModelOutput &model_output = *(const ModelOutput *)job->output.data();
+    const double t_publish = millis_since_boot();
+    const ModelTimings timings = {
+      .receive = float(job->t_received / 1000. - job->extra.timestamp_eof / 1e9),
+      .prepare = float((job->t_prepared - job->t_received) / 1000.),
+      .queue = float((job->t_execute_start - job->t_prepared) / 1000.),
+      .execute = float((job->t_executed - job->t_execute_start) / 1000.),
+      .publish = float((t_publish - job->t_executed) / 1000.),
+    };
+    const float model_execution_time = timings.prepare + timings.execute;
+
+    {
+      MessageBuilder msg(model_buf);
+      model_publish(pm, msg, job->extra.frame_id, job->frame_id, job->frame_drop_ratio, model_output, job->extra.timestamp_eof,
+                    model_execution_time, timings, kj::ArrayPtr<const float>(job->output.data(), job->output.size()), job->live_calib_seen);
+    }
+    {
+      MessageBuilder msg(posenet_buf);
+      posenet_publish(pm, msg, job->extra.frame_id, job->vipc_dropped_frames, model_output, job->extra.timestamp_eof, job->live_calib_seen);
+    }
+    free_jobs.push(job);
+  }
+}
+
 void run_model(ModelState &model, VisionIpcClient &vipc_client, bool wide_camera) {
   // messaging
-  PubMaster pm({"modelV2", "cameraOdometry"});
   SubMaster sm({"lateralPlan", "roadCameraState", "liveCalibration"});
 
   // setup filter to track dropped frames
   FirstOrderFilter frame_dropped_filter(0., 10., 1. / MODEL_FREQ);
 
-  uint32_t frame_id = 0, last_vipc_frame_id = 0;
-  double last = 0;
+  uint32_t last_vipc_frame_id = 0;
   uint32_t run_count = 0;
 
   mat3 model_transform = {};
   bool live_calib_seen = false;
 
+  // the warp for the next frame runs while the net runs on this one. Runners
+  // that read their input from the GPU (thneed) run both in model_eval_frame
+  const bool pipelined = model.m->getInputBuf() == nullptr;
+  LOGW("modeld %s", pipelined ? "pipelined" : "serial");
+
+  std::array<ModelJob, MODEL_JOBS> jobs;
+  SafeQueue<ModelJob *> free_jobs, prepared_jobs, done_jobs;
+  for (auto &job : jobs) {
+    job.input.resize(model.frame->MODEL_FRAME_SIZE);
+    free_jobs.push(&job);
+  }
+
+  std::thread publisher(publish_thread, std::ref(done_jobs), std::ref(free_jobs));
+  std::thread inference;
+  if (pipelined) {
+    inference = std::thread(inference_thread, std::ref(model), std::ref(prepared_jobs), std::ref(done_jobs));
+  }
+
   while (!do_exit) {
-    VisionIpcBufExtra extra = {};
-    VisionBuf *buf = vipc_client.recv(&extra);
-    if (buf == nullptr) continue;
+    // wait for a free slot before taking the frame so a slow net drops frames here
+    ModelJob *job;
+    if (!free_jobs.try_pop(job, 100)) continue;
+
+    VisionBuf *buf = nullptr;
+    while (!do_exit && buf == nullptr) {
+      buf = vipc_client.recv(&job->extra);
+    }
+    if (buf == nullptr) break;
+    job->t_received = millis_since_boot();
 
     // TODO: path planner timeout?
     sm.update(0);
     int desire = ((int)sm["lateralPlan"].getLateralPlan().getDesire());
-    frame_id = sm["roadCameraState"].getRoadCameraState().getFrameId();
+    job->frame_id = sm["roadCameraState"].getRoadCameraState().getFrameId();
     if (sm.updated("liveCalibration")) {
       model_transform = update_calibration(sm["liveCalibration"].getLiveCalibration(), wide_camera);
       live_calib_seen = true;
     }
+    job->live_calib_seen = live_calib_seen;
 
-    float vec_desire[DESIRE_LEN] = {0};
+    std::fill(std::begin(job->vec_desire), std::end(job->vec_desire), 0.f);
     if (desire >= 0 && desire < DESIRE_LEN) {
-      vec_desire[desire] = 1.0;
+      job->vec_desire[desire] = 1.0;
     }
 
-    double mt1 = millis_since_boot();
-    ModelOutput *model_output = model_eval_frame(&model, buf->buf_cl, buf->width, buf->height,
-                                              model_transform, vec_desire);
-    double mt2 = millis_since_boot();
-    float model_execution_time = (mt2 - mt1) / 1000.0;
-
     // tracked dropped frames
-    uint32_t vipc_dropped_frames = extra.frame_id - last_vipc_frame_id - 1;
-    float frames_dropped = frame_dropped_filter.update((float)std::min(vipc_dropped_frames, 10U));
+    job->vipc_dropped_frames = job->extra.frame_id - last_vipc_frame_id - 1;
+    float frames_dropped = frame_dropped_filter.update((float)std::min(job->vipc_dropped_frames, 10U));
     if (run_count < 10) { // let frame drops warm up
       frame_dropped_filter.reset(0);
       frames_dropped = 0.;
     }
     run_count++;
-
-    float frame_drop_ratio = frames_dropped / (1 + frames_dropped);
-
-    model_publish(pm, extra.frame_id, frame_id, frame_drop_ratio, *model_output, extra.timestamp_eof, model_execution_time,
-                  kj::ArrayPtr<const float>(model.output.data(), model.output.size()), live_calib_seen);
-    posenet_publish(pm, extra.frame_id, vipc_dropped_frames, *model_output, extra.timestamp_eof, live_calib_seen);
-
-    //printf("model process: %.2fms, from last %.2fms, vipc_frame_id %u, frame_id, %u, frame_drop %.3f\n", mt2 - mt1, mt1 - last, extra.frame_id, frame_id, frame_drop_ratio);
-    last = mt1;
-    last_vipc_frame_id = extra.frame_id;
+    job->frame_drop_ratio = frames_dropped / (1 + frames_dropped);
+    last_vipc_frame_id = job->extra.frame_id;
+
+    if (pipelined) {
+      model_prepare(&model, buf->buf_cl, buf->width, buf->height, model_transform, job->input.data());
+      job->t_prepared = millis_since_boot();
+      prepared_jobs.push(job);
+    } else {
+      job->t_prepared = job->t_execute_start = job->t_received;
+      model_eval_frame(&model, buf->buf_cl, buf->width, buf->height, model_transform, job->vec_desire);
+      job->t_executed = millis_since_boot();
+      job->output = model.output;
+      done_jobs.push(job);
+    }
   }
+
+  if (inference.joinable()) inference.join();
+  publisher.join();
 }
 
 int main(int argc, char **argv) {
@@ -42,6 +42,14 @@ float* ModelFrame::prepare(cl_mem yuv_cl, int frame_width, int frame_height, con
   }
 }
 
+void ModelFrame::prepare_frame(cl_mem yuv_cl, int frame_width, int frame_height, const mat3 &projection, float *output) {
+  transform_queue(&this->transform, q,
+                  yuv_cl, frame_width, frame_height,
+                  y_cl, u_cl, v_cl, MODEL_WIDTH, MODEL_HEIGHT, projection);
+  loadyuv_queue(&loadyuv, q, y_cl, u_cl, v_cl, net_input_cl);
+  CL_CHECK(clEnqueueReadBuffer(q, net_input_cl, CL_TRUE, 0, MODEL_FRAME_SIZE * sizeof(float), output, 0, nullptr, nullptr));
+}
+
 ModelFrame::~ModelFrame() {
   transform_destroy(&transform);
   loadyuv_destroy(&loadyuv);
@@ -6,6 +6,7 @@
 #include "selfdrive/common/util.h"
 #include "selfdrive/modeld/models/commonmodel.h"
 #include "selfdrive/modeld/runners/run.h"
+#include "selfdrive/modeld/transforms/dmonitoring_transform.h"
 
 #define OUTPUT_SIZE 39
 
@@ -32,11 +33,9 @@ typedef struct DMonitoringModelState {
   RunModel *m;
   bool is_rhd;
   float output[OUTPUT_SIZE];
-  std::vector<uint8_t> resized_buf;
-  std::vector<uint8_t> cropped_buf;
-  std::vector<uint8_t> premirror_cropped_buf;
+  int frame_width, frame_height;
+  DMonitoringTransform transform;
   std::vector<float> net_input_buf;
-  float tensor[UINT8_MAX + 1];
 } DMonitoringModelState;
 
 void dmonitoring_init(DMonitoringModelState* s);
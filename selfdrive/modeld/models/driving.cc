@@ -28,6 +28,7 @@ constexpr const kj::ArrayPtr<const T> to_kj_array_ptr(const std::array<T, size>
 
 void model_init(ModelState* s, cl_device_id device_id, cl_context context) {
   s->frame = new ModelFrame(device_id, context);
+  s->net_input_buf = std::make_unique<float[]>(s->frame->buf_size);
 
 #ifdef USE_THNEED
   s->m = std::make_unique<ThneedModel>("../../models/supercombo.thneed", &s->output[0], NET_OUTPUT_SIZE, USE_GPU_RUNTIME);
@@ -52,8 +53,7 @@ void model_init(ModelState* s, cl_device_id device_id, cl_context context) {
 #endif
 }
 
-ModelOutput* model_eval_frame(ModelState* s, cl_mem yuv_cl, int width, int height,
-                           const mat3 &transform, float *desire_in) {
+static void update_desire(ModelState* s, float *desire_in) {
 #ifdef DESIRE
   if (desire_in != NULL) {
     for (int i = 1; i < DESIRE_LEN; i++) {
@@ -68,6 +68,11 @@ ModelOutput* model_eval_frame(ModelState* s, cl_mem yuv_cl, int width, int heigh
     }
   }
 #endif
+}
+
+ModelOutput* model_eval_frame(ModelState* s, cl_mem yuv_cl, int width, int height,
+                           const mat3 &transform, float *desire_in) {
+  update_desire(s, desire_in);
 
   // if getInputBuf is not NULL, net_input_buf will be
   auto net_input_buf = s->frame->prepare(yuv_cl, width, height, transform, static_cast<cl_mem*>(s->m->getInputBuf()));
@@ -76,6 +81,24 @@ ModelOutput* model_eval_frame(ModelState* s, cl_mem yuv_cl, int width, int heigh
   return (ModelOutput*)&s->output;
 }
 
+void model_prepare(ModelState* s, cl_mem yuv_cl, int width, int height, const mat3 &transform, float *input) {
+  assert(s->m->getInputBuf() == nullptr);
+  s->frame->prepare_frame(yuv_cl, width, height, transform, input);
+}
+
+ModelOutput* model_execute(ModelState* s, const float *input, float *desire_in) {
+  update_desire(s, desire_in);
+
+  // same frame history as ModelFrame::prepare, the previous frame followed by this one
+  const int frame_size = s->frame->MODEL_FRAME_SIZE;
+  float *net_input_buf = s->net_input_buf.get();
+  memmove(net_input_buf, net_input_buf + frame_size, frame_size * sizeof(float));
+  memcpy(net_input_buf + frame_size, input, frame_size * sizeof(float));
+  s->m->execute(net_input_buf, s->frame->buf_size);
+
+  return (ModelOutput*)&s->output;
+}
+
 void model_free(ModelState* s) {
   delete s->frame;
 }
@@ -306,17 +329,22 @@ void fill_model(cereal::ModelDataV2::Builder &framed, const ModelOutput &net_out
   }
 }
 
-void model_publish(PubMaster &pm, uint32_t vipc_frame_id, uint32_t frame_id, float frame_drop,
-                   const ModelOutput &net_outputs, uint64_t timestamp_eof,
-                   float model_execution_time, kj::ArrayPtr<const float> raw_pred, const bool valid) {
+void model_publish(PubMaster &pm, MessageBuilder &msg, uint32_t vipc_frame_id, uint32_t frame_id, float frame_drop,
+                   const ModelOutput &net_outputs, uint64_t timestamp_eof, float model_execution_time,
+                   const ModelTimings &timings, kj::ArrayPtr<const float> raw_pred, const bool valid) {
   const uint32_t frame_age = (frame_id > vipc_frame_id) ? (frame_id - vipc_frame_id) : 0;
-  MessageBuilder msg;
   auto framed = msg.initEvent(valid).initModelV2();
   framed.setFrameId(vipc_frame_id);
   framed.setFrameAge(frame_age);
   framed.setFrameDropPerc(frame_drop * 100);
   framed.setTimestampEof(timestamp_eof);
   framed.setModelExecutionTime(model_execution_time);
+  auto t = framed.initTimings();
+  t.setReceive(timings.receive);
+  t.setPrepare(timings.prepare);
+  t.setQueue(timings.queue);
+  t.setExecute(timings.execute);
+  t.setPublish(timings.publish);
   if (send_raw_pred) {
     framed.setRawPredictions(raw_pred.asBytes());
   }
@@ -324,9 +352,8 @@ void model_publish(PubMaster &pm, uint32_t vipc_frame_id, uint32_t frame_id, flo
   pm.send("modelV2", msg);
 }
 
-void posenet_publish(PubMaster &pm, uint32_t vipc_frame_id, uint32_t vipc_dropped_frames,
+void posenet_publish(PubMaster &pm, MessageBuilder &msg, uint32_t vipc_frame_id, uint32_t vipc_dropped_frames,
                      const ModelOutput &net_outputs, uint64_t timestamp_eof, const bool valid) {
-  MessageBuilder msg;
   const auto &v_mean = net_outputs.pose.velocity_mean;
   const auto &r_mean = net_outputs.pose.rotation_mean;
   const auto &v_std = net_outputs.pose.velocity_std;
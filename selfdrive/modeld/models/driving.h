@@ -220,6 +220,7 @@ constexpr int NET_OUTPUT_SIZE = OUTPUT_SIZE + TEMPORAL_SIZE;
 // TODO: convert remaining arrays to std::array and update model runners
 struct ModelState {
   ModelFrame *frame;
+  std::unique_ptr<float[]> net_input_buf;  // frame history for model_execute
   std::array<float, NET_OUTPUT_SIZE> output = {};
   std::unique_ptr<RunModel> m;
 #ifdef DESIRE
@@ -234,9 +235,24 @@ struct ModelState {
 void model_init(ModelState* s, cl_device_id device_id, cl_context context);
 ModelOutput *model_eval_frame(ModelState* s, cl_mem yuv_cl, int width, int height,
                            const mat3 &transform, float *desire_in);
+// model_eval_frame split in two for pipelining: model_prepare warps a frame into
+// input (MODEL_FRAME_SIZE floats) and can run while model_execute runs the net on
+// the previous one. Not available when the runner reads its input from the GPU.
+void model_prepare(ModelState* s, cl_mem yuv_cl, int width, int height, const mat3 &transform, float *input);
+ModelOutput *model_execute(ModelState* s, const float *input, float *desire_in);
 void model_free(ModelState* s);
-void model_publish(PubMaster &pm, uint32_t vipc_frame_id, uint32_t frame_id, float frame_drop,
-                   const ModelOutput &net_outputs, uint64_t timestamp_eof,
-                   float model_execution_time, kj::ArrayPtr<const float> raw_pred, const bool valid);
-void posenet_publish(PubMaster &pm, uint32_t vipc_frame_id, uint32_t vipc_dropped_frames,
+
+// seconds a frame spent in each modeld stage
+struct ModelTimings {
+  float receive;  // camera end of frame until received from visionipc
+  float prepare;  // warp and loadyuv
+  float queue;    // waiting for the net
+  float execute;  // the net
+  float publish;  // waiting for the publisher and building modelV2
+};
+
+void model_publish(PubMaster &pm, MessageBuilder &msg, uint32_t vipc_frame_id, uint32_t frame_id, float frame_drop,
+                   const ModelOutput &net_outputs, uint64_t timestamp_eof, float model_execution_time,
+                   const ModelTimings &timings, kj::ArrayPtr<const float> raw_pred, const bool valid);
+void posenet_publish(PubMaster &pm, MessageBuilder &msg, uint32_t vipc_frame_id, uint32_t vipc_dropped_frames,
                      const ModelOutput &net_outputs, uint64_t timestamp_eof, const bool valid);
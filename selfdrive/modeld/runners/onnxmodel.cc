@@ -0,0 +1,131 @@
+#include "selfdrive/modeld/runners/onnxmodel.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "selfdrive/common/util.h"
+
+// inputs the runners add next to the image
+static const char *DESIRE = "desire";
+static const char *TRAFFIC_CONVENTION = "traffic_convention";
+static const char *RECURRENT_STATE = "initial_state";
+
+static size_t shape_size(std::vector<int64_t> &shape) {
+  size_t size = 1;
+  for (auto &d : shape) {
+    // dynamic dimensions are the batch size
+    if (d < 0) d = 1;
+    size *= d;
+  }
+  return size;
+}
+
+ONNXModel::ONNXModel(const char *path, float *loutput, size_t loutput_size, int runtime)
+    : env(ORT_LOGGING_LEVEL_WARNING, "onnxmodel"), output(loutput), output_size(loutput_size) {
+  // everything runs on the CPU execution provider, the runtime is ignored
+  try {
+    Ort::SessionOptions options;
+    options.SetGraphOptimizationLevel(GraphOptimizationLevel::ORT_ENABLE_ALL);
+    options.SetExecutionMode(ExecutionMode::ORT_SEQUENTIAL);
+    options.SetIntraOpNumThreads(util::getenv("ONNX_THREADS", 0));
+    options.SetInterOpNumThreads(1);
+    session = Ort::Session(env, path, options);
+    memory_info = Ort::MemoryInfo::CreateCpu(OrtArenaAllocator, OrtMemTypeDefault);
+
+    Ort::AllocatorWithDefaultOptions allocator;
+    for (size_t i = 0; i < session.GetInputCount(); i++) {
+      Ort::TypeInfo type_info = session.GetInputTypeInfo(i);
+      auto info = type_info.GetTensorTypeAndShapeInfo();
+      assert(info.GetElementType() == ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT);
+      Input &input = inputs.emplace_back();
+      input.name = session.GetInputNameAllocated(i, allocator).get();
+      input.shape = info.GetShape();
+      input.size = shape_size(input.shape);
+    }
+    for (auto &input : inputs) {
+      input_names.push_back(input.name.c_str());
+    }
+    auto is_image = [](const Input &input) {
+      for (auto name : {DESIRE, TRAFFIC_CONVENTION, RECURRENT_STATE}) {
+        if (input.name == name) return false;
+      }
+      return true;
+    };
+    image_idx = std::find_if(inputs.begin(), inputs.end(), is_image) - inputs.begin();
+    if (image_idx == inputs.size()) {
+      fprintf(stderr, "failed to load %s: no image input\n", path);
+      std::exit(EXIT_FAILURE);
+    }
+    for (size_t i = 0; i < inputs.size(); i++) {
+      input_values.emplace_back(nullptr);
+    }
+
+    assert(session.GetOutputCount() == 1);
+    output_name = session.GetOutputNameAllocated(0, allocator).get();
+    std::vector<int64_t> output_shape = session.GetOutputTypeInfo(0).GetTensorTypeAndShapeInfo().GetShape();
+    size_t size = shape_size(output_shape);
+    if (output_size != 0) {
+      assert(output_size == size);
+    } else {
+      output_size = size;
+    }
+    output_value = Ort::Value::CreateTensor<float>(memory_info, output, output_size, output_shape.data(), output_shape.size());
+  } catch (const Ort::Exception &e) {
+    fprintf(stderr, "failed to load %s: %s\n", path, e.what());
+    std::exit(EXIT_FAILURE);
+  }
+
+  printf("loaded model %s: %s -> %s\n", path, inputs[image_idx].name.c_str(), output_name.c_str());
+}
+
+void ONNXModel::addRecurrent(float *state, int state_size) {
+  recurrent = state;
+  recurrent_input.assign(state, state + state_size);
+  addExtra(recurrent_input.data(), state_size, RECURRENT_STATE);
+}
+
+void ONNXModel::addTrafficConvention(float *state, int state_size) {
+  addExtra(state, state_size, TRAFFIC_CONVENTION);
+}
+
+void ONNXModel::addDesire(float *state, int state_size) {
+  addExtra(state, state_size, DESIRE);
+}
+
+void ONNXModel::addExtra(float *state, int state_size, const char *name) {
+  auto it = std::find_if(inputs.begin(), inputs.end(), [=](const Input &input) { return input.name == name; });
+  if (it == inputs.end()) {
+    fprintf(stderr, "model has no input %s\n", name);
+    std::exit(EXIT_FAILURE);
+  }
+  const size_t idx = it - inputs.begin();
+  printf("adding index %zu: %s\n", idx, name);
+  assert(it->size == state_size);
+  input_values[idx] = Ort::Value::CreateTensor<float>(memory_info, state, state_size, it->shape.data(), it->shape.size());
+}
+
+void ONNXModel::execute(float *net_input_buf, int buf_size) {
+  Input &image = inputs[image_idx];
+  assert(image.size == buf_size);
+  input_values[image_idx] = Ort::Value::CreateTensor<float>(memory_info, net_input_buf, buf_size, image.shape.data(), image.shape.size());
+
+  if (recurrent != nullptr) {
+    memcpy(recurrent_input.data(), recurrent, recurrent_input.size() * sizeof(float));
+  }
+
+  for (auto &v : input_values) {
+    assert(v && "missing model input");
+  }
+
+  const char *output_names[] = {output_name.c_str()};
+  try {
+    session.Run(Ort::RunOptions{nullptr}, input_names.data(), input_values.data(), input_values.size(),
+                output_names, &output_value, 1);
+  } catch (const Ort::Exception &e) {
+    fprintf(stderr, "onnx model failed: %s\n", e.what());
+    std::exit(EXIT_FAILURE);
+  }
+}
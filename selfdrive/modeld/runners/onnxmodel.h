@@ -0,0 +1,51 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <onnxruntime/onnxruntime_cxx_api.h>
+
+#include "selfdrive/modeld/runners/runmodel.h"
+
+// Runs the onnx model in process on the onnxruntime CPU execution provider.
+// Inputs are bound by name: desire, traffic_convention and initial_state, and
+// the image is the input that isn't one of those. The output is written
+// straight into loutput.
+// ONNX_THREADS sets the number of intra op threads, the default is one per
+// physical core.
+class ONNXModel : public RunModel {
+public:
+  ONNXModel(const char *path, float *loutput, size_t loutput_size, int runtime);
+  void addRecurrent(float *state, int state_size);
+  void addTrafficConvention(float *state, int state_size);
+  void addDesire(float *state, int state_size);
+  void execute(float *net_input_buf, int buf_size);
+
+private:
+  struct Input {
+    std::string name;
+    std::vector<int64_t> shape;
+    size_t size;
+  };
+
+  void addExtra(float *state, int state_size, const char *name);
+
+  Ort::Env env;
+  Ort::Session session{nullptr};
+  Ort::MemoryInfo memory_info{nullptr};
+
+  std::vector<Input> inputs;
+  size_t image_idx;
+  std::vector<const char *> input_names;
+  std::vector<Ort::Value> input_values;  // tensors wrapping the caller's buffers
+
+  std::string output_name;
+  Ort::Value output_value{nullptr};
+  float *output;
+  size_t output_size;
+
+  // the recurrent state is fed back from the output buffer, onnxruntime gets a
+  // copy so it never reads an input that it is writing to
+  float *recurrent = nullptr;
+  std::vector<float> recurrent_input;
+};
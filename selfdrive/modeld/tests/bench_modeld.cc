@@ -0,0 +1,79 @@
+#include <algorithm>
+#include <cassert>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "selfdrive/common/clutil.h"
+#include "selfdrive/common/timing.h"
+#include "selfdrive/common/util.h"
+#include "selfdrive/modeld/models/driving.h"
+
+// Runs the driving model over road camera frames dumped from a route with
+// dump_road_frames.py and reports frames/s and ms per frame, the same way
+// modeld times model_eval_frame.
+//
+// usage: bench_modeld <frames> [passes]
+
+int main(int argc, char **argv) {
+  if (argc < 2) {
+    printf("usage: %s <frames> [passes]\n", argv[0]);
+    return 1;
+  }
+  const int passes = argc > 2 ? std::atoi(argv[2]) : 1;
+
+  std::string data = util::read_file(argv[1]);
+  assert(data.size() > 2 * sizeof(int32_t));
+  int32_t width, height;
+  memcpy(&width, data.data(), sizeof(width));
+  memcpy(&height, data.data() + sizeof(width), sizeof(height));
+  const size_t frame_size = width * height * 3 / 2;
+  const uint8_t *frames = (const uint8_t *)data.data() + 2 * sizeof(int32_t);
+  const int frame_count = (data.size() - 2 * sizeof(int32_t)) / frame_size;
+  assert(frame_count > 0);
+  printf("%d frames of %d x %d\n", frame_count, width, height);
+
+  cl_device_id device_id = cl_get_device_id(CL_DEVICE_TYPE_DEFAULT);
+  cl_context context = CL_CHECK_ERR(clCreateContext(NULL, 1, &device_id, NULL, NULL, &err));
+  cl_command_queue q = CL_CHECK_ERR(clCreateCommandQueue(context, device_id, 0, &err));
+  cl_mem yuv_cl = CL_CHECK_ERR(clCreateBuffer(context, CL_MEM_READ_WRITE, frame_size, NULL, &err));
+
+  ModelState model;
+  model_init(&model, device_id, context);
+
+  // the warp doesn't change the cost, sample a centered 1024x512 region
+  const mat3 transform = {{
+    2.0, 0.0, width / 2.f - 512.f,
+    0.0, 2.0, height / 2.f - 256.f,
+    0.0, 0.0, 1.0,
+  }};
+  float vec_desire[DESIRE_LEN] = {};
+
+  std::vector<double> times;
+  for (int pass = 0; pass < passes; pass++) {
+    for (int i = 0; i < frame_count; i++) {
+      CL_CHECK(clEnqueueWriteBuffer(q, yuv_cl, CL_TRUE, 0, frame_size, frames + i * frame_size, 0, NULL, NULL));
+      double t1 = millis_since_boot();
+      model_eval_frame(&model, yuv_cl, width, height, transform, vec_desire);
+      double t2 = millis_since_boot();
+      // the first frames include graph and kernel warm up
+      if (pass > 0 || i >= 5) times.push_back(t2 - t1);
+    }
+  }
+  assert(!times.empty());
+
+  double total = 0;
+  for (double t : times) total += t;
+  std::sort(times.begin(), times.end());
+  printf("%zu frames: %.2f frames/s, %.2f ms/frame (p50 %.2f, p90 %.2f, max %.2f)\n",
+         times.size(), times.size() / (total / 1000.), total / times.size(),
+         times[times.size() / 2], times[times.size() * 9 / 10], times.back());
+
+  model_free(&model);
+  CL_CHECK(clReleaseMemObject(yuv_cl));
+  CL_CHECK(clReleaseCommandQueue(q));
+  CL_CHECK(clReleaseContext(context));
+  return 0;
+}
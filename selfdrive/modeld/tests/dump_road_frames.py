@@ -0,0 +1,26 @@
+#!/usr/bin/env python3
+import argparse
+import struct
+
+from tools.lib.framereader import FrameReader
+
+if __name__ == "__main__":
+  parser = argparse.ArgumentParser(description="Write road camera frames as raw yuv420p for bench_modeld")
+  parser.add_argument("out", help="output file")
+  parser.add_argument("videos", nargs="+", help="fcamera.hevc paths or urls")
+  parser.add_argument("--count", type=int, default=200, help="number of frames to write")
+  args = parser.parse_args()
+
+  written = 0
+  with open(args.out, "wb") as f:
+    for video in args.videos:
+      fr = FrameReader(video)
+      if written == 0:
+        f.write(struct.pack("<ii", fr.w, fr.h))
+      for i in range(min(fr.frame_count, args.count - written)):
+        f.write(fr.get(i, pix_fmt="yuv420p")[0].tobytes())
+        written += 1
+      if written >= args.count:
+        break
+
+  print(f"wrote {written} frames")
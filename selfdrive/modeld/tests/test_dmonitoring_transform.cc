@@ -0,0 +1,145 @@
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "libyuv.h"
+
+#include "selfdrive/common/timing.h"
+#include "selfdrive/modeld/transforms/dmonitoring_transform.h"
+
+// Checks DMonitoringTransform against the crop + I420Mirror + I420Scale + lookup
+// table pipeline it replaced, and reports ns/frame for both.
+
+constexpr int MODEL_WIDTH = 320;
+constexpr int MODEL_HEIGHT = 640;
+constexpr int TENSOR_SIZE = (MODEL_WIDTH/2) * (MODEL_HEIGHT/2) * 6;
+
+struct TestCase {
+  const char *name;
+  int width, height;
+  Rect crop, dst;
+  bool mirror;
+};
+
+// crop rects dmonitoringmodeld uses on tici and eon
+const TestCase test_cases[] = {
+  {"tici", 1928, 1208, {1011, 102, 358, 717}, {0, 0, 320, 640}, false},
+  {"tici rhd", 1928, 1208, {415, 102, 358, 717}, {0, 0, 320, 640}, true},
+  {"eon", 1152, 864, {780, 0, 372, 864}, {0, 96, 272, 448}, false},
+  {"eon rhd", 1152, 864, {0, 0, 372, 864}, {0, 96, 272, 448}, true},
+};
+
+struct Pipeline {
+  std::vector<uint8_t> cropped, mirrored, resized;
+  float tensor[256];
+
+  Pipeline() {
+    for (int x = 0; x < 256; ++x) {
+      tensor[x] = (x - 128.f) * 0.0078125f;
+    }
+    resized.resize(MODEL_WIDTH * MODEL_HEIGHT * 3 / 2);
+    memset(resized.data(), 16, MODEL_WIDTH * MODEL_HEIGHT);
+    memset(resized.data() + MODEL_WIDTH * MODEL_HEIGHT, 128, MODEL_WIDTH * MODEL_HEIGHT / 2);
+  }
+
+  void run(const TestCase &t, const uint8_t *frame, float *out) {
+    const Rect &rect = t.crop;
+    const int cw = (rect.w + 1) / 2, ch = (rect.h + 1) / 2;
+    cropped.resize(rect.w * rect.h + 2 * cw * ch);
+    uint8_t *y = cropped.data(), *u = y + rect.w * rect.h, *v = u + cw * ch;
+    const uint8_t *raw_u = frame + t.width * t.height, *raw_v = raw_u + (t.width / 2) * (t.height / 2);
+    for (int r = 0; r < rect.h; r++) {
+      memcpy(y + r * rect.w, frame + (r + rect.y) * t.width + rect.x, rect.w);
+    }
+    for (int r = 0; r < ch; r++) {
+      memcpy(u + r * cw, raw_u + (r + rect.y / 2) * (t.width / 2) + rect.x / 2, cw);
+      memcpy(v + r * cw, raw_v + (r + rect.y / 2) * (t.width / 2) + rect.x / 2, cw);
+    }
+    if (t.mirror) {
+      mirrored.resize(cropped.size());
+      uint8_t *my = mirrored.data(), *mu = my + rect.w * rect.h, *mv = mu + cw * ch;
+      libyuv::I420Mirror(y, rect.w, u, cw, v, cw, my, rect.w, mu, cw, mv, cw, rect.w, rect.h);
+      y = my, u = mu, v = mv;
+    }
+
+    uint8_t *ry = resized.data(), *ru = ry + MODEL_WIDTH * MODEL_HEIGHT, *rv = ru + MODEL_WIDTH * MODEL_HEIGHT / 4;
+    libyuv::I420Scale(y, rect.w, u, cw, v, cw, rect.w, rect.h,
+                      ry + t.dst.y * MODEL_WIDTH + t.dst.x, MODEL_WIDTH,
+                      ru + t.dst.y / 2 * MODEL_WIDTH / 2 + t.dst.x / 2, MODEL_WIDTH / 2,
+                      rv + t.dst.y / 2 * MODEL_WIDTH / 2 + t.dst.x / 2, MODEL_WIDTH / 2,
+                      t.dst.w, t.dst.h, libyuv::kFilterBilinear);
+
+    const int plane = (MODEL_WIDTH/2) * (MODEL_HEIGHT/2);
+    for (int r = 0; r < MODEL_HEIGHT/2; r++) {
+      for (int c = 0; c < MODEL_WIDTH/2; c++) {
+        const int i = r * MODEL_WIDTH/2 + c;
+        out[i + 0 * plane] = tensor[ry[(2*r) * MODEL_WIDTH + 2*c]];
+        out[i + 1 * plane] = tensor[ry[(2*r+1) * MODEL_WIDTH + 2*c]];
+        out[i + 2 * plane] = tensor[ry[(2*r) * MODEL_WIDTH + 2*c+1]];
+        out[i + 3 * plane] = tensor[ry[(2*r+1) * MODEL_WIDTH + 2*c+1]];
+        out[i + 4 * plane] = tensor[ru[r * MODEL_WIDTH/2 + c]];
+        out[i + 5 * plane] = tensor[rv[r * MODEL_WIDTH/2 + c]];
+      }
+    }
+  }
+};
+
+static int count_mismatches(const float *a, const float *b) {
+  int n = 0;
+  for (int i = 0; i < TENSOR_SIZE; i++) {
+    n += memcmp(&a[i], &b[i], sizeof(float)) != 0;
+  }
+  return n;
+}
+
+template <typename F>
+static double bench(F f) {
+  const int iterations = 200;
+  f();
+  double start = nanos_since_boot();
+  for (int i = 0; i < iterations; i++) f();
+  return (nanos_since_boot() - start) / iterations;
+}
+
+int main() {
+  std::mt19937 rng(1234);
+  std::uniform_int_distribution<int> dist(0, 255);
+  int failed = 0;
+
+  for (const TestCase &t : test_cases) {
+    std::vector<uint8_t> frame(t.width * t.height * 3 / 2);
+    DMonitoringTransform transform;
+    transform.init(t.width, t.height, t.crop, t.mirror, MODEL_WIDTH, MODEL_HEIGHT, t.dst);
+    Pipeline pipeline;
+    std::vector<float> expected(TENSOR_SIZE), fused(TENSOR_SIZE), reference(TENSOR_SIZE);
+
+    // x86 libyuv filters columns with 7 bit fractions in SSSE3, the C rows match
+    // what NEON does on device
+#if !defined(__aarch64__)
+    libyuv::MaskCpuFlags(1);
+#endif
+    int mismatches = 0, reference_mismatches = 0;
+    for (int i = 0; i < 20; i++) {
+      for (auto &p : frame) p = dist(rng);
+      pipeline.run(t, frame.data(), expected.data());
+      // outside dst the tensor is left as is
+      fused = reference = expected;
+      transform.run(frame.data(), fused.data());
+      transform.run_reference(frame.data(), reference.data());
+      mismatches += count_mismatches(expected.data(), fused.data());
+      reference_mismatches += count_mismatches(expected.data(), reference.data());
+    }
+    libyuv::MaskCpuFlags(-1);
+
+    double pipeline_ns = bench([&] { pipeline.run(t, frame.data(), expected.data()); });
+    double fused_ns = bench([&] { transform.run(frame.data(), fused.data()); });
+    double reference_ns = bench([&] { transform.run_reference(frame.data(), reference.data()); });
+    printf("%-10s mismatches: %d fused, %d scalar   libyuv %8.0f ns/frame  fused %8.0f ns/frame  scalar %8.0f ns/frame\n",
+           t.name, mismatches, reference_mismatches, pipeline_ns, fused_ns, reference_ns);
+    failed += mismatches + reference_mismatches;
+  }
+
+  printf("%s\n", failed ? "FAILED" : "OK");
+  return failed != 0;
+}
@@ -0,0 +1,69 @@
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "selfdrive/modeld/models/driving.h"
+
+// Checks that modelV2 and cameraOdometry built into the first segments
+// publish_thread reuses are the same messages the default MessageBuilder builds.
+
+// the canonical form doesn't depend on how the message is split into segments
+static kj::Array<capnp::word> canonical(MessageBuilder &msg) {
+  auto event = msg.getRoot<cereal::Event>();
+  event.setLogMonoTime(0);
+  return capnp::canonicalize(event.asReader());
+}
+
+static bool same(MessageBuilder &reused, MessageBuilder &fresh) {
+  auto a = canonical(reused), b = canonical(fresh);
+  return a.size() == b.size() && memcmp(a.begin(), b.begin(), a.asBytes().size()) == 0;
+}
+
+int main() {
+  std::mt19937 rng(0);
+  std::uniform_real_distribution<float> dist(-3.f, 3.f);
+
+  PubMaster pm({"modelV2", "cameraOdometry"});
+
+  // leave garbage on the heap where the segments are likely to be allocated
+  {
+    std::vector<char> garbage((8192 + 256) * sizeof(capnp::word), 0x5a);
+    asm volatile("" : : "r"(garbage.data()) : "memory");
+  }
+  auto model_buf = MessageBuilder::firstSegment(8192);
+  auto posenet_buf = MessageBuilder::firstSegment(256);
+
+  int failures = 0;
+  std::vector<float> output(NET_OUTPUT_SIZE);
+  for (int i = 0; i < 20; i++) {
+    for (auto &x : output) x = dist(rng);
+    const ModelOutput &model_output = *(const ModelOutput *)output.data();
+    const ModelTimings timings = {dist(rng), dist(rng), dist(rng), dist(rng), dist(rng)};
+    const uint32_t frame_id = rng() % 1000, vipc_dropped_frames = rng() % 2;
+    const bool valid = rng() % 2;
+    kj::ArrayPtr<const float> raw_pred(output.data(), output.size());
+
+    {
+      MessageBuilder reused(model_buf), fresh;
+      model_publish(pm, reused, frame_id, frame_id + 1, 0.1, model_output, 1000, 0.05, timings, raw_pred, valid);
+      model_publish(pm, fresh, frame_id, frame_id + 1, 0.1, model_output, 1000, 0.05, timings, raw_pred, valid);
+      if (!same(reused, fresh)) {
+        printf("modelV2 %d differs\n", i);
+        failures++;
+      }
+    }
+    {
+      MessageBuilder reused(posenet_buf), fresh;
+      posenet_publish(pm, reused, frame_id, vipc_dropped_frames, model_output, 1000, valid);
+      posenet_publish(pm, fresh, frame_id, vipc_dropped_frames, model_output, 1000, valid);
+      if (!same(reused, fresh)) {
+        printf("cameraOdometry %d differs\n", i);
+        failures++;
+      }
+    }
+  }
+
+  printf("%d of 40 messages differ\n", failures);
+  return failures > 0;
+}
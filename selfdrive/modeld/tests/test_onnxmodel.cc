@@ -0,0 +1,49 @@
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "selfdrive/modeld/runners/onnxmodel.h"
+
+// Runs a model through ONNXModel the way modeld does, feeding the recurrent
+// state back from the end of the output, and writes the output of every step.
+// test_onnxmodel.py compares them to onnxruntime's python api.
+//
+// usage: test_onnxmodel <model> <inputs> <outputs> <image size> <desire size>
+//                       <traffic convention size> <state size> <output size>
+// inputs holds the image, desire and traffic convention of every step, a size
+// of 0 leaves that input out.
+
+int main(int argc, char *argv[]) {
+  if (argc != 9) {
+    fprintf(stderr, "usage: %s <model> <inputs> <outputs> <image size> <desire size> "
+                    "<traffic convention size> <state size> <output size>\n", argv[0]);
+    return 1;
+  }
+  const size_t image_size = atoi(argv[4]), desire_size = atoi(argv[5]), traffic_size = atoi(argv[6]);
+  const size_t state_size = atoi(argv[7]), output_size = atoi(argv[8]);
+
+  std::vector<float> output(output_size), image(image_size), desire(desire_size), traffic(traffic_size);
+  ONNXModel model(argv[1], output.data(), output_size, 0);  // the runtime is ignored
+  if (state_size) model.addRecurrent(&output[output_size - state_size], state_size);
+  if (desire_size) model.addDesire(desire.data(), desire_size);
+  if (traffic_size) model.addTrafficConvention(traffic.data(), traffic_size);
+
+  FILE *in = fopen(argv[2], "rb"), *out = fopen(argv[3], "wb");
+  if (!in || !out) {
+    fprintf(stderr, "failed to open %s or %s\n", argv[2], argv[3]);
+    return 1;
+  }
+  int steps = 0;
+  while (fread(image.data(), sizeof(float), image_size, in) == image_size &&
+         fread(desire.data(), sizeof(float), desire_size, in) == desire_size &&
+         fread(traffic.data(), sizeof(float), traffic_size, in) == traffic_size) {
+    model.execute(image.data(), image_size);
+    fwrite(output.data(), sizeof(float), output_size, out);
+    steps++;
+  }
+  fclose(in);
+  fclose(out);
+
+  printf("ran %d steps\n", steps);
+  return 0;
+}
@@ -0,0 +1,102 @@
+#!/usr/bin/env python3
+import os
+import subprocess
+import tempfile
+import unittest
+
+import numpy as np
+import onnx
+import onnxruntime as ort
+from onnx import TensorProto, helper, numpy_helper
+
+RUNNER = os.path.join(os.path.dirname(os.path.abspath(__file__)), "test_onnxmodel")
+STEPS = 10
+
+
+def make_model(path, sizes, state_size, output_size, rng):
+  """A model with the inputs in sizes, in that order, whose output depends on
+  every input. The last state_size outputs are the recurrent state."""
+  inputs = [helper.make_tensor_value_info(name, TensorProto.FLOAT, [1, size]) for name, size in sizes]
+  weights, nodes, outs = [], [], []
+  for out, out_size in (("main", output_size - state_size), ("state", state_size)):
+    if out_size == 0:
+      continue
+    for name, size in sizes:
+      weights.append(numpy_helper.from_array(rng.standard_normal((size, out_size)).astype(np.float32), f"{name}_{out}_w"))
+      nodes.append(helper.make_node("MatMul", [name, f"{name}_{out}_w"], [f"{name}_{out}"]))
+    nodes.append(helper.make_node("Sum", [f"{name}_{out}" for name, _ in sizes], [f"{out}_sum"]))
+    nodes.append(helper.make_node("Tanh", [f"{out}_sum"], [out]))
+    outs.append(out)
+  nodes.append(helper.make_node("Concat", outs, ["outputs"], axis=1))
+
+  output = helper.make_tensor_value_info("outputs", TensorProto.FLOAT, [1, output_size])
+  model = helper.make_model(helper.make_graph(nodes, "test", inputs, [output], weights),
+                            opset_imports=[helper.make_opsetid("", 13)], ir_version=7)
+  onnx.checker.check_model(model)
+  onnx.save(model, path)
+
+
+def reference(path, steps, state_size, output_size):
+  """What onnxruntime's python api outputs, starting from a zero state like modeld"""
+  options = ort.SessionOptions()
+  options.intra_op_num_threads = 1
+  session = ort.InferenceSession(path, options, providers=["CPUExecutionProvider"])
+  output = np.zeros((1, output_size), dtype=np.float32)
+  outputs = []
+  for step in steps:
+    feed = {name: x.reshape(1, -1) for name, x in step.items()}
+    if state_size:
+      feed["initial_state"] = output[:, output_size - state_size:]
+    output = session.run(None, feed)[0]
+    outputs.append(output.ravel())
+  return np.array(outputs)
+
+
+class TestONNXModel(unittest.TestCase):
+  def setUp(self):
+    if not os.path.exists(RUNNER):
+      raise unittest.SkipTest("modeld built without onnxruntime")
+
+  def _check(self, sizes, output_size):
+    rng = np.random.default_rng(0)
+    size = dict(sizes)
+    image_name = next(name for name in size if name not in ("desire", "traffic_convention", "initial_state"))
+    desire_size, traffic_size, state_size = (size.get(name, 0) for name in ("desire", "traffic_convention", "initial_state"))
+
+    steps = []
+    for _ in range(STEPS):
+      step = {image_name: rng.standard_normal(size[image_name]).astype(np.float32)}
+      if desire_size:
+        step["desire"] = rng.integers(0, 2, desire_size).astype(np.float32)
+      if traffic_size:
+        step["traffic_convention"] = np.eye(traffic_size, dtype=np.float32)[rng.integers(traffic_size)]
+      steps.append(step)
+
+    with tempfile.TemporaryDirectory() as tmp:
+      model_path, in_path, out_path = (os.path.join(tmp, f) for f in ("model.onnx", "inputs", "outputs"))
+      make_model(model_path, sizes, state_size, output_size, rng)
+      with open(in_path, "wb") as f:
+        for step in steps:
+          for name in (image_name, "desire", "traffic_convention"):
+            if name in step:
+              f.write(step[name].tobytes())
+
+      args = [size[image_name], desire_size, traffic_size, state_size, output_size]
+      subprocess.check_call([RUNNER, model_path, in_path, out_path] + [str(a) for a in args],
+                            env={**os.environ, "ONNX_THREADS": "1"})
+      out = np.fromfile(out_path, dtype=np.float32).reshape(-1, output_size)
+      expected = reference(model_path, steps, state_size, output_size)
+
+    self.assertEqual(out.shape, expected.shape)
+    np.testing.assert_allclose(out, expected, rtol=1e-5, atol=1e-6)
+
+  def test_driving(self):
+    # declared in another order than SNPEModel adds them, binding by index would mix them up
+    self._check([("initial_state", 32), ("traffic_convention", 2), ("input_imgs", 256), ("desire", 8)], 96)
+
+  def test_dmonitoring(self):
+    self._check([("input_img", 256)], 45)
+
+
+if __name__ == "__main__":
+  unittest.main()
@@ -0,0 +1,315 @@
+#include "selfdrive/modeld/transforms/dmonitoring_transform.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+#if defined(__aarch64__)
+#include <arm_neon.h>
+#elif defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSSE3__)
+#include <tmmintrin.h>
+#endif
+
+// same as the old (x - 128) * 0.0078125 lookup table, exact in float
+static inline float normalize(int v) {
+  return (v - 128.f) * 0.0078125f;
+}
+
+void DMonitoringTransform::init_plane(Plane &p, int stride, const Rect &src, bool mirror, const Rect &dst, bool split) {
+  assert(dst.w <= src.w && dst.h <= src.h);
+  p.stride = stride;
+  p.src_x = src.x;
+  p.src_y = src.y;
+  p.src_w = src.w;
+  p.dst_x = dst.x;
+  p.dst_y = dst.y;
+  p.dst_w = dst.w;
+  p.dst_h = dst.h;
+  p.split = split;
+
+  // ScaleSlope and ScalePlaneBilinearDown in libyuv: 16.16 fixed point steps,
+  // starting half a step in and shifted back half a pixel to center the filter
+  const int dy = (int)(((int64_t)src.h << 16) / dst.h);
+  const int max_y = (src.h - 1) << 16;
+  int fy = std::min((dy >> 1) - 32768, max_y);
+  p.y_index.resize(dst.h);
+  p.y_frac.resize(dst.h);
+  for (int j = 0; j < dst.h; j++) {
+    p.y_index[j] = fy >> 16;
+    p.y_frac[j] = (fy >> 8) & 255;
+    fy = std::min(fy + dy, max_y);
+  }
+
+  const int dx = (int)(((int64_t)src.w << 16) / dst.w);
+  int fx = (dx >> 1) - 32768;
+  p.x_a.resize(dst.w);
+  p.x_b.resize(dst.w);
+  p.x_frac.resize(dst.w);
+  for (int c = 0; c < dst.w; c++) {
+    // the interpolated row is kept in source order, mirroring only flips the indices
+    int a = fx >> 16;
+    int b = std::min(a + 1, src.w - 1);
+    p.x_a[c] = mirror ? src.w - 1 - a : a;
+    p.x_b[c] = mirror ? src.w - 1 - b : b;
+    p.x_frac[c] = fx & 0xffff;
+    fx += dx;
+  }
+
+  p.blocks.clear();
+  if (dst.w % 8 != 0 || (split && dst.x % 2 != 0)) return;
+
+  for (int k = 0; k < dst.w / 8; k++) {
+    int cols[8];
+    for (int i = 0; i < 8; i++) {
+      // luma blocks hold the 4 even columns followed by the 4 odd ones
+      cols[i] = 8 * k + (split ? (i % 4) * 2 + i / 4 : i);
+    }
+    int lo = INT32_MAX, hi = 0;
+    for (int c : cols) {
+      lo = std::min({lo, p.x_a[c], p.x_b[c]});
+      hi = std::max({hi, p.x_a[c], p.x_b[c]});
+    }
+    if (hi - lo >= 16) {
+      p.blocks.clear();
+      return;
+    }
+
+    Block b;
+    b.offset = lo;
+    for (int i = 0; i < 8; i++) {
+      b.shuffle[i] = p.x_a[cols[i]] - lo;
+      b.shuffle[i + 8] = p.x_b[cols[i]] - lo;
+      b.weight[2 * i] = p.x_frac[cols[i]] - 32768;
+      b.weight[2 * i + 1] = 16384;
+    }
+    p.blocks.push_back(b);
+  }
+}
+
+void DMonitoringTransform::init(int frame_width, int frame_height, const Rect &crop, bool mirror,
+                                int model_width, int model_height, const Rect &dst) {
+  assert(crop.x >= 0 && crop.y >= 0 && crop.x + crop.w <= frame_width && crop.y + crop.h <= frame_height);
+  assert(dst.x >= 0 && dst.y >= 0 && dst.x + dst.w <= model_width && dst.y + dst.h <= model_height);
+  this->model_width = model_width;
+  this->model_height = model_height;
+  u_offset = frame_width * frame_height;
+  v_offset = u_offset + (frame_width / 2) * (frame_height / 2);
+
+  init_plane(y, frame_width, crop, mirror, dst, true);
+  init_plane(uv, frame_width / 2,
+             {crop.x / 2, crop.y / 2, (crop.w + 1) / 2, (crop.h + 1) / 2}, mirror,
+             {dst.x / 2, dst.y / 2, (dst.w + 1) / 2, (dst.h + 1) / 2}, false);
+
+  // room for the 16 byte block loads past the end of the row
+  row.assign(y.src_w + 16, 0);
+}
+
+// InterpolateRow in libyuv
+static void interpolate_row_scalar(uint8_t *dst, const uint8_t *src0, const uint8_t *src1, int width, int frac) {
+  const int frac0 = 256 - frac;
+  for (int i = 0; i < width; i++) {
+    dst[i] = (src0[i] * frac0 + src1[i] * frac + 128) >> 8;
+  }
+}
+
+// frac must be > 0, the next row isn't needed otherwise
+static void interpolate_row(uint8_t *dst, const uint8_t *src0, const uint8_t *src1, int width, int frac) {
+  int i = 0;
+#if defined(__aarch64__)
+  const uint8x8_t w0 = vdup_n_u8(256 - frac);
+  const uint8x8_t w1 = vdup_n_u8(frac);
+  for (; i + 16 <= width; i += 16) {
+    uint8x16_t a = vld1q_u8(src0 + i);
+    uint8x16_t b = vld1q_u8(src1 + i);
+    uint16x8_t lo = vmlal_u8(vmull_u8(vget_low_u8(a), w0), vget_low_u8(b), w1);
+    uint16x8_t hi = vmlal_u8(vmull_u8(vget_high_u8(a), w0), vget_high_u8(b), w1);
+    vst1q_u8(dst + i, vcombine_u8(vrshrn_n_u16(lo, 8), vrshrn_n_u16(hi, 8)));
+  }
+#elif defined(__AVX2__)
+  const __m256i zero = _mm256_setzero_si256();
+  const __m256i round = _mm256_set1_epi16(128);
+  const __m256i w0 = _mm256_set1_epi16(256 - frac);
+  const __m256i w1 = _mm256_set1_epi16(frac);
+  for (; i + 32 <= width; i += 32) {
+    __m256i a = _mm256_loadu_si256((const __m256i *)(src0 + i));
+    __m256i b = _mm256_loadu_si256((const __m256i *)(src1 + i));
+    // at most 255 * 256 + 128, fits unsigned 16 bit
+    __m256i lo = _mm256_add_epi16(_mm256_mullo_epi16(_mm256_unpacklo_epi8(a, zero), w0),
+                                  _mm256_mullo_epi16(_mm256_unpacklo_epi8(b, zero), w1));
+    __m256i hi = _mm256_add_epi16(_mm256_mullo_epi16(_mm256_unpackhi_epi8(a, zero), w0),
+                                  _mm256_mullo_epi16(_mm256_unpackhi_epi8(b, zero), w1));
+    lo = _mm256_srli_epi16(_mm256_add_epi16(lo, round), 8);
+    hi = _mm256_srli_epi16(_mm256_add_epi16(hi, round), 8);
+    _mm256_storeu_si256((__m256i *)(dst + i), _mm256_packus_epi16(lo, hi));
+  }
+#elif defined(__SSSE3__)
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i round = _mm_set1_epi16(128);
+  const __m128i w0 = _mm_set1_epi16(256 - frac);
+  const __m128i w1 = _mm_set1_epi16(frac);
+  for (; i + 16 <= width; i += 16) {
+    __m128i a = _mm_loadu_si128((const __m128i *)(src0 + i));
+    __m128i b = _mm_loadu_si128((const __m128i *)(src1 + i));
+    // at most 255 * 256 + 128, fits unsigned 16 bit
+    __m128i lo = _mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(a, zero), w0),
+                               _mm_mullo_epi16(_mm_unpacklo_epi8(b, zero), w1));
+    __m128i hi = _mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(a, zero), w0),
+                               _mm_mullo_epi16(_mm_unpackhi_epi8(b, zero), w1));
+    lo = _mm_srli_epi16(_mm_add_epi16(lo, round), 8);
+    hi = _mm_srli_epi16(_mm_add_epi16(hi, round), 8);
+    _mm_storeu_si128((__m128i *)(dst + i), _mm_packus_epi16(lo, hi));
+  }
+#endif
+  interpolate_row_scalar(dst + i, src0 + i, src1 + i, width - i, frac);
+}
+
+#if defined(__SSSE3__) && !defined(__aarch64__)
+// out0 gets outputs 0-3 and out1 outputs 4-7 of the block
+static inline void filter_block_sse(const uint8_t *row, const int16_t *weight, __m128i shuffle, float *out0, float *out1) {
+  const __m128i zero = _mm_setzero_si128();
+  __m128i g = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)row), shuffle);
+  __m128i a = _mm_unpacklo_epi8(g, zero);
+  __m128i d = _mm_sub_epi16(_mm_unpackhi_epi8(g, zero), a);
+  __m128i d2 = _mm_add_epi16(d, d);
+  // (frac - 32768) * d + 16384 * 2d = frac * d
+  __m128i p_lo = _mm_madd_epi16(_mm_unpacklo_epi16(d, d2), _mm_loadu_si128((const __m128i *)weight));
+  __m128i p_hi = _mm_madd_epi16(_mm_unpackhi_epi16(d, d2), _mm_loadu_si128((const __m128i *)(weight + 8)));
+  // rounds and subtracts the 128 of normalize() at the same time
+  const __m128i round = _mm_set1_epi32(0x8000 - (128 << 16));
+  __m128i v_lo = _mm_add_epi32(_mm_unpacklo_epi16(a, zero), _mm_srai_epi32(_mm_add_epi32(p_lo, round), 16));
+  __m128i v_hi = _mm_add_epi32(_mm_unpackhi_epi16(a, zero), _mm_srai_epi32(_mm_add_epi32(p_hi, round), 16));
+  const __m128 scale = _mm_set1_ps(0.0078125f);
+  _mm_storeu_ps(out0, _mm_mul_ps(_mm_cvtepi32_ps(v_lo), scale));
+  _mm_storeu_ps(out1, _mm_mul_ps(_mm_cvtepi32_ps(v_hi), scale));
+}
+#endif
+
+// ScaleFilterCols in libyuv: a + round((b - a) * frac / 65536)
+template <bool reference>
+void DMonitoringTransform::run_plane(const Plane &p, const uint8_t *src, float *tensor, int tensor_plane) {
+  const int out_stride = model_width / 2;
+  const int plane_size = out_stride * (model_height / 2);
+  const bool use_blocks = !reference && !p.blocks.empty();
+
+  for (int j = 0; j < p.dst_h; j++) {
+    const uint8_t *src0 = src + (p.src_y + p.y_index[j]) * p.stride + p.src_x;
+    if (p.y_frac[j] == 0) {
+      // the next row may be past the end of the plane
+      memcpy(row.data(), src0, p.src_w);
+    } else if (reference) {
+      interpolate_row_scalar(row.data(), src0, src0 + p.stride, p.src_w, p.y_frac[j]);
+    } else {
+      interpolate_row(row.data(), src0, src0 + p.stride, p.src_w, p.y_frac[j]);
+    }
+
+    const int r = p.dst_y + j;
+    float *out0, *out1;
+    if (p.split) {
+      // Y_ul/Y_dl for even columns, Y_ur/Y_dr for odd ones
+      out0 = tensor + (r % 2) * plane_size + (r / 2) * out_stride;
+      out1 = out0 + 2 * plane_size;
+    } else {
+      out0 = out1 = tensor + tensor_plane * plane_size + r * out_stride;
+    }
+
+    if (!use_blocks) {
+      for (int c = 0; c < p.dst_w; c++) {
+        int a = row[p.x_a[c]], b = row[p.x_b[c]];
+        float v = normalize(a + ((p.x_frac[c] * (b - a) + 0x8000) >> 16));
+        int col = p.dst_x + c;
+        if (p.split) {
+          ((col % 2) ? out1 : out0)[col / 2] = v;
+        } else {
+          out0[col] = v;
+        }
+      }
+      continue;
+    }
+
+    const int step = p.split ? 4 : 8;
+    float *base0 = p.split ? out0 + p.dst_x / 2 : out0 + p.dst_x;
+    float *base1 = p.split ? out1 + p.dst_x / 2 : base0 + 4;
+    const int num_blocks = p.blocks.size();
+    int k = 0;
+#if defined(__aarch64__)
+    const float32x4_t scale = vdupq_n_f32(0.0078125f);
+    for (; k < num_blocks; k++) {
+      const Block &blk = p.blocks[k];
+      uint8x16_t g = vqtbl1q_u8(vld1q_u8(&row[blk.offset]), vld1q_u8(blk.shuffle));
+      int16x8_t a = vreinterpretq_s16_u16(vmovl_u8(vget_low_u8(g)));
+      int16x8_t d = vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(vget_high_u8(g))), a);
+      int16x8_t frac = vld2q_s16(blk.weight).val[0];
+      // (frac - 32768) * d + (d << 15) = frac * d
+      int32x4_t p_lo = vmlal_s16(vshll_n_s16(vget_low_s16(d), 15), vget_low_s16(frac), vget_low_s16(d));
+      int32x4_t p_hi = vmlal_s16(vshll_n_s16(vget_high_s16(d), 15), vget_high_s16(frac), vget_high_s16(d));
+      int32x4_t v_lo = vaddq_s32(vmovl_s16(vget_low_s16(a)), vrshrq_n_s32(p_lo, 16));
+      int32x4_t v_hi = vaddq_s32(vmovl_s16(vget_high_s16(a)), vrshrq_n_s32(p_hi, 16));
+      vst1q_f32(base0 + k * step, vmulq_f32(vcvtq_f32_s32(vsubq_s32(v_lo, vdupq_n_s32(128))), scale));
+      vst1q_f32(base1 + k * step, vmulq_f32(vcvtq_f32_s32(vsubq_s32(v_hi, vdupq_n_s32(128))), scale));
+    }
+#elif defined(__SSSE3__)
+#if defined(__AVX2__)
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i round = _mm256_set1_epi32(0x8000 - (128 << 16));
+    const __m256 scale = _mm256_set1_ps(0.0078125f);
+    for (; k + 2 <= num_blocks; k += 2) {
+      const Block &b0 = p.blocks[k], &b1 = p.blocks[k + 1];
+      __m256i src = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128((const __m128i *)&row[b0.offset])),
+                                            _mm_loadu_si128((const __m128i *)&row[b1.offset]), 1);
+      __m256i shuffle = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128((const __m128i *)b0.shuffle)),
+                                                _mm_loadu_si128((const __m128i *)b1.shuffle), 1);
+      __m256i w_lo = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128((const __m128i *)b0.weight)),
+                                             _mm_loadu_si128((const __m128i *)b1.weight), 1);
+      __m256i w_hi = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128((const __m128i *)(b0.weight + 8))),
+                                             _mm_loadu_si128((const __m128i *)(b1.weight + 8)), 1);
+      // each 128 bit lane holds one block
+      __m256i g = _mm256_shuffle_epi8(src, shuffle);
+      __m256i a = _mm256_unpacklo_epi8(g, zero);
+      __m256i d = _mm256_sub_epi16(_mm256_unpackhi_epi8(g, zero), a);
+      __m256i d2 = _mm256_add_epi16(d, d);
+      __m256i p_lo = _mm256_madd_epi16(_mm256_unpacklo_epi16(d, d2), w_lo);
+      __m256i p_hi = _mm256_madd_epi16(_mm256_unpackhi_epi16(d, d2), w_hi);
+      __m256i v_lo = _mm256_add_epi32(_mm256_unpacklo_epi16(a, zero), _mm256_srai_epi32(_mm256_add_epi32(p_lo, round), 16));
+      __m256i v_hi = _mm256_add_epi32(_mm256_unpackhi_epi16(a, zero), _mm256_srai_epi32(_mm256_add_epi32(p_hi, round), 16));
+      __m256 f_lo = _mm256_mul_ps(_mm256_cvtepi32_ps(v_lo), scale);
+      __m256 f_hi = _mm256_mul_ps(_mm256_cvtepi32_ps(v_hi), scale);
+      _mm_storeu_ps(base0 + k * step, _mm256_castps256_ps128(f_lo));
+      _mm_storeu_ps(base1 + k * step, _mm256_castps256_ps128(f_hi));
+      _mm_storeu_ps(base0 + (k + 1) * step, _mm256_extractf128_ps(f_lo, 1));
+      _mm_storeu_ps(base1 + (k + 1) * step, _mm256_extractf128_ps(f_hi, 1));
+    }
+#endif
+    for (; k < num_blocks; k++) {
+      const Block &blk = p.blocks[k];
+      filter_block_sse(&row[blk.offset], blk.weight, _mm_loadu_si128((const __m128i *)blk.shuffle),
+                       base0 + k * step, base1 + k * step);
+    }
+#endif
+    // without SIMD the blocks are gathered one output at a time
+    for (; k < num_blocks; k++) {
+      const Block &blk = p.blocks[k];
+      for (int i = 0; i < 8; i++) {
+        int a = row[blk.offset + blk.shuffle[i]], b = row[blk.offset + blk.shuffle[i + 8]];
+        int frac = blk.weight[2 * i] + 32768;
+        (i < 4 ? base0 : base1)[k * step + i % 4] = normalize(a + ((frac * (b - a) + 0x8000) >> 16));
+      }
+    }
+  }
+}
+
+template <bool reference>
+void DMonitoringTransform::run_frame(const uint8_t *frame, float *tensor) {
+  run_plane<reference>(y, frame, tensor, 0);
+  run_plane<reference>(uv, frame + u_offset, tensor, 4);
+  run_plane<reference>(uv, frame + v_offset, tensor, 5);
+}
+
+void DMonitoringTransform::run(const uint8_t *frame, float *tensor) {
+  run_frame<false>(frame, tensor);
+}
+
+void DMonitoringTransform::run_reference(const uint8_t *frame, float *tensor) {
+  run_frame<true>(frame, tensor);
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+struct Rect {int x, y, w, h;};
+
+// Crops a rect out of an I420 frame, optionally mirrors it horizontally and scales
+// it down into the dst rect of a model_width x model_height frame, writing straight
+// into the y|y|y|y|u|v float tensor of the driver monitoring model. Everything
+// outside dst is left untouched.
+//
+// The scaling reproduces libyuv's I420Scale with kFilterBilinear (C and NEON rows)
+// bit for bit. The ratios libyuv special cases when scaling down (1/2, 3/4, 3/8 and
+// 1/4) are not supported.
+class DMonitoringTransform {
+public:
+  void init(int frame_width, int frame_height, const Rect &crop, bool mirror,
+            int model_width, int model_height, const Rect &dst);
+  void run(const uint8_t *frame, float *tensor);
+  // scalar implementation, kept as the reference for the SIMD paths
+  void run_reference(const uint8_t *frame, float *tensor);
+
+private:
+  // 8 outputs gathered from a 16 byte window of the interpolated row
+  struct Block {
+    int offset;
+    uint8_t shuffle[16];  // a indices, then b indices
+    int16_t weight[16];   // (frac - 32768, 16384) pairs
+  };
+
+  struct Plane {
+    int stride;
+    int src_x, src_y, src_w;
+    int dst_x, dst_y, dst_w, dst_h;
+    bool split;  // luma: even and odd rows and columns go to separate tensor planes
+    std::vector<int> y_index;
+    std::vector<uint8_t> y_frac;
+    std::vector<int> x_a, x_b, x_frac;
+    std::vector<Block> blocks;  // empty if the plane doesn't fit the block layout
+  };
+
+  static void init_plane(Plane &p, int stride, const Rect &src, bool mirror, const Rect &dst, bool split);
+  template <bool reference>
+  void run_plane(const Plane &p, const uint8_t *src, float *tensor, int tensor_plane);
+  template <bool reference>
+  void run_frame(const uint8_t *frame, float *tensor);
+
+  int model_width, model_height;
+  int u_offset, v_offset;
+  Plane y, uv;
+  std::vector<uint8_t> row;
+};
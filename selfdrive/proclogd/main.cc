@@ -1,21 +1,56 @@
 
 #include <sys/resource.h>
 
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+#include "selfdrive/common/swaglog.h"
 #include "selfdrive/common/util.h"
 #include "selfdrive/proclogd/proclog.h"
 
 ExitHandler do_exit;
 
+// every process is sampled this often
+const int FULL_INTERVAL_MS = 2000;
+
 int main(int argc, char **argv) {
   setpriority(PRIO_PROCESS, 0, -15);
 
+  // an open stat fd is kept for every process
+  struct rlimit rlim;
+  if (getrlimit(RLIMIT_NOFILE, &rlim) == 0 && rlim.rlim_cur < rlim.rlim_max) {
+    rlim.rlim_cur = rlim.rlim_max;
+    setrlimit(RLIMIT_NOFILE, &rlim);
+  }
+
+  // openpilot's processes can be sampled faster in between, e.g. PROCLOG_FAST_HZ=10
+  const int fast_hz = util::getenv("PROCLOG_FAST_HZ", 0);
+  const int interval_ms = fast_hz > 0 ? std::max(1, std::min(FULL_INTERVAL_MS, 1000 / fast_hz)) : FULL_INTERVAL_MS;
+  LOGW("proclogd sampling every %d ms, openpilot's processes every %d ms", FULL_INTERVAL_MS, interval_ms);
+
+  ProcCollector collector;
   PubMaster publisher({"procLog"});
+
+  auto next = std::chrono::steady_clock::now();
+  auto next_full = next;
   while (!do_exit) {
+    const bool full = next >= next_full;
+    if (full) next_full += std::chrono::milliseconds(FULL_INTERVAL_MS);
+
+    collector.update(full);
     MessageBuilder msg;
-    buildProcLogMessage(msg);
+    buildProcLogMessage(collector, msg);
     publisher.send("procLog", msg);
 
-    util::sleep_for(2000);  // 2 secs
+    // absolute deadlines so the sampling time doesn't add up into drift
+    next += std::chrono::milliseconds(interval_ms);
+    auto now = std::chrono::steady_clock::now();
+    if (now > next) {
+      next = now;
+      if (next_full < now) next_full = now;
+    }
+    std::this_thread::sleep_until(next);
   }
 
   return 0;
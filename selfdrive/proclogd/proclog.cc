@@ -1,8 +1,16 @@
 #include "selfdrive/proclogd/proclog.h"
 
 #include <dirent.h>
+#include <fcntl.h>
+#include <linux/cn_proc.h>
+#include <linux/connector.h>
+#include <linux/netlink.h>
+#include <sys/socket.h>
+#include <unistd.h>
 
 #include <cassert>
+#include <cerrno>
+#include <cstring>
 #include <fstream>
 #include <iterator>
 #include <sstream>
@@ -63,48 +71,58 @@ enum StatPos {
 };
 
 // parse /proc/pid/stat
-std::optional<ProcStat> procStat(std::string stat) {
+bool procStat(const char *stat, ProcStat &p) {
   // To avoid being fooled by names containing a closing paren, scan backwards.
-  auto open_paren = stat.find('(');
-  auto close_paren = stat.rfind(')');
-  if (open_paren == std::string::npos || close_paren == std::string::npos || open_paren > close_paren) {
-    return std::nullopt;
+  const char *open_paren = strchr(stat, '(');
+  const char *close_paren = strrchr(stat, ')');
+  if (open_paren == nullptr || close_paren == nullptr || open_paren > close_paren) {
+    return false;
   }
 
-  std::string name = stat.substr(open_paren + 1, close_paren - open_paren - 1);
-  // repace space in name with _
-  std::replace(&stat[open_paren], &stat[close_paren], ' ', '_');
-  std::istringstream iss(stat);
-  std::vector<std::string> v{std::istream_iterator<std::string>(iss),
-                             std::istream_iterator<std::string>()};
-  try {
-    if (v.size() != StatPos::MAX_FIELD) {
-      throw std::invalid_argument("stat");
+  char *end;
+  p.pid = strtol(stat, &end, 10);
+  if (end == stat) return false;
+  p.name.assign(open_paren + 1, close_paren);
+
+  long long v[StatPos::MAX_FIELD + 1] = {};
+  int field = StatPos::state;
+  for (const char *s = close_paren + 1; field <= StatPos::MAX_FIELD; field++) {
+    while (*s == ' ') s++;
+    if (*s == '\0' || *s == '\n') break;
+    if (field == StatPos::state) {
+      p.state = *s;
+      s++;
+    } else {
+      v[field] = strtoll(s, &end, 10);
+      if (end == s) return false;
+      s = end;
     }
-    ProcStat p = {
-      .name = name,
-      .pid = stoi(v[StatPos::pid - 1]),
-      .state = v[StatPos::state - 1][0],
-      .ppid = stoi(v[StatPos::ppid - 1]),
-      .utime = stoul(v[StatPos::utime - 1]),
-      .stime = stoul(v[StatPos::stime - 1]),
-      .cutime = stol(v[StatPos::cutime - 1]),
-      .cstime = stol(v[StatPos::cstime - 1]),
-      .priority = stol(v[StatPos::priority - 1]),
-      .nice = stol(v[StatPos::nice - 1]),
-      .num_threads = stol(v[StatPos::num_threads - 1]),
-      .starttime = stoull(v[StatPos::starttime - 1]),
-      .vms = stoul(v[StatPos::vsize - 1]),
-      .rss = stoul(v[StatPos::rss - 1]),
-      .processor = stoi(v[StatPos::processor - 1]),
-    };
-    return p;
-  } catch (const std::invalid_argument &e) {
-    LOGE("failed to parse procStat (%s) :%s", e.what(), stat.c_str());
-  } catch (const std::out_of_range &e) {
-    LOGE("failed to parse procStat (%s) :%s", e.what(), stat.c_str());
-  }
-  return std::nullopt;
+    if (*s != ' ' && *s != '\n' && *s != '\0') return false;
+  }
+  if (field != StatPos::MAX_FIELD + 1) return false;
+
+  p.ppid = v[StatPos::ppid];
+  p.utime = v[StatPos::utime];
+  p.stime = v[StatPos::stime];
+  p.cutime = v[StatPos::cutime];
+  p.cstime = v[StatPos::cstime];
+  p.priority = v[StatPos::priority];
+  p.nice = v[StatPos::nice];
+  p.num_threads = v[StatPos::num_threads];
+  p.starttime = v[StatPos::starttime];
+  p.vms = v[StatPos::vsize];
+  p.rss = v[StatPos::rss];
+  p.processor = v[StatPos::processor];
+  return true;
+}
+
+std::optional<ProcStat> procStat(std::string stat) {
+  ProcStat p = {};
+  if (!procStat(stat.c_str(), p)) {
+    LOGE("failed to parse procStat :%s", stat.c_str());
+    return std::nullopt;
+  }
+  return p;
 }
 
 // return list of PIDs from /proc
@@ -157,6 +175,200 @@ const ProcCache &getProcExtraInfo(int pid, const std::string &name) {
 const double jiffy = sysconf(_SC_CLK_TCK);
 const size_t page_size = sysconf(_SC_PAGE_SIZE);
 
+namespace {
+
+// subscribes to fork, exec and exit events, -1 if not permitted
+int open_proc_connector() {
+  int fd = socket(PF_NETLINK, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, NETLINK_CONNECTOR);
+  if (fd < 0) return -1;
+
+  struct sockaddr_nl addr = {.nl_family = AF_NETLINK, .nl_groups = CN_IDX_PROC};
+  char buf[NLMSG_SPACE(sizeof(struct cn_msg) + sizeof(enum proc_cn_mcast_op))] __attribute__((aligned(NLMSG_ALIGNTO))) = {};
+  struct nlmsghdr *hdr = (struct nlmsghdr *)buf;
+  hdr->nlmsg_len = NLMSG_LENGTH(sizeof(struct cn_msg) + sizeof(enum proc_cn_mcast_op));
+  hdr->nlmsg_type = NLMSG_DONE;
+  struct cn_msg *msg = (struct cn_msg *)NLMSG_DATA(hdr);
+  msg->id = {.idx = CN_IDX_PROC, .val = CN_VAL_PROC};
+  msg->len = sizeof(enum proc_cn_mcast_op);
+  *(enum proc_cn_mcast_op *)msg->data = PROC_CN_MCAST_LISTEN;
+
+  if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 || send(fd, buf, hdr->nlmsg_len, 0) < 0) {
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+// managed processes run from the openpilot directory, python ones as modules
+bool is_openpilot(const ProcCache &cache) {
+  return cache.exe.find("/openpilot/") != std::string::npos ||
+         (!cache.cmdline.empty() && cache.cmdline[0].rfind("selfdrive.", 0) == 0);
+}
+
+}  // namespace
+
+ProcCollector::ProcCollector() {
+  netlink_fd = open_proc_connector();
+  if (netlink_fd < 0) {
+    LOGW("proc connector not available, listing /proc every sample");
+  }
+}
+
+ProcCollector::~ProcCollector() {
+  for (auto &[pid, proc] : procs) {
+    if (proc.stat_fd >= 0) close(proc.stat_fd);
+  }
+  if (netlink_fd >= 0) close(netlink_fd);
+}
+
+static int open_stat(int pid) {
+  return HANDLE_EINTR(open(("/proc/" + std::to_string(pid) + "/stat").c_str(), O_RDONLY | O_CLOEXEC));
+}
+
+void ProcCollector::add(int pid) {
+  auto [it, inserted] = procs.try_emplace(pid);
+  if (inserted) {
+    it->second.stat_fd = open_stat(pid);
+    // out of fds it's opened for every sample instead
+    if (it->second.stat_fd < 0 && errno != EMFILE && errno != ENFILE) {
+      procs.erase(it);
+    }
+  }
+}
+
+void ProcCollector::remove(std::map<int, Proc>::iterator it) {
+  if (it->second.stat_fd >= 0) close(it->second.stat_fd);
+  procs.erase(it);
+}
+
+void ProcCollector::scan() {
+  auto pids = Parser::pids();
+  for (int pid : pids) {
+    add(pid);
+  }
+  // the ones that are gone fail to read in sample()
+}
+
+void ProcCollector::handle_netlink_events() {
+  char buf[4096] __attribute__((aligned(NLMSG_ALIGNTO)));
+  while (true) {
+    ssize_t len = recv(netlink_fd, buf, sizeof(buf), 0);
+    if (len < 0) {
+      // missed events when the buffer overflowed, list /proc to catch up
+      if (errno == ENOBUFS) rescan = true;
+      if (errno == EINTR || errno == ENOBUFS) continue;
+      break;
+    }
+
+    for (struct nlmsghdr *hdr = (struct nlmsghdr *)buf; NLMSG_OK(hdr, len); hdr = NLMSG_NEXT(hdr, len)) {
+      if (hdr->nlmsg_type != NLMSG_DONE) continue;
+      struct cn_msg *msg = (struct cn_msg *)NLMSG_DATA(hdr);
+      struct proc_event *ev = (struct proc_event *)msg->data;
+      switch (ev->what) {
+        case proc_event::PROC_EVENT_FORK:
+          // threads fork too, only new processes have their own tgid
+          if (ev->event_data.fork.child_pid == ev->event_data.fork.child_tgid) {
+            add(ev->event_data.fork.child_tgid);
+          }
+          break;
+        case proc_event::PROC_EVENT_EXEC: {
+          auto it = procs.find(ev->event_data.exec.process_tgid);
+          if (it != procs.end()) it->second.exec = true;
+          break;
+        }
+        case proc_event::PROC_EVENT_EXIT:
+          if (ev->event_data.exit.process_pid == ev->event_data.exit.process_tgid) {
+            auto it = procs.find(ev->event_data.exit.process_tgid);
+            if (it != procs.end()) remove(it);
+          }
+          break;
+        default:
+          break;
+      }
+    }
+  }
+}
+
+bool ProcCollector::sample(int pid, Proc &proc) {
+  char buf[1024];
+  int fd = proc.stat_fd >= 0 ? proc.stat_fd : open_stat(pid);
+  if (fd < 0) return false;
+  ssize_t len = HANDLE_EINTR(pread(fd, buf, sizeof(buf) - 1, 0));
+  if (fd != proc.stat_fd) close(fd);
+  if (len <= 0) return false;  // exited
+  buf[len] = '\0';
+
+  const unsigned long long starttime = proc.stat.starttime;
+  if (!Parser::procStat(buf, proc.stat)) {
+    LOGE("failed to parse procStat :%s", buf);
+    return false;
+  }
+
+  ProcCache &cache = proc.cache;
+  if (proc.exec || cache.pid != pid || cache.name != proc.stat.name || starttime != proc.stat.starttime) {
+    std::string proc_path = "/proc/" + std::to_string(pid);
+    cache.pid = pid;
+    cache.name = proc.stat.name;
+    cache.exe = util::readlink(proc_path + "/exe");
+    std::istringstream stream(util::read_file(proc_path + "/cmdline"));
+    cache.cmdline = Parser::cmdline(stream);
+    proc.openpilot = is_openpilot(cache);
+    proc.exec = false;
+  }
+  return true;
+}
+
+void ProcCollector::update(bool full) {
+  if (netlink_fd >= 0) {
+    handle_netlink_events();
+  }
+  if (full && (netlink_fd < 0 || rescan)) {
+    scan();
+    rescan = false;
+  }
+
+  for (auto it = procs.begin(); it != procs.end();) {
+    Proc &proc = it->second;
+    // new processes are sampled right away, and exec'd ones in case they became openpilot's
+    bool sampled = full || proc.openpilot || proc.exec || proc.cache.pid != it->first;
+    if (sampled && !sample(it->first, proc)) {
+      remove(it++);
+    } else {
+      ++it;
+    }
+  }
+}
+
+void ProcCollector::build(cereal::ProcLog::Builder &builder) const {
+  auto log_procs = builder.initProcs(procs.size());
+  size_t i = 0;
+  for (auto &[pid, proc] : procs) {
+    auto l = log_procs[i++];
+    const ProcStat &r = proc.stat;
+    l.setPid(r.pid);
+    l.setState(r.state);
+    l.setPpid(r.ppid);
+    l.setCpuUser(r.utime / jiffy);
+    l.setCpuSystem(r.stime / jiffy);
+    l.setCpuChildrenUser(r.cutime / jiffy);
+    l.setCpuChildrenSystem(r.cstime / jiffy);
+    l.setPriority(r.priority);
+    l.setNice(r.nice);
+    l.setNumThreads(r.num_threads);
+    l.setStartTime(r.starttime / jiffy);
+    l.setMemVms(r.vms);
+    l.setMemRss((uint64_t)r.rss * page_size);
+    l.setProcessor(r.processor);
+    l.setName(r.name);
+
+    l.setExe(proc.cache.exe);
+    auto lcmdline = l.initCmdline(proc.cache.cmdline.size());
+    for (size_t j = 0; j < lcmdline.size(); j++) {
+      lcmdline.set(j, proc.cache.cmdline[j]);
+    }
+  }
+}
+
 void buildCPUTimes(cereal::ProcLog::Builder &builder) {
   std::ifstream stream("/proc/stat");
   std::vector<CPUTime> stats = Parser::cpuTimes(stream);
@@ -191,49 +403,15 @@ void buildMemInfo(cereal::ProcLog::Builder &builder) {
   mem.setShared(mem_info["Shmem:"]);
 }
 
-void buildProcs(cereal::ProcLog::Builder &builder) {
-  auto pids = Parser::pids();
-  std::vector<ProcStat> proc_stats;
-  proc_stats.reserve(pids.size());
-  for (int pid : pids) {
-    std::string path = "/proc/" + std::to_string(pid) + "/stat";
-    if (auto stat = Parser::procStat(util::read_file(path))) {
-      proc_stats.push_back(*stat);
-    }
-  }
-
-  auto procs = builder.initProcs(proc_stats.size());
-  for (size_t i = 0; i < proc_stats.size(); i++) {
-    auto l = procs[i];
-    const ProcStat &r = proc_stats[i];
-    l.setPid(r.pid);
-    l.setState(r.state);
-    l.setPpid(r.ppid);
-    l.setCpuUser(r.utime / jiffy);
-    l.setCpuSystem(r.stime / jiffy);
-    l.setCpuChildrenUser(r.cutime / jiffy);
-    l.setCpuChildrenSystem(r.cstime / jiffy);
-    l.setPriority(r.priority);
-    l.setNice(r.nice);
-    l.setNumThreads(r.num_threads);
-    l.setStartTime(r.starttime / jiffy);
-    l.setMemVms(r.vms);
-    l.setMemRss((uint64_t)r.rss * page_size);
-    l.setProcessor(r.processor);
-    l.setName(r.name);
-
-    const ProcCache &extra_info = Parser::getProcExtraInfo(r.pid, r.name);
-    l.setExe(extra_info.exe);
-    auto lcmdline = l.initCmdline(extra_info.cmdline.size());
-    for (size_t j = 0; j < lcmdline.size(); j++) {
-      lcmdline.set(j, extra_info.cmdline[j]);
-    }
-  }
-}
-
-void buildProcLogMessage(MessageBuilder &msg) {
+void buildProcLogMessage(ProcCollector &collector, MessageBuilder &msg) {
   auto procLog = msg.initEvent().initProcLog();
-  buildProcs(procLog);
+  collector.build(procLog);
   buildCPUTimes(procLog);
   buildMemInfo(procLog);
 }
+
+void buildProcLogMessage(MessageBuilder &msg) {
+  static ProcCollector collector;
+  collector.update(true);
+  buildProcLogMessage(collector, msg);
+}
@@ -1,3 +1,4 @@
+#include <map>
 #include <optional>
 #include <string>
 #include <unordered_map>
@@ -30,6 +31,8 @@ namespace Parser {
 
 std::vector<int> pids();
 std::optional<ProcStat> procStat(std::string stat);
+// parses a null terminated /proc/pid/stat into p, only allocates for the name
+bool procStat(const char *stat, ProcStat &p);
 std::vector<std::string> cmdline(std::istream &stream);
 std::vector<CPUTime> cpuTimes(std::istream &stream);
 std::unordered_map<std::string, uint64_t> memInfo(std::istream &stream);
@@ -37,4 +40,39 @@ const ProcCache &getProcExtraInfo(int pid, const std::string &name);
 
 };  // namespace Parser
 
+// Keeps an open /proc/pid/stat fd and the cmdline and exe of every process between
+// samples, so a sample is one pread and parse per process. New and exited processes
+// come from the netlink proc connector when it's permitted (CAP_NET_ADMIN), otherwise
+// from listing /proc on every full sample.
+class ProcCollector {
+public:
+  ProcCollector();
+  ~ProcCollector();
+  // samples every process when full, otherwise only openpilot's
+  void update(bool full);
+  void build(cereal::ProcLog::Builder &builder) const;
+  inline size_t size() const { return procs.size(); }
+  inline bool has_netlink() const { return netlink_fd >= 0; }
+
+private:
+  struct Proc {
+    int stat_fd = -1;
+    bool openpilot = false;
+    bool exec = false;  // exec'd since the cmdline and exe were read
+    ProcStat stat = {};
+    ProcCache cache;
+  };
+
+  void scan();
+  void add(int pid);
+  void remove(std::map<int, Proc>::iterator it);
+  bool sample(int pid, Proc &proc);
+  void handle_netlink_events();
+
+  std::map<int, Proc> procs;
+  int netlink_fd = -1;
+  bool rescan = true;
+};
+
 void buildProcLogMessage(MessageBuilder &msg);
+void buildProcLogMessage(ProcCollector &collector, MessageBuilder &msg);
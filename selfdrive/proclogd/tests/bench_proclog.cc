@@ -0,0 +1,64 @@
+#include <signal.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "selfdrive/proclogd/proclog.h"
+
+// Forks idle processes on top of what's running and times the collector's full
+// and openpilot-only samples and building the procLog message from them.
+//
+// usage: bench_proclog [processes] [iterations]
+
+static inline uint64_t nanos() {
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return t.tv_sec * 1000000000ULL + t.tv_nsec;
+}
+
+template <typename F>
+static double time_ms(int iterations, F f) {
+  uint64_t start = nanos();
+  for (int i = 0; i < iterations; i++) f();
+  return (nanos() - start) / 1e6 / iterations;
+}
+
+int main(int argc, char **argv) {
+  const int num_procs = argc > 1 ? atoi(argv[1]) : 500;
+  const int iterations = argc > 2 ? atoi(argv[2]) : 50;
+
+  std::vector<pid_t> children;
+  for (int i = 0; i < num_procs; i++) {
+    pid_t pid = fork();
+    if (pid == 0) {
+      pause();
+      _exit(0);
+    } else if (pid > 0) {
+      children.push_back(pid);
+    }
+  }
+
+  ProcCollector collector;
+  double cold_ms = time_ms(1, [&] { collector.update(true); });
+  double full_ms = time_ms(iterations, [&] { collector.update(true); });
+  double fast_ms = time_ms(iterations, [&] { collector.update(false); });
+  double build_ms = time_ms(iterations, [&] {
+    MessageBuilder msg;
+    buildProcLogMessage(collector, msg);
+    msg.toBytes();
+  });
+
+  printf("%zu processes, proc connector %s\n", collector.size(), collector.has_netlink() ? "on" : "off");
+  printf("first sample:    %8.2f ms\n", cold_ms);
+  printf("full sample:     %8.2f ms\n", full_ms);
+  printf("openpilot only:  %8.2f ms\n", fast_ms);
+  printf("build message:   %8.2f ms\n", build_ms);
+
+  for (pid_t pid : children) kill(pid, SIGKILL);
+  for (pid_t pid : children) waitpid(pid, nullptr, 0);
+  return 0;
+}
@@ -5,7 +5,7 @@
 #include "selfdrive/common/swaglog.h"
 #include "selfdrive/common/timing.h"
 
-BMX055_Accel::BMX055_Accel(I2CBus *bus) : I2CSensor(bus) {}
+BMX055_Accel::BMX055_Accel(I2CBus *bus) : I2CSensor(bus), timestamper(250.0) {}
 
 int BMX055_Accel::init() {
   int ret = 0;
@@ -39,6 +39,12 @@ int BMX055_Accel::init() {
     goto fail;
   }
 
+  // Stream mode keeps the newest frames, writing the config also clears the FIFO
+  ret = set_register(BMX055_ACCEL_I2C_REG_FIFO_CONFIG_1, BMX055_ACCEL_FIFO_MODE_STREAM | BMX055_ACCEL_FIFO_DATA_XYZ);
+  if (ret < 0) {
+    goto fail;
+  }
+
 fail:
   return ret;
 }
@@ -49,6 +55,51 @@ void BMX055_Accel::get_event(cereal::SensorEventData::Builder &event) {
   int len = read_register(BMX055_ACCEL_I2C_REG_X_LSB, buffer, sizeof(buffer));
   assert(len == 6);
 
+  set_event(event, buffer, start_time);
+}
+
+int BMX055_Accel::read_events() {
+  num_frames = 0;
+
+  uint64_t read_time = nanos_since_boot();
+  uint8_t status;
+  int len = read_register(BMX055_ACCEL_I2C_REG_FIFO_STATUS, &status, 1);
+  if (len != 1) {
+    LOGE("Reading FIFO status failed: %d", len);
+    return 0;
+  }
+
+  if (status & BMX055_ACCEL_FIFO_STATUS_OVERRUN) {
+    LOGW("BMX055 accel FIFO overrun");
+    timestamper.reset();
+  }
+
+  int available = status & 0x7F;
+  int count = std::min(available, BMX055_ACCEL_FIFO_MAX_FRAMES);
+  if (count == 0) {
+    return 0;
+  }
+
+  int burst_len = count * BMX055_ACCEL_FIFO_FRAME_SIZE;
+  len = read_burst(BMX055_ACCEL_I2C_REG_FIFO, fifo_buffer, burst_len);
+  if (len != burst_len) {
+    LOGE("Reading FIFO data failed: %d", len);
+    return 0;
+  }
+
+  for (int i = 0; i < count; i++) {
+    timestamps[i] = timestamper.next(i, available, read_time);
+  }
+  num_frames = count;
+  return num_frames;
+}
+
+void BMX055_Accel::get_batched_event(int idx, cereal::SensorEventData::Builder &event) {
+  assert(idx < num_frames);
+  set_event(event, fifo_buffer + idx * BMX055_ACCEL_FIFO_FRAME_SIZE, timestamps[idx]);
+}
+
+void BMX055_Accel::set_event(cereal::SensorEventData::Builder &event, const uint8_t *buffer, uint64_t timestamp) {
   // 12 bit = +-2g
   float scale = 9.81 * 2.0f / (1 << 11);
   float x = -read_12_bit(buffer[0], buffer[1]) * scale;
@@ -59,7 +110,7 @@ void BMX055_Accel::get_event(cereal::SensorEventData::Builder &event) {
   event.setVersion(1);
   event.setSensor(SENSOR_ACCELEROMETER);
   event.setType(SENSOR_TYPE_ACCELEROMETER);
-  event.setTimestamp(start_time);
+  event.setTimestamp(timestamp);
 
   float xyz[] = {x, y, z};
   auto svec = event.initAcceleration();
@@ -9,8 +9,11 @@
 #define BMX055_ACCEL_I2C_REG_ID     0x00
 #define BMX055_ACCEL_I2C_REG_X_LSB  0x02
 #define BMX055_ACCEL_I2C_REG_TEMP   0x08
+#define BMX055_ACCEL_I2C_REG_FIFO_STATUS   0x0E
 #define BMX055_ACCEL_I2C_REG_BW     0x10
 #define BMX055_ACCEL_I2C_REG_HBW    0x13
+#define BMX055_ACCEL_I2C_REG_FIFO_CONFIG_0 0x30
+#define BMX055_ACCEL_I2C_REG_FIFO_CONFIG_1 0x3E
 #define BMX055_ACCEL_I2C_REG_FIFO   0x3F
 
 // Constants
@@ -28,10 +31,26 @@
 #define BMX055_ACCEL_BW_500HZ   0b01110
 #define BMX055_ACCEL_BW_1000HZ  0b01111
 
+#define BMX055_ACCEL_FIFO_MODE_STREAM     (0b10 << 6)
+#define BMX055_ACCEL_FIFO_DATA_XYZ        0b00
+#define BMX055_ACCEL_FIFO_STATUS_OVERRUN  (1 << 7)
+#define BMX055_ACCEL_FIFO_FRAME_SIZE      6
+#define BMX055_ACCEL_FIFO_MAX_FRAMES      32
+
 class BMX055_Accel : public I2CSensor {
   uint8_t get_device_address() {return BMX055_ACCEL_I2C_ADDR;}
+  void set_event(cereal::SensorEventData::Builder &event, const uint8_t *buffer, uint64_t timestamp);
+
+  // 125 Hz bandwidth is sampled at 250 Hz
+  FifoTimestamper timestamper;
+  uint8_t fifo_buffer[BMX055_ACCEL_FIFO_MAX_FRAMES * BMX055_ACCEL_FIFO_FRAME_SIZE];
+  uint64_t timestamps[BMX055_ACCEL_FIFO_MAX_FRAMES];
+  int num_frames = 0;
+
 public:
   BMX055_Accel(I2CBus *bus);
   int init();
   void get_event(cereal::SensorEventData::Builder &event);
+  int read_events();
+  void get_batched_event(int idx, cereal::SensorEventData::Builder &event);
 };
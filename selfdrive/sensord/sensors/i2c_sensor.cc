@@ -26,3 +26,7 @@ int I2CSensor::read_register(uint register_address, uint8_t *buffer, uint8_t len
 int I2CSensor::set_register(uint register_address, uint8_t data) {
   return bus->set_register(get_device_address(), register_address, data);
 }
+
+int I2CSensor::read_burst(uint register_address, uint8_t *buffer, uint16_t len) {
+  return bus->read_burst(get_device_address(), register_address, buffer, len);
+}
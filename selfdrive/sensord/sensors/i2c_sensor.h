@@ -1,5 +1,6 @@
 #pragma once
 
+#include <algorithm>
 #include <cstdint>
 
 #include "cereal/gen/cpp/log.capnp.h"
@@ -12,6 +13,22 @@ int16_t read_16_bit(uint8_t lsb, uint8_t msb);
 int32_t read_20_bit(uint8_t b2, uint8_t b1, uint8_t b0);
 
 
+// Assigns timestamps to FIFO samples from the output data rate instead of the
+// read time. The newest sample in a batch is assumed to be taken at read time.
+class FifoTimestamper {
+  uint64_t period_ns;
+  uint64_t last_ts = 0;
+public:
+  FifoTimestamper(double odr_hz) : period_ns(1e9 / odr_hz) {}
+  void reset() { last_ts = 0; }
+  uint64_t next(int idx, int count, uint64_t read_time) {
+    uint64_t ts = read_time - (count - 1 - idx) * period_ns;
+    // keep timestamps strictly increasing across batches
+    last_ts = std::max(ts, last_ts + 1);
+    return last_ts;
+  }
+};
+
 class I2CSensor : public Sensor {
 private:
   I2CBus *bus;
@@ -21,6 +38,7 @@ public:
   I2CSensor(I2CBus *bus);
   int read_register(uint register_address, uint8_t *buffer, uint8_t len);
   int set_register(uint register_address, uint8_t data);
+  int read_burst(uint register_address, uint8_t *buffer, uint16_t len);
   virtual int init() = 0;
   virtual void get_event(cereal::SensorEventData::Builder &event) = 0;
 };
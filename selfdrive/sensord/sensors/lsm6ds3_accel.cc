@@ -45,6 +45,11 @@ void LSM6DS3_Accel::get_event(cereal::SensorEventData::Builder &event) {
   int len = read_register(LSM6DS3_ACCEL_I2C_REG_OUTX_L_XL, buffer, sizeof(buffer));
   assert(len == sizeof(buffer));
 
+  set_event(event, source, buffer, start_time);
+}
+
+void LSM6DS3_Accel::set_event(cereal::SensorEventData::Builder &event, cereal::SensorEventData::SensorSource source,
+                              const uint8_t *buffer, uint64_t timestamp) {
   float scale = 9.81 * 2.0f / (1 << 15);
   float x = read_16_bit(buffer[0], buffer[1]) * scale;
   float y = read_16_bit(buffer[2], buffer[3]) * scale;
@@ -54,7 +59,7 @@ void LSM6DS3_Accel::get_event(cereal::SensorEventData::Builder &event) {
   event.setVersion(1);
   event.setSensor(SENSOR_ACCELEROMETER);
   event.setType(SENSOR_TYPE_ACCELEROMETER);
-  event.setTimestamp(start_time);
+  event.setTimestamp(timestamp);
 
   float xyz[] = {y, -x, z};
   auto svec = event.initAcceleration();
@@ -14,6 +14,7 @@
 #define LSM6DS3_ACCEL_CHIP_ID        0x69
 #define LSM6DS3TRC_ACCEL_CHIP_ID     0x6A
 #define LSM6DS3_ACCEL_ODR_104HZ      (0b0100 << 4)
+#define LSM6DS3_ACCEL_ODR_416HZ      (0b0110 << 4)
 
 
 class LSM6DS3_Accel : public I2CSensor {
@@ -23,4 +24,8 @@ public:
   LSM6DS3_Accel(I2CBus *bus);
   int init();
   void get_event(cereal::SensorEventData::Builder &event);
+
+  // converts 6 bytes of output register or FIFO data into an event
+  static void set_event(cereal::SensorEventData::Builder &event, cereal::SensorEventData::SensorSource source,
+                        const uint8_t *buffer, uint64_t timestamp);
 };
@@ -0,0 +1,136 @@
+#include "lsm6ds3_fifo.h"
+
+#include <cassert>
+
+#include "selfdrive/common/swaglog.h"
+#include "selfdrive/common/timing.h"
+#include "selfdrive/sensord/sensors/lsm6ds3_accel.h"
+#include "selfdrive/sensord/sensors/lsm6ds3_gyro.h"
+
+LSM6DS3_Fifo::LSM6DS3_Fifo(I2CBus *bus) : I2CSensor(bus), timestamper(LSM6DS3_FIFO_ODR_HZ) {}
+
+int LSM6DS3_Fifo::init() {
+  int ret = 0;
+  uint8_t buffer[1];
+  const int watermark = LSM6DS3_FIFO_WATERMARK_SETS * LSM6DS3_FIFO_PATTERN_WORDS;
+
+  ret = read_register(LSM6DS3_FIFO_I2C_REG_ID, buffer, 1);
+  if(ret < 0) {
+    LOGE("Reading chip ID failed: %d", ret);
+    goto fail;
+  }
+
+  if(buffer[0] != LSM6DS3_FIFO_CHIP_ID && buffer[0] != LSM6DS3TRC_FIFO_CHIP_ID) {
+    LOGE("Chip ID wrong. Got: %d, Expected %d", buffer[0], LSM6DS3_FIFO_CHIP_ID);
+    ret = -1;
+    goto fail;
+  }
+
+  if (buffer[0] == LSM6DS3TRC_FIFO_CHIP_ID) {
+    source = cereal::SensorEventData::SensorSource::LSM6DS3TRC;
+  }
+
+  // Bypass mode clears the FIFO
+  ret = set_register(LSM6DS3_FIFO_I2C_REG_CTRL5, LSM6DS3_FIFO_MODE_BYPASS);
+  if (ret < 0) {
+    goto fail;
+  }
+
+  ret = set_register(LSM6DS3_ACCEL_I2C_REG_CTRL1_XL, LSM6DS3_ACCEL_ODR_416HZ);
+  if (ret < 0) {
+    goto fail;
+  }
+  ret = set_register(LSM6DS3_GYRO_I2C_REG_CTRL2_G, LSM6DS3_GYRO_ODR_416HZ);
+  if (ret < 0) {
+    goto fail;
+  }
+
+  ret = set_register(LSM6DS3_FIFO_I2C_REG_CTRL1, watermark & 0xFF);
+  if (ret < 0) {
+    goto fail;
+  }
+  ret = set_register(LSM6DS3_FIFO_I2C_REG_CTRL2, (watermark >> 8) & 0x0F);
+  if (ret < 0) {
+    goto fail;
+  }
+
+  // Both gyro and accel in the FIFO at the full output data rate
+  ret = set_register(LSM6DS3_FIFO_I2C_REG_CTRL3, (LSM6DS3_FIFO_NO_DECIMATION << 3) | LSM6DS3_FIFO_NO_DECIMATION);
+  if (ret < 0) {
+    goto fail;
+  }
+
+  ret = set_register(LSM6DS3_FIFO_I2C_REG_CTRL5, LSM6DS3_FIFO_ODR_416HZ | LSM6DS3_FIFO_MODE_CONTINUOUS);
+  if (ret < 0) {
+    goto fail;
+  }
+
+fail:
+  return ret;
+}
+
+int LSM6DS3_Fifo::read_events() {
+  num_sets = 0;
+
+  uint64_t read_time = nanos_since_boot();
+  uint8_t status[4];
+  int len = read_register(LSM6DS3_FIFO_I2C_REG_STATUS1, status, sizeof(status));
+  if (len != sizeof(status)) {
+    LOGE("Reading FIFO status failed: %d", len);
+    return 0;
+  }
+
+  if (status[1] & LSM6DS3_FIFO_STATUS2_OVER_RUN) {
+    overruns++;
+    LOGW("LSM6DS3 FIFO overrun");
+    timestamper.reset();
+  }
+  if (status[1] & LSM6DS3_FIFO_STATUS2_EMPTY) {
+    return 0;
+  }
+
+  int words = status[0] | ((status[1] & 0x0F) << 8);
+  int pattern = status[2] | ((status[3] & 0x03) << 8);
+
+  // the first set may be partially read already, skip to the start of a pattern
+  int skip = (LSM6DS3_FIFO_PATTERN_WORDS - pattern) % LSM6DS3_FIFO_PATTERN_WORDS;
+  int available = (words - skip) / LSM6DS3_FIFO_PATTERN_WORDS;
+  int count = std::min(available, LSM6DS3_FIFO_MAX_SETS);
+  if (count <= 0) {
+    return 0;
+  }
+
+  // the data out register wraps around, so the whole batch is a single transaction
+  int burst_len = (skip + count * LSM6DS3_FIFO_PATTERN_WORDS) * 2;
+  len = read_burst(LSM6DS3_FIFO_I2C_REG_DATA_OUT, fifo_buffer, burst_len);
+  if (len != burst_len) {
+    LOGE("Reading FIFO data failed: %d", len);
+    return 0;
+  }
+
+  // sets left in the FIFO are newer than the ones read
+  for (int i = 0; i < count; i++) {
+    timestamps[i] = timestamper.next(i, available, read_time);
+  }
+
+  sets = fifo_buffer + skip * 2;
+  num_sets = count;
+  return num_sets * 2;
+}
+
+void LSM6DS3_Fifo::get_event(cereal::SensorEventData::Builder &event) {
+  assert(num_sets > 0);
+  get_batched_event(num_sets * 2 - 1, event);
+}
+
+void LSM6DS3_Fifo::get_batched_event(int idx, cereal::SensorEventData::Builder &event) {
+  assert(idx < num_sets * 2);
+
+  const uint8_t *set = sets + (idx / 2) * LSM6DS3_FIFO_PATTERN_WORDS * 2;
+  uint64_t timestamp = timestamps[idx / 2];
+  if (idx % 2 == 0) {
+    LSM6DS3_Gyro::set_event(event, source, set, timestamp);
+  } else {
+    LSM6DS3_Accel::set_event(event, source, set + 6, timestamp);
+  }
+}
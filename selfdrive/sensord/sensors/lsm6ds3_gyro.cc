@@ -49,6 +49,11 @@ void LSM6DS3_Gyro::get_event(cereal::SensorEventData::Builder &event) {
   int len = read_register(LSM6DS3_GYRO_I2C_REG_OUTX_L_G, buffer, sizeof(buffer));
   assert(len == sizeof(buffer));
 
+  set_event(event, source, buffer, start_time);
+}
+
+void LSM6DS3_Gyro::set_event(cereal::SensorEventData::Builder &event, cereal::SensorEventData::SensorSource source,
+                             const uint8_t *buffer, uint64_t timestamp) {
   float scale = 8.75 / 1000.0;
   float x = DEG2RAD(read_16_bit(buffer[0], buffer[1]) * scale);
   float y = DEG2RAD(read_16_bit(buffer[2], buffer[3]) * scale);
@@ -58,7 +63,7 @@ void LSM6DS3_Gyro::get_event(cereal::SensorEventData::Builder &event) {
   event.setVersion(2);
   event.setSensor(SENSOR_GYRO_UNCALIBRATED);
   event.setType(SENSOR_TYPE_GYROSCOPE_UNCALIBRATED);
-  event.setTimestamp(start_time);
+  event.setTimestamp(timestamp);
 
   float xyz[] = {y, -x, z};
   auto svec = event.initGyroUncalibrated();
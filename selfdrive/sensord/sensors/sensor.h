@@ -7,4 +7,9 @@ public:
   virtual ~Sensor() {};
   virtual int init() = 0;
   virtual void get_event(cereal::SensorEventData::Builder &event) = 0;
+
+  // Called once per cycle before the events are built. FIFO backed sensors drain
+  // their FIFO here and return the number of buffered events, others produce one.
+  virtual int read_events() { return 1; }
+  virtual void get_batched_event(int idx, cereal::SensorEventData::Builder &event) { get_event(event); }
 };
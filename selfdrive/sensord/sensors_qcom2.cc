@@ -1,5 +1,6 @@
 #include <sys/resource.h>
 
+#include <algorithm>
 #include <chrono>
 #include <thread>
 #include <vector>
@@ -16,6 +17,7 @@
 #include "selfdrive/sensord/sensors/constants.h"
 #include "selfdrive/sensord/sensors/light_sensor.h"
 #include "selfdrive/sensord/sensors/lsm6ds3_accel.h"
+#include "selfdrive/sensord/sensors/lsm6ds3_fifo.h"
 #include "selfdrive/sensord/sensors/lsm6ds3_gyro.h"
 #include "selfdrive/sensord/sensors/lsm6ds3_temp.h"
 #include "selfdrive/sensord/sensors/mmc5603nj_magn.h"
@@ -43,6 +45,7 @@ int sensor_loop() {
   LSM6DS3_Accel lsm6ds3_accel(i2c_bus_imu);
   LSM6DS3_Gyro lsm6ds3_gyro(i2c_bus_imu);
   LSM6DS3_Temp lsm6ds3_temp(i2c_bus_imu);
+  LSM6DS3_Fifo lsm6ds3_fifo(i2c_bus_imu);
 
   MMC5603NJ_Magn mmc5603nj_magn(i2c_bus_imu);
 
@@ -58,6 +61,7 @@ int sensor_loop() {
   sensors_init.push_back({&lsm6ds3_accel, true});
   sensors_init.push_back({&lsm6ds3_gyro, true});
   sensors_init.push_back({&lsm6ds3_temp, true});
+  sensors_init.push_back({&lsm6ds3_fifo, false});
 
   sensors_init.push_back({&mmc5603nj_magn, false});
 
@@ -88,24 +92,43 @@ int sensor_loop() {
     return -1;
   }
 
+  // With the FIFO running, accel and gyro samples come from there at the full data rate
+  if (std::find(sensors.begin(), sensors.end(), &lsm6ds3_fifo) != sensors.end()) {
+    sensors.erase(std::remove_if(sensors.begin(), sensors.end(), [&](Sensor *sensor) {
+      return sensor == &lsm6ds3_accel || sensor == &lsm6ds3_gyro;
+    }), sensors.end());
+  } else {
+    LOGW("LSM6DS3 FIFO unavailable, polling output registers");
+  }
+
   PubMaster pm({"sensorEvents"});
 
+  std::vector<int> event_counts(sensors.size());
+  std::chrono::steady_clock::time_point next_frame = std::chrono::steady_clock::now();
+
   while (!do_exit) {
-    std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+    int num_events = 0;
+    for (int i = 0; i < sensors.size(); i++) {
+      event_counts[i] = sensors[i]->read_events();
+      num_events += event_counts[i];
+    }
 
-    const int num_events = sensors.size();
     MessageBuilder msg;
     auto sensor_events = msg.initEvent().initSensorEvents(num_events);
 
-    for (int i = 0; i < num_events; i++) {
-      auto event = sensor_events[i];
-      sensors[i]->get_event(event);
+    int idx = 0;
+    for (int i = 0; i < sensors.size(); i++) {
+      for (int j = 0; j < event_counts[i]; j++) {
+        auto event = sensor_events[idx++];
+        sensors[i]->get_batched_event(j, event);
+      }
     }
 
     pm.send("sensorEvents", msg);
 
-    std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
-    std::this_thread::sleep_for(std::chrono::milliseconds(10) - (end - begin));
+    // absolute deadlines, so loop jitter doesn't accumulate
+    next_frame += std::chrono::milliseconds(10);
+    std::this_thread::sleep_until(next_frame);
   }
   return 0;
 }
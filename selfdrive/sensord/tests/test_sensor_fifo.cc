@@ -0,0 +1,134 @@
+#include <algorithm>
+#include <deque>
+#include <map>
+#include <vector>
+
+#include "catch2/catch.hpp"
+#include "cereal/messaging/messaging.h"
+#include "selfdrive/common/i2c.h"
+#include "selfdrive/sensord/sensors/bmx055_accel.h"
+#include "selfdrive/sensord/sensors/lsm6ds3_accel.h"
+#include "selfdrive/sensord/sensors/lsm6ds3_fifo.h"
+#include "selfdrive/sensord/sensors/lsm6ds3_gyro.h"
+
+// Replays register dumps: every read pops the next recorded response for that register
+class ReplayI2CBus : public I2CBus {
+public:
+  std::map<std::pair<uint8_t, uint>, std::deque<std::vector<uint8_t>>> reads;
+  std::vector<std::pair<uint, uint8_t>> writes;
+
+  void add_read(uint8_t device_address, uint register_address, std::vector<uint8_t> data) {
+    reads[{device_address, register_address}].push_back(data);
+  }
+
+  int read_register(uint8_t device_address, uint register_address, uint8_t *buffer, uint8_t len) override {
+    return read_burst(device_address, register_address, buffer, len);
+  }
+
+  int read_burst(uint8_t device_address, uint register_address, uint8_t *buffer, uint16_t len) override {
+    auto &q = reads[{device_address, register_address}];
+    if (q.empty() || q.front().size() < len) return -1;
+    std::copy(q.front().begin(), q.front().begin() + len, buffer);
+    q.pop_front();
+    return len;
+  }
+
+  int set_register(uint8_t device_address, uint register_address, uint8_t data) override {
+    writes.push_back({register_address, data});
+    return 0;
+  }
+};
+
+static std::vector<uint8_t> le16(std::vector<int16_t> words) {
+  std::vector<uint8_t> out;
+  for (int16_t w : words) {
+    out.push_back(w & 0xFF);
+    out.push_back((w >> 8) & 0xFF);
+  }
+  return out;
+}
+
+TEST_CASE("LSM6DS3 FIFO burst read") {
+  ReplayI2CBus bus;
+  bus.add_read(LSM6DS3_FIFO_I2C_ADDR, LSM6DS3_FIFO_I2C_REG_ID, {LSM6DS3_FIFO_CHIP_ID});
+
+  LSM6DS3_Fifo fifo(&bus);
+  REQUIRE(fifo.init() >= 0);
+  REQUIRE(bus.writes.back() == std::pair<uint, uint8_t>(LSM6DS3_FIFO_I2C_REG_CTRL5, LSM6DS3_FIFO_ODR_416HZ | LSM6DS3_FIFO_MODE_CONTINUOUS));
+
+  // accel and gyro run faster than the sensord loop, so every cycle drains several sets
+  auto written = [&](uint reg, uint8_t value) {
+    return std::find(bus.writes.begin(), bus.writes.end(), std::pair<uint, uint8_t>(reg, value)) != bus.writes.end();
+  };
+  REQUIRE(written(LSM6DS3_ACCEL_I2C_REG_CTRL1_XL, LSM6DS3_ACCEL_ODR_416HZ));
+  REQUIRE(written(LSM6DS3_GYRO_I2C_REG_CTRL2_G, LSM6DS3_GYRO_ODR_416HZ));
+
+  SECTION("empty FIFO") {
+    bus.add_read(LSM6DS3_FIFO_I2C_ADDR, LSM6DS3_FIFO_I2C_REG_STATUS1, {0, LSM6DS3_FIFO_STATUS2_EMPTY, 0, 0});
+    REQUIRE(fifo.read_events() == 0);
+  }
+
+  SECTION("unaligned FIFO") {
+    // 3 words of a set that was partially read, then 2 full sets and a partial one
+    bus.add_read(LSM6DS3_FIFO_I2C_ADDR, LSM6DS3_FIFO_I2C_REG_STATUS1, {17, 0, 3, 0});
+    bus.add_read(LSM6DS3_FIFO_I2C_ADDR, LSM6DS3_FIFO_I2C_REG_DATA_OUT, le16({
+      100, 200, 300,
+      1, 2, 3, 1000, 2000, 3000,
+      4, 5, 6, 4000, 5000, 6000,
+    }));
+
+    REQUIRE(fifo.read_events() == 4);
+
+    MessageBuilder msg;
+    auto events = msg.initEvent().initSensorEvents(4);
+    for (int i = 0; i < 4; i++) {
+      auto event = events[i];
+      fifo.get_batched_event(i, event);
+    }
+
+    REQUIRE(events[0].getSensor() == SENSOR_GYRO_UNCALIBRATED);
+    REQUIRE(events[1].getSensor() == SENSOR_ACCELEROMETER);
+    REQUIRE(events[2].getSensor() == SENSOR_GYRO_UNCALIBRATED);
+    REQUIRE(events[3].getSensor() == SENSOR_ACCELEROMETER);
+
+    // axes are rotated into the device frame: {y, -x, z}
+    float scale = 9.81 * 2.0f / (1 << 15);
+    auto accel = events[3].getAcceleration().getV();
+    REQUIRE(accel[0] == Approx(5000 * scale));
+    REQUIRE(accel[1] == Approx(-4000 * scale));
+    REQUIRE(accel[2] == Approx(6000 * scale));
+
+    // samples within a set share a timestamp, sets are one ODR period apart
+    REQUIRE(events[0].getTimestamp() == events[1].getTimestamp());
+    uint64_t dt = events[2].getTimestamp() - events[0].getTimestamp();
+    REQUIRE(dt == Approx(1e9 / 416.0).margin(1));
+  }
+}
+
+TEST_CASE("BMX055 accel FIFO burst read") {
+  ReplayI2CBus bus;
+  bus.add_read(BMX055_ACCEL_I2C_ADDR, BMX055_ACCEL_I2C_REG_ID, {BMX055_ACCEL_CHIP_ID});
+
+  BMX055_Accel accel(&bus);
+  REQUIRE(accel.init() >= 0);
+
+  bus.add_read(BMX055_ACCEL_I2C_ADDR, BMX055_ACCEL_I2C_REG_FIFO_STATUS, {3});
+  bus.add_read(BMX055_ACCEL_I2C_ADDR, BMX055_ACCEL_I2C_REG_FIFO, le16({16, 32, 48, 16, 32, 48, 160, 320, 480}));
+  REQUIRE(accel.read_events() == 3);
+
+  MessageBuilder msg;
+  auto events = msg.initEvent().initSensorEvents(3);
+  for (int i = 0; i < 3; i++) {
+    auto event = events[i];
+    accel.get_batched_event(i, event);
+  }
+
+  float scale = 9.81 * 2.0f / (1 << 11);
+  auto v = events[2].getAcceleration().getV();
+  REQUIRE(v[0] == Approx(-10 * scale));
+  REQUIRE(v[1] == Approx(-20 * scale));
+  REQUIRE(v[2] == Approx(30 * scale));
+
+  REQUIRE(events[1].getTimestamp() - events[0].getTimestamp() == Approx(4e6).margin(1));
+  REQUIRE(events[2].getTimestamp() - events[1].getTimestamp() == Approx(4e6).margin(1));
+}
@@ -0,0 +1,184 @@
+#include "selfdrive/test/process_replay/inprocess_replay.h"
+
+#include <getopt.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+#include <capnp/schema.h>
+
+#include "cereal/services.h"
+#include "selfdrive/common/timing.h"
+#include "selfdrive/ui/replay/filereader.h"
+#include "selfdrive/ui/replay/util.h"
+
+// ReplayContext
+
+const ReplayContext::Input &ReplayContext::input(const char *service) const {
+  return inputs.at(service);
+}
+
+bool ReplayContext::alive(const char *service) const {
+  const Input &in = input(service);
+  return in.seen && (in.freq <= 1e-5 || (int64_t)(time_ - in.rcv_time) * 1e-9 < 10.0 / in.freq);
+}
+
+bool ReplayContext::valid(const char *service) const {
+  return input(service).valid;
+}
+
+bool ReplayContext::allAliveAndValid(const std::vector<const char *> &ignore_alive) const {
+  for (auto &[name, in] : inputs) {
+    bool ignored = std::find_if(ignore_alive.begin(), ignore_alive.end(), [&](const char *s) { return name == s; }) != ignore_alive.end();
+    if (!in.valid || (!ignored && !alive(name.c_str()))) return false;
+  }
+  return true;
+}
+
+void ReplayContext::send(const char *service, kj::ArrayPtr<const capnp::word> words) {
+  capnp::ReaderOptions options;
+  options.traversalLimitInWords = kj::maxValue;
+  capnp::FlatArrayMessageReader reader(words, options);
+  capnp::MallocMessageBuilder builder;
+  builder.setRoot(reader.getRoot<cereal::Event>());
+  builder.getRoot<cereal::Event>().setLogMonoTime(time_);
+
+  auto flat = capnp::messageToFlatArray(builder);
+  auto bytes = flat.asBytes();
+  output.append((const char *)bytes.begin(), bytes.size());
+  output_count++;
+  output_counts[service]++;
+}
+
+// InProcessReplay
+
+InProcessReplay::InProcessReplay(std::unique_ptr<ReplayProcess> p) : process(std::move(p)) {
+  input_names = process->inputs();
+  auto schema = capnp::Schema::from<cereal::Event>();
+  for (int i = 0; i < input_names.size(); i++) {
+    input_index[schema.getFieldByName(input_names[i]).getProto().getDiscriminantValue()] = i;
+  }
+}
+
+bool InProcessReplay::load(const std::string &path) {
+  double t1 = millis_since_boot();
+  std::string data = FileReader(false).read(path);
+  if (data.compare(0, 3, "BZh") == 0) {
+    data = decompressBZ2(data);
+  }
+  if (data.empty()) {
+    fprintf(stderr, "failed to read %s\n", path.c_str());
+    return false;
+  }
+
+  // the events point into the log, which stays loaded until the replay is done
+  const std::string &log = logs.emplace_back(std::move(data));
+  kj::ArrayPtr<const capnp::word> words((const capnp::word *)log.data(), log.size() / sizeof(capnp::word));
+  bool ok = true;
+  try {
+    while (words.size() > 0) {
+      capnp::ReaderOptions options;
+      options.traversalLimitInWords = kj::maxValue;
+      capnp::FlatArrayMessageReader reader(words, options);
+      auto event_words = kj::arrayPtr(words.begin(), reader.getEnd());
+      words = kj::arrayPtr(reader.getEnd(), words.end());
+      result.events++;
+
+      cereal::Event::Reader event = reader.getRoot<cereal::Event>();
+      auto it = input_index.find(event.which());
+      if (it != input_index.end()) {
+        events.push_back({event.getLogMonoTime(), it->second, event_words});
+      }
+    }
+  } catch (const kj::Exception &e) {
+    fprintf(stderr, "failed to parse %s: %s\n", path.c_str(), e.getDescription().cStr());
+    ok = false;
+  }
+  result.load_seconds += (millis_since_boot() - t1) / 1000.;
+  return ok;
+}
+
+ReplayResult InProcessReplay::run(FILE *out) {
+  // stable, so events logged at the same time keep their log order
+  std::stable_sort(events.begin(), events.end(), [](const Event &a, const Event &b) { return a.mono_time < b.mono_time; });
+
+  ReplayContext ctx;
+  for (auto name : input_names) {
+    auto &in = ctx.inputs[name];
+    for (const auto &s : services) {
+      if (strcmp(s.name, name) == 0) in.freq = s.frequency;
+    }
+  }
+
+  double t1 = millis_since_boot();
+  for (const Event &ev : events) {
+    capnp::ReaderOptions options;
+    options.traversalLimitInWords = kj::maxValue;
+    capnp::FlatArrayMessageReader reader(ev.words, options);
+    cereal::Event::Reader event = reader.getRoot<cereal::Event>();
+
+    const char *name = input_names[ev.input];
+    ReplayContext::Input &in = ctx.inputs.at(name);
+    ctx.time_ = ev.mono_time;
+    in.rcv_time = ev.mono_time;
+    in.seen = true;
+    in.valid = event.getValid();
+
+    process->handle(name, event, ctx);
+    result.handled++;
+  }
+  result.run_seconds = (millis_since_boot() - t1) / 1000.;
+
+  result.outputs = ctx.output_count;
+  result.output_counts = ctx.output_counts;
+  result.hash = sha256(ctx.output);
+  if (out) {
+    fwrite(ctx.output.data(), 1, ctx.output.size(), out);
+  }
+  return result;
+}
+
+int inprocess_replay_main(int argc, char **argv,
+                          const std::map<std::string, std::function<std::unique_ptr<ReplayProcess>()>> &processes) {
+  auto usage = [&]() {
+    fprintf(stderr, "usage: %s <process> [-o output] <rlog>...\nprocesses:", argv[0]);
+    for (auto &[name, _] : processes) fprintf(stderr, " %s", name.c_str());
+    fprintf(stderr, "\n");
+    return 1;
+  };
+
+  const char *output = nullptr;
+  int opt;
+  while ((opt = getopt(argc, argv, "o:")) != -1) {
+    switch (opt) {
+      case 'o': output = optarg; break;
+      default: return usage();
+    }
+  }
+  if (argc - optind < 2 || processes.count(argv[optind]) == 0) {
+    return usage();
+  }
+
+  const std::string proc_name = argv[optind];
+  InProcessReplay replay(processes.at(proc_name)());
+  for (int i = optind + 1; i < argc; i++) {
+    if (!replay.load(argv[i])) return 1;
+  }
+
+  FILE *out = nullptr;
+  if (output && !(out = fopen(output, "wb"))) {
+    fprintf(stderr, "failed to open %s\n", output);
+    return 1;
+  }
+  ReplayResult r = replay.run(out);
+  if (out) fclose(out);
+
+  printf("%s: %lu events, %lu handled in %.3fs (%.0f/s), %.2fs loading\n", proc_name.c_str(), r.events, r.handled,
+         r.run_seconds, r.handled / std::max(r.run_seconds, 1e-9), r.load_seconds);
+  for (auto &[service, count] : r.output_counts) {
+    printf("  %-24s %8lu\n", service.c_str(), count);
+  }
+  printf("%s\n", r.hash.c_str());
+  return 0;
+}
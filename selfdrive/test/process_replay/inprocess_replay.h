@@ -0,0 +1,98 @@
+#pragma once
+
+#include <cstdio>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "cereal/messaging/messaging.h"
+
+// Replays rlogs through a C++ daemon's message handling linked into the same
+// process, instead of running the daemon and handing it every message over msgq
+// like process_replay does. Events go in logMonoTime order on a virtual clock,
+// the outputs are captured as they're built and hashed, so a run is a pure
+// function of its input logs.
+
+class ReplayContext {
+public:
+  // the logMonoTime of the event being handled
+  inline uint64_t time() const { return time_; }
+
+  // SubMaster's alive and valid of the inputs, on the virtual clock
+  bool alive(const char *service) const;
+  bool valid(const char *service) const;
+  bool allAliveAndValid(const std::vector<const char *> &ignore_alive = {}) const;
+
+  // captures an output, its logMonoTime is set to the virtual time like process_replay does
+  void send(const char *service, kj::ArrayPtr<const capnp::word> words);
+  inline void send(const char *service, kj::ArrayPtr<const capnp::byte> bytes) {
+    send(service, kj::ArrayPtr<const capnp::word>((const capnp::word *)bytes.begin(), bytes.size() / sizeof(capnp::word)));
+  }
+
+private:
+  struct Input {
+    double freq = 0;
+    uint64_t rcv_time = 0;
+    bool seen = false, valid = true;
+  };
+
+  const Input &input(const char *service) const;
+
+  uint64_t time_ = 0;
+  std::map<std::string, Input> inputs;
+  std::string output;
+  uint64_t output_count = 0;
+  std::map<std::string, uint64_t> output_counts;
+
+  friend class InProcessReplay;
+};
+
+// A daemon's message handling, the part of its main loop after the SubMaster
+class ReplayProcess {
+public:
+  virtual ~ReplayProcess() {}
+  virtual std::vector<const char *> inputs() const = 0;
+  // called for every valid and invalid input event, in logMonoTime order
+  virtual void handle(const char *service, const cereal::Event::Reader &event, ReplayContext &ctx) = 0;
+};
+
+struct ReplayResult {
+  uint64_t events = 0;   // all events in the logs
+  uint64_t handled = 0;  // events passed to the process
+  uint64_t outputs = 0;
+  std::map<std::string, uint64_t> output_counts;
+  std::string hash;      // sha256 of the serialized outputs
+  double load_seconds = 0, run_seconds = 0;
+};
+
+class InProcessReplay {
+public:
+  InProcessReplay(std::unique_ptr<ReplayProcess> process);
+  // reads an rlog, bz2 compressed or not
+  bool load(const std::string &path);
+  // replays everything loaded and writes the outputs to out if given
+  ReplayResult run(FILE *out = nullptr);
+
+private:
+  struct Event {
+    uint64_t mono_time;
+    int input;
+    kj::ArrayPtr<const capnp::word> words;
+  };
+
+  std::unique_ptr<ReplayProcess> process;
+  std::vector<const char *> input_names;
+  std::map<uint16_t, int> input_index;  // Event union discriminant -> input
+  std::deque<std::string> logs;
+  std::vector<Event> events;
+  ReplayResult result;
+};
+
+// the main of a replay binary over the given processes:
+//   <binary> <process> [-o output] <rlog>...
+// prints the output hash and the replay speed
+int inprocess_replay_main(int argc, char **argv,
+                          const std::map<std::string, std::function<std::unique_ptr<ReplayProcess>()>> &processes);
@@ -5,6 +5,8 @@ import sys
 import threading
 import time
 import signal
+import subprocess
+import tempfile
 from collections import namedtuple
 
 import capnp
@@ -13,18 +15,28 @@ from tqdm import tqdm
 import cereal.messaging as messaging
 from cereal import car, log
 from cereal.services import service_list
+from common.basedir import BASEDIR
 from common.params import Params
 from common.timeout import Timeout
 from selfdrive.car.fingerprints import FW_VERSIONS
 from selfdrive.car.car_helpers import get_car, interfaces
 from selfdrive.manager.process import PythonProcess
 from selfdrive.manager.process_config import managed_processes
+from tools.lib.logreader import LogReader
 
 # Numpy gives different results based on CPU features after version 19
 NUMPY_TOLERANCE = 1e-7
 CI = "CI" in os.environ
 TIMEOUT = 15
 
+# C++ processes with their message handling linked into a replay binary, replayed
+# in-process on a virtual clock instead of over msgq when INPROCESS_REPLAY is set
+INPROCESS_REPLAY = "INPROCESS_REPLAY" in os.environ
+INPROCESS_BINARIES = {
+  "locationd": os.path.join(BASEDIR, "selfdrive/locationd/inprocess_replay"),
+  "ubloxd": os.path.join(BASEDIR, "selfdrive/locationd/inprocess_replay"),
+}
+
 ProcessConfig = namedtuple('ProcessConfig', ['proc_name', 'pub_sub', 'ignore', 'init_callback', 'should_recv_callback', 'tolerance', 'fake_pubsubmaster'])
 
 
@@ -338,6 +350,8 @@ CONFIGS = [
 def replay_process(cfg, lr, fingerprint=None):
   if cfg.fake_pubsubmaster:
     return python_replay_process(cfg, lr, fingerprint)
+  elif INPROCESS_REPLAY and cfg.proc_name in INPROCESS_BINARIES:
+    return inprocess_replay_process(cfg, lr)
   else:
     return cpp_replay_process(cfg, lr, fingerprint)
 
@@ -487,3 +501,16 @@ def cpp_replay_process(cfg, lr, fingerprint=None):
     managed_processes[cfg.proc_name].stop()
 
   return log_msgs
+
+
+def inprocess_replay_process(cfg, lr):
+  pub_msgs = [msg for msg in lr if msg.which() in cfg.pub_sub]
+
+  with tempfile.TemporaryDirectory() as tmp:
+    rlog, output = os.path.join(tmp, "rlog"), os.path.join(tmp, "output")
+    with open(rlog, "wb") as f:
+      f.write(b"".join(msg.as_builder().to_bytes() for msg in pub_msgs))
+
+    # outputs come back with the logMonoTime of the message that triggered them, like cpp_replay_process
+    subprocess.check_call([INPROCESS_BINARIES[cfg.proc_name], cfg.proc_name, "-o", output, rlog])
+    return list(LogReader(output))
@@ -1,5 +1,7 @@
 #include "selfdrive/ui/navd/map_renderer.h"
 
+#include <algorithm>
+
 #include <QApplication>
 #include <QBuffer>
 #include <QDebug>
@@ -13,6 +15,15 @@ const int HEIGHT = WIDTH;
 
 const int NUM_VIPC_BUFFERS = 4;
 
+// published frames between thumbnails and between the timing logs
+const int THUMBNAIL_INTERVAL = 100;
+const int LOG_INTERVAL = 100;
+
+#ifndef GL_IMPLEMENTATION_COLOR_READ_TYPE
+#define GL_IMPLEMENTATION_COLOR_READ_TYPE 0x8B9A
+#define GL_IMPLEMENTATION_COLOR_READ_FORMAT 0x8B9B
+#endif
+
 MapRenderer::MapRenderer(const QMapboxGLSettings &settings, bool enable_vipc) : m_settings(settings) {
   QSurfaceFormat fmt;
   fmt.setRenderableType(QSurfaceFormat::OpenGLES);
@@ -51,6 +62,28 @@ MapRenderer::MapRenderer(const QMapboxGLSettings &settings, bool enable_vipc) :
     vipc_server->start_listener();
 
     pm.reset(new PubMaster({"navThumbnail"}));
+    thumbnail_thread = std::thread(&MapRenderer::thumbnailThread, this);
+
+    // pixel pack buffers need GLES 3
+    use_pbo = ctx->format().majorVersion() >= 3;
+    if (use_pbo) {
+      fbo->bind();
+      GLint read_format = 0, read_type = 0;
+      gl_functions->glGetIntegerv(GL_IMPLEMENTATION_COLOR_READ_FORMAT, &read_format);
+      gl_functions->glGetIntegerv(GL_IMPLEMENTATION_COLOR_READ_TYPE, &read_type);
+      fbo->release();
+      read_rgb = read_format == GL_RGB && read_type == GL_UNSIGNED_BYTE;
+
+      for (auto &b : pbo) {
+        b = std::make_unique<QOpenGLBuffer>(QOpenGLBuffer::PixelPackBuffer);
+        b->setUsagePattern(QOpenGLBuffer::StreamRead);
+        b->create();
+        b->bind();
+        b->allocate(WIDTH * HEIGHT * (read_rgb ? 3 : 4));
+        b->release();
+      }
+    }
+    qWarning() << "navd map readback through" << (use_pbo ? (read_rgb ? "pbo as RGB" : "pbo as RGBA") : "QImage");
   }
 }
 
@@ -69,50 +102,124 @@ bool MapRenderer::loaded() {
 }
 
 void MapRenderer::update() {
+  double t1 = millis_since_boot();
   gl_functions->glClear(GL_COLOR_BUFFER_BIT);
   m_map->render();
   gl_functions->glFlush();
 
-  sendVipc();
+  sendVipc(millis_since_boot() - t1);
 }
 
-void MapRenderer::sendVipc() {
+void MapRenderer::readPixels() {
+  fbo->bind();
+  pbo[pbo_idx]->bind();
+  // returns right away, the gpu fills the buffer once it's done rendering
+  gl_functions->glReadPixels(0, 0, WIDTH, HEIGHT, read_rgb ? GL_RGB : GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+  pbo[pbo_idx]->release();
+  fbo->release();
+}
+
+bool MapRenderer::copyPixels(VisionBuf *buf) {
+  const int bpp = read_rgb ? 3 : 4;
+  pbo[pbo_idx]->bind();
+  auto src = (const uint8_t *)pbo[pbo_idx]->mapRange(0, WIDTH * HEIGHT * bpp, QOpenGLBuffer::RangeRead);
+  if (src) {
+    // gl rows are bottom up
+    for (int y = 0; y < HEIGHT; y++) {
+      const uint8_t *row = src + (HEIGHT - 1 - y) * WIDTH * bpp;
+      uint8_t *out = (uint8_t *)buf->addr + y * WIDTH * 3;
+      if (read_rgb) {
+        memcpy(out, row, WIDTH * 3);
+      } else {
+        for (int x = 0; x < WIDTH; x++) {
+          out[3 * x + 0] = row[4 * x + 0];
+          out[3 * x + 1] = row[4 * x + 1];
+          out[3 * x + 2] = row[4 * x + 2];
+        }
+      }
+    }
+    pbo[pbo_idx]->unmap();
+  }
+  pbo[pbo_idx]->release();
+  return src != nullptr;
+}
+
+void MapRenderer::sendVipc(double render_ms) {
   if (!vipc_server || !loaded()) {
     return;
   }
 
-  QImage cap = fbo->toImage().convertToFormat(QImage::Format_RGB888, Qt::AutoColor);
+  double t1 = millis_since_boot();
   uint64_t ts = nanos_since_boot();
   VisionBuf* buf = vipc_server->get_buffer(VisionStreamType::VISION_STREAM_RGB_MAP);
+  assert(buf->len == WIDTH * HEIGHT * 3);
+
+  bool ready = true;
+  if (use_pbo) {
+    // start reading this frame, then send the previous one
+    readPixels();
+    pbo_idx = 1 - pbo_idx;
+    ready = pbo_pending && copyPixels(buf);
+    std::swap(ts, pbo_ts);
+    pbo_pending = true;
+  } else {
+    QImage cap = fbo->toImage().convertToFormat(QImage::Format_RGB888, Qt::AutoColor);
+    memcpy(buf->addr, cap.bits(), buf->len);
+  }
+  if (!ready) {
+    return;
+  }
+  double t2 = millis_since_boot();
+
   VisionIpcBufExtra extra = {
     .frame_id = frame_id,
     .timestamp_sof = ts,
     .timestamp_eof = ts,
   };
-
-  assert(cap.sizeInBytes() == buf->len);
-  memcpy(buf->addr, cap.bits(), buf->len);
   vipc_server->send(buf, &extra);
 
-  if (frame_id % 100 == 0) {
+  if (frame_id % THUMBNAIL_INTERVAL == 0) {
+    QImage image((const uchar *)buf->addr, WIDTH, HEIGHT, WIDTH * 3, QImage::Format_RGB888);
+    thumbnails.push({image.copy(), frame_id, ts});
+  }
+  frame_id++;
+  double t3 = millis_since_boot();
+
+  stats.render_ms += render_ms;
+  stats.readback_ms += t2 - t1;
+  stats.publish_ms += t3 - t2;
+  stats.render_max_ms = std::max(stats.render_max_ms, render_ms);
+  stats.readback_max_ms = std::max(stats.readback_max_ms, t2 - t1);
+  stats.publish_max_ms = std::max(stats.publish_max_ms, t3 - t2);
+  if (++stats.frames == LOG_INTERVAL) {
+    qInfo("map frame times: render %.2f ms (max %.2f), readback %.2f ms (max %.2f), publish %.2f ms (max %.2f)",
+          stats.render_ms / stats.frames, stats.render_max_ms, stats.readback_ms / stats.frames, stats.readback_max_ms,
+          stats.publish_ms / stats.frames, stats.publish_max_ms);
+    stats = {};
+  }
+}
+
+void MapRenderer::thumbnailThread() {
+  while (true) {
+    Thumbnail t = thumbnails.pop();
+    if (t.image.isNull()) break;  // shutting down
+
     // Write jpeg into buffer
     QByteArray buffer_bytes;
     QBuffer buffer(&buffer_bytes);
     buffer.open(QIODevice::WriteOnly);
-    cap.save(&buffer, "JPG", 50);
+    t.image.save(&buffer, "JPG", 50);
 
     kj::Array<capnp::byte> buffer_kj = kj::heapArray<capnp::byte>((const capnp::byte*)buffer_bytes.constData(), buffer_bytes.size());
 
     // Send thumbnail
     MessageBuilder msg;
     auto thumbnaild = msg.initEvent().initNavThumbnail();
-    thumbnaild.setFrameId(frame_id);
-    thumbnaild.setTimestampEof(ts);
+    thumbnaild.setFrameId(t.frame_id);
+    thumbnaild.setTimestampEof(t.ts);
     thumbnaild.setThumbnail(buffer_kj);
     pm->send("navThumbnail", msg);
   }
-
-  frame_id++;
 }
 
 uint8_t* MapRenderer::getImage() {
@@ -150,6 +257,14 @@ void MapRenderer::initLayers() {
 }
 
 MapRenderer::~MapRenderer() {
+  if (thumbnail_thread.joinable()) {
+    thumbnails.push({});
+    thumbnail_thread.join();
+  }
+
+  // the buffers are freed in the context they were made in
+  ctx->makeCurrent(surface.get());
+  for (auto &b : pbo) b.reset();
 }
 
 extern "C" {
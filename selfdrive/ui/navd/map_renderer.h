@@ -1,6 +1,7 @@
 #pragma once
 
 #include <memory>
+#include <thread>
 
 #include <QOpenGLContext>
 #include <QMapboxGL>
@@ -10,9 +11,11 @@
 #include <QOffscreenSurface>
 #include <QOpenGLFunctions>
 #include <QOpenGLFramebufferObject>
+#include <QImage>
 
 #include "cereal/visionipc/visionipc_server.h"
 #include "cereal/messaging/messaging.h"
+#include "selfdrive/common/queue.h"
 
 
 class MapRenderer : public QObject {
@@ -34,7 +37,35 @@ private:
 
   std::unique_ptr<VisionIpcServer> vipc_server;
   std::unique_ptr<PubMaster> pm;
-  void sendVipc();
+  void sendVipc(double render_ms);
+
+  // Frames are read back through two pixel pack buffers: one is filled by the
+  // gpu while the previous frame is mapped and copied into a VisionIpc buffer,
+  // so a published frame is one render behind.
+  void readPixels();
+  bool copyPixels(VisionBuf *buf);
+  bool use_pbo = false;
+  bool read_rgb = false;  // else RGBA, when the driver can't read RGB
+  std::unique_ptr<QOpenGLBuffer> pbo[2];
+  int pbo_idx = 0;
+  bool pbo_pending = false;
+  uint64_t pbo_ts = 0;
+
+  // the jpeg encode and send of navThumbnail runs on its own thread
+  struct Thumbnail {
+    QImage image;
+    uint32_t frame_id;
+    uint64_t ts;
+  };
+  SafeQueue<Thumbnail> thumbnails;
+  std::thread thumbnail_thread;
+  void thumbnailThread();
+
+  struct {
+    int frames = 0;
+    double render_ms = 0, readback_ms = 0, publish_ms = 0;
+    double render_max_ms = 0, readback_max_ms = 0, publish_max_ms = 0;
+  } stats;
 
   QMapboxGLSettings m_settings;
   QScopedPointer<QMapboxGL> m_map;
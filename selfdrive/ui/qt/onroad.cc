@@ -66,7 +66,7 @@ OnroadWindow::OnroadWindow(QWidget *parent) : QWidget(parent) {
     }
   });
         record_timer->start(1000/UI_FREQ);
-/*
+
   QWidget* recorder_widget = new QWidget(this);
   QVBoxLayout * recorder_layout = new QVBoxLayout (recorder_widget);
   recorder_layout->setMargin(35);
@@ -76,7 +76,8 @@ OnroadWindow::OnroadWindow(QWidget *parent) : QWidget(parent) {
 
   stacked_layout->addWidget(recorder_widget);
   recorder_widget->raise();
-  alerts->raise();*/
+  alerts->raise();
+  nvg->recorder = recorder;
 #endif
 }
 
@@ -562,6 +563,12 @@ void NvgWindow::paintGL() {
     drawLaneLines(painter, s->scene);
   }
 
+#ifdef QCOM2
+  if (recorder) {
+    recorder->capture_gl(defaultFramebufferObject(), width(), height());
+  }
+#endif
+
   double cur_draw_t = millis_since_boot();
   double dt = cur_draw_t - prev_draw_t;
   if (dt > 66) {
@@ -80,6 +80,9 @@ class NvgWindow : public CameraViewWidget {
 public:
   explicit NvgWindow(VisionStreamType type, QWidget* parent = 0) : CameraViewWidget("camerad", type, true, parent) {}
   OnroadHud *hud;
+#ifdef QCOM2
+  ScreenRecoder *recorder = nullptr;
+#endif
   
 protected:
   void paintGL() override;
@@ -160,7 +163,7 @@ private:
   // neokii
 #ifdef QCOM2
 private:
-  ScreenRecoder* recorder;
+  ScreenRecoder* recorder = nullptr;
   std::shared_ptr<QTimer> record_timer;
   QPoint startPos;
 #endif
@@ -0,0 +1,104 @@
+#include "selfdrive/ui/qt/screenrecorder/gl_capture.h"
+
+#include <cassert>
+
+#include "selfdrive/common/timing.h"
+
+GLCapture::GLCapture(int out_width, int out_height, FrameCallback callback)
+    : out_width(out_width), out_height(out_height), callback(callback) {
+  glGenRenderbuffers(1, &rbo);
+  glBindRenderbuffer(GL_RENDERBUFFER, rbo);
+  glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, out_width, out_height);
+  glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+  GLint prev_fbo = 0;
+  glGetIntegerv(GL_FRAMEBUFFER_BINDING, &prev_fbo);
+  glGenFramebuffers(1, &fbo);
+  glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+  glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, rbo);
+  assert(glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE);
+  glBindFramebuffer(GL_FRAMEBUFFER, prev_fbo);
+
+  for (auto &r : readbacks) {
+    glGenBuffers(1, &r.pbo);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, r.pbo);
+    glBufferData(GL_PIXEL_PACK_BUFFER, out_width * out_height * 4, nullptr, GL_STREAM_READ);
+  }
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+  assert(glGetError() == GL_NO_ERROR);
+}
+
+GLCapture::~GLCapture() {
+  reset();
+  for (auto &r : readbacks) {
+    glDeleteBuffers(1, &r.pbo);
+  }
+  glDeleteFramebuffers(1, &fbo);
+  glDeleteRenderbuffers(1, &rbo);
+}
+
+void GLCapture::reset() {
+  for (; pending > 0; pending--) {
+    Readback &r = readbacks[next_read];
+    glDeleteSync(r.fence);
+    r.fence = 0;
+    next_read = (next_read + 1) % NUM_PBOS;
+  }
+  next_read = next_write = 0;
+}
+
+// hand out every finished readback without waiting on the ones still in flight
+void GLCapture::collect() {
+  while (pending > 0) {
+    Readback &r = readbacks[next_read];
+    if (glClientWaitSync(r.fence, 0, 0) == GL_TIMEOUT_EXPIRED) break;
+
+    glDeleteSync(r.fence);
+    r.fence = 0;
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, r.pbo);
+    void *ptr = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, out_width * out_height * 4, GL_MAP_READ_BIT);
+    if (ptr) {
+      callback((const uint8_t *)ptr, r.ts);
+      glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    next_read = (next_read + 1) % NUM_PBOS;
+    pending--;
+  }
+}
+
+void GLCapture::capture(GLuint src_fbo, int src_width, int src_height) {
+  uint64_t start = nanos_since_boot();
+
+  collect();
+
+  if (pending == NUM_PBOS) {
+    // the GPU is behind, don't queue more work
+    frames_skipped++;
+  } else {
+    Readback &r = readbacks[next_write];
+    r.ts = start;
+
+    // scale on the GPU, flipping vertically so the readback is top-down
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, src_fbo);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, fbo);
+    glBlitFramebuffer(0, 0, src_width, src_height, 0, out_height, out_width, 0, GL_COLOR_BUFFER_BIT, GL_LINEAR);
+
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, fbo);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, r.pbo);
+    glReadPixels(0, 0, out_width, out_height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    r.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    glBindFramebuffer(GL_FRAMEBUFFER, src_fbo);
+
+    next_write = (next_write + 1) % NUM_PBOS;
+    pending++;
+    frames_captured++;
+  }
+
+  double dt = (nanos_since_boot() - start) / 1e6;
+  total_ms += dt;
+  if (dt > max_ms) max_ms = dt;
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+
+#include <GLES3/gl3.h>
+
+// GLCapture, asynchronous readback of a GL framebuffer.
+// The source framebuffer is blitted (and scaled) into an offscreen FBO on the GPU,
+// read into a pixel buffer object and fenced. The PBO is mapped a few frames later
+// once its fence signaled, so the render thread never stalls on the GPU.
+class GLCapture {
+public:
+  // called on the render thread with a top-down RGBA frame of out_width x out_height
+  typedef std::function<void(const uint8_t *rgba, uint64_t ts)> FrameCallback;
+
+  GLCapture(int out_width, int out_height, FrameCallback callback);
+  ~GLCapture();
+
+  // must be called with the GL context that owns src_fbo current
+  void capture(GLuint src_fbo, int src_width, int src_height);
+  // drops all in-flight readbacks
+  void reset();
+
+  // render thread cost of capture()
+  int frames_captured = 0;
+  int frames_skipped = 0;
+  double total_ms = 0, max_ms = 0;
+
+private:
+  static const int NUM_PBOS = 3;
+
+  struct Readback {
+    GLuint pbo = 0;
+    GLsync fence = 0;
+    uint64_t ts = 0;
+  };
+
+  void collect();
+
+  int out_width, out_height;
+  FrameCallback callback;
+  GLuint fbo = 0, rbo = 0;
+  Readback readbacks[NUM_PBOS];
+  int next_read = 0, next_write = 0, pending = 0;
+};
@@ -1,5 +1,6 @@
 #include <CL/cl.h>
 #include <algorithm>
+#include <cstring>
 #include <time.h>
 #include <dirent.h>
 #include <sys/types.h>
@@ -10,6 +11,7 @@
 #include "selfdrive/camerad/transforms/rgb_to_yuv.h"
 #include "selfdrive/common/clutil.h"
 
+#include "selfdrive/common/swaglog.h"
 #include "selfdrive/ui/qt/screenrecorder/screenrecorder.h"
 #include "selfdrive/ui/qt/util.h"
 #include "selfdrive/ui/ui.h"
@@ -21,7 +23,10 @@ static long long milliseconds(void) {
     return (((long long)tv.tv_sec)*1000)+(tv.tv_usec/1000);
 }
 
-ScreenRecoder::ScreenRecoder(QWidget *parent) : QPushButton(parent), image_queue(30) {
+const int CAPTURE_FRAME_COUNT = 4;
+
+ScreenRecoder::ScreenRecoder(QWidget *parent) : QPushButton(parent),
+    free_frames(CAPTURE_FRAME_COUNT), frame_queue(CAPTURE_FRAME_COUNT) {
 
     recording = false;
     uiState()->recording = false;
@@ -50,8 +55,9 @@ ScreenRecoder::ScreenRecoder(QWidget *parent) : QPushButton(parent), image_queue
     if(dst_width % 2 != 0)
         dst_width += 1;
 
-    rgb_buffer = std::make_unique<uint8_t[]>(src_width*src_height*4);
-    rgb_scale_buffer = std::make_unique<uint8_t[]>(dst_width*dst_height*4);
+    for (int i = 0; i < CAPTURE_FRAME_COUNT; i++) {
+      free_frames.push({std::make_unique<uint8_t[]>(dst_width*dst_height*4), 0});
+    }
 
     encoder = std::make_unique<OmxEncoder>(path.c_str(), dst_width, dst_height, UI_FREQ, bitrate, false, false);
 
@@ -136,6 +142,11 @@ void ScreenRecoder::start(bool sound) {
   recording = true;
   uiState()->recording = true;
   frame = 0;
+  frames_dropped = 0;
+  if (gl_capture) {
+    gl_capture->frames_captured = gl_capture->frames_skipped = 0;
+    gl_capture->total_ms = gl_capture->max_ms = 0;
+  }
 
   encoding_thread = std::thread([=] { encoding_thread_func(); });
 
@@ -150,20 +161,39 @@ void ScreenRecoder::start(bool sound) {
 void ScreenRecoder::encoding_thread_func() {
 
   while(recording && encoder) {
-    QImage popImage;
-    if(image_queue.pop_wait_for(popImage, std::chrono::milliseconds(10))) {
+    CaptureFrame captured;
+    if(frame_queue.pop_wait_for(captured, std::chrono::milliseconds(10))) {
+      // frames are already scaled on the GPU, the encoder converts RGBA to NV12 in a single pass
+      encoder->encode_frame_rgba(captured.rgba.get(), dst_width, dst_height, captured.ts);
+      free_frames.push(std::move(captured));
+    }
+  }
+}
 
-      QImage image = popImage.convertToFormat(QImage::Format_RGBA8888);
+void ScreenRecoder::onFrameCaptured(const uint8_t *rgba, uint64_t ts) {
+  CaptureFrame captured;
+  if (!free_frames.try_pop(captured)) {
+    // encoder is behind, never block the UI thread
+    frames_dropped++;
+    return;
+  }
+  memcpy(captured.rgba.get(), rgba, dst_width*dst_height*4);
+  captured.ts = ts;
+  frame_queue.push(std::move(captured));
+}
 
-      libyuv::ARGBScale(image.bits(), image.width()*4,
-            image.width(), image.height(),
-            rgb_scale_buffer.get(), dst_width*4,
-            dst_width, dst_height,
-            libyuv::kFilterBilinear);
+void ScreenRecoder::capture_gl(GLuint fbo, int width, int height) {
+  if (!recording) {
+    if (gl_capture) gl_capture->reset();
+    return;
+  }
 
-      encoder->encode_frame_rgba(rgb_scale_buffer.get(), dst_width, dst_height, (uint64_t)nanos_since_boot());
-    }
+  if (!gl_capture) {
+    gl_capture = std::make_unique<GLCapture>(dst_width, dst_height, [=](const uint8_t *rgba, uint64_t ts) {
+      onFrameCaptured(rgba, ts);
+    });
   }
+  gl_capture->capture(fbo, width, height);
 }
 
 void ScreenRecoder::stop(bool sound) {
@@ -177,10 +207,19 @@ void ScreenRecoder::stop(bool sound) {
     if(sound)
       soundStop.play();
 
-    image_queue.clear();
-
     if(encoding_thread.joinable())
       encoding_thread.join();
+
+    CaptureFrame captured;
+    while (frame_queue.try_pop(captured)) {
+      free_frames.push(std::move(captured));
+    }
+
+    if (gl_capture && gl_capture->frames_captured > 0) {
+      LOG("screen recorder: %d frames, %d skipped, %d dropped, capture %.2f ms avg %.2f ms max",
+          gl_capture->frames_captured, gl_capture->frames_skipped, frames_dropped,
+          gl_capture->total_ms / gl_capture->frames_captured, gl_capture->max_ms);
+    }
   }
 }
 
@@ -195,13 +234,6 @@ void ScreenRecoder::update_screen() {
     }
 
     applyColor();
-
-    QWidget* widget = this;
-    while (widget->parentWidget() != Q_NULLPTR)
-      widget = widget->parentWidget();
-
-    QPixmap pixmap = widget->grab();
-    image_queue.push(pixmap.toImage());
   }
 
   frame++;
@@ -10,6 +10,7 @@
 
 #include "omx_encoder.h"
 #include "blocking_queue.h"
+#include "gl_capture.h"
 #include "selfdrive/ui/ui.h"
 
 class ScreenRecoder : public QPushButton {
@@ -32,11 +33,16 @@ private:
     int src_width, src_height;
     int dst_width, dst_height;
     std::unique_ptr<OmxEncoder> encoder;
-    std::unique_ptr<uint8_t[]> rgb_buffer;
-    std::unique_ptr<uint8_t[]> rgb_scale_buffer;
+    std::unique_ptr<GLCapture> gl_capture;
 
+    struct CaptureFrame {
+      std::unique_ptr<uint8_t[]> rgba;
+      uint64_t ts;
+    };
     std::thread encoding_thread;
-    BlockingQueue<QImage> image_queue;
+    BlockingQueue<CaptureFrame> free_frames;
+    BlockingQueue<CaptureFrame> frame_queue;
+    int frames_dropped;
 
     QColor recording_color;
     int frame;
@@ -48,11 +54,14 @@ private:
     void openEncoder(const char* filename);
     void closeEncoder();
     void encoding_thread_func();
+    void onFrameCaptured(const uint8_t *rgba, uint64_t ts);
 
 public:
     void start(bool sound);
     void stop(bool sound);
     void toggle();
     void update_screen();
+    // called from the onroad paintGL with its framebuffer bound
+    void capture_gl(GLuint fbo, int width, int height);
 
 };
\ No newline at end of file
@@ -0,0 +1,112 @@
+#!/usr/bin/env python3
+import os
+import random
+import re
+import struct
+import subprocess
+import tempfile
+import unittest
+
+VIDINDEX_DIR = os.path.join(os.path.dirname(os.path.realpath(__file__)), "../vidindex")
+VIDINDEX = os.path.join(VIDINDEX_DIR, "vidindex")
+
+# random payloads have plenty of zeros, 00 00 02 and 00 00 03 near misses
+PAYLOAD_BYTES = [0] * 64 + [1, 2, 3] * 8 + list(range(256))
+
+
+def ue(v):
+  b = bin(v + 1)[2:]
+  return "0" * (len(b) - 1) + b
+
+
+def bits_to_bytes(bits):
+  # pad with ones so the header never makes a zero byte
+  bits += "1" * (-len(bits) % 8)
+  return bytes(int(bits[i:i+8], 2) for i in range(0, len(bits), 8))
+
+
+def emulation_prevention(payload):
+  return re.sub(b"\x00\x00(?=[\x00-\x03])", b"\x00\x00\x03", payload)
+
+
+def synthetic_stream(codec, seed, frames):
+  """a stream of random NALs with the headers vidindex parses, and the prefix and index it should produce"""
+  rnd = random.Random(seed)
+  nals = []  # (header bits, prefix, index slice type or None, 4 byte start code)
+
+  def add(header, prefix=False, slice_type=None, long_start=False):
+    nals.append((header, prefix, slice_type, long_start))
+
+  if codec == "hevc":
+    nal_header = lambda typ: "0" + format(typ, "06b") + "000000" + "001"
+    for typ in (32, 33, 34):  # VPS, SPS, PPS
+      add(nal_header(typ) + "1", prefix=True, long_start=typ == 32)
+    for f in range(frames):
+      typ = 19 if f % 20 == 0 else rnd.choice([0, 1])  # IDR_W_RADL or TRAIL
+      slice_type = 2 if typ == 19 else rnd.choice([0, 1])
+      irap = "0" if 16 <= typ <= 23 else ""
+      if rnd.random() < 0.2:
+        add(nal_header(39) + "1")  # SEI
+      add(nal_header(typ) + "1" + irap + "0" + ue(slice_type), slice_type=slice_type, long_start=True)
+      for _ in range(rnd.randint(0, 2)):  # more slices of the same picture
+        add(nal_header(typ) + "0" + irap + "0")
+  else:
+    nal_header = lambda ref, typ: "0" + format(ref, "02b") + format(typ, "05b")
+    add(nal_header(3, 7) + "01100100" + "1111" + "11111" + "11111" + ue(0) + ue(0), prefix=True, long_start=True)
+    add(nal_header(3, 8) + "1", prefix=True)
+    for f in range(frames):
+      typ = 5 if f % 20 == 0 else 1
+      slice_type = 7 if typ == 5 else rnd.choice([5, 6])
+      add(nal_header(3, typ) + ue(0) + ue(slice_type) + ue(0) + format(f % 16, "04b"), slice_type=slice_type, long_start=True)
+      for _ in range(rnd.randint(0, 2)):
+        add(nal_header(3, typ) + ue(rnd.randint(1, 100)) + ue(slice_type) + ue(0) + format(f % 16, "04b"))
+
+  data = bytearray()
+  starts = []
+  for header, _, _, long_start in nals:
+    if long_start:
+      data += b"\x00"
+    starts.append(len(data))
+    size = rnd.choice([rnd.randint(8, 64), rnd.randint(64, 4096), rnd.randint(4096, 40000)])
+    payload = bytes(rnd.choices(PAYLOAD_BYTES, k=size)) + b"\x80"
+    data += b"\x00\x00\x01" + bits_to_bytes(header) + emulation_prevention(payload)
+  data = bytes(data)
+
+  # the last NAL ends 4 bytes early, like the scan in vidindex
+  ends = starts[1:] + [len(data) - 4]
+  prefix = b"".join(data[s:e] for (_, p, _, _), s, e in zip(nals, starts, ends) if p)
+  index = b"".join(struct.pack("<II", t, s) for (_, _, t, _), s in zip(nals, starts) if t is not None)
+  index += struct.pack("<iI", -1, len(data))
+  return data, prefix, index
+
+
+class TestVidindex(unittest.TestCase):
+  @classmethod
+  def setUpClass(cls):
+    subprocess.check_call(["make"], cwd=VIDINDEX_DIR, stdout=subprocess.DEVNULL)
+
+  def _vidindex(self, codec, data, threads):
+    with tempfile.TemporaryDirectory() as tmp:
+      fn = os.path.join(tmp, "video")
+      with open(fn, "wb") as f:
+        f.write(data)
+      prefix_fn, index_fn = os.path.join(tmp, "prefix"), os.path.join(tmp, "index")
+      cmd = [VIDINDEX] + (["-j", str(threads)] if threads else []) + [codec, fn, prefix_fn, index_fn]
+      subprocess.check_call(cmd)
+      with open(prefix_fn, "rb") as f, open(index_fn, "rb") as g:
+        return f.read(), g.read()
+
+  def test_streams(self):
+    for codec in ("hevc", "h264"):
+      for seed in range(3):
+        data, prefix, index = synthetic_stream(codec, seed, 400)
+        # serial, the default, and enough chunks for boundaries to land inside start codes
+        for threads in (1, None, 3, 7, 16):
+          with self.subTest(codec=codec, seed=seed, threads=threads):
+            out_prefix, out_index = self._vidindex(codec, data, threads)
+            self.assertEqual(out_prefix, prefix)
+            self.assertEqual(out_index, index)
+
+
+if __name__ == "__main__":
+  unittest.main()
@@ -1,3 +1,5 @@
+#define _GNU_SOURCE
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdbool.h>
@@ -8,11 +10,16 @@
 #include <fcntl.h>
 #include <sys/stat.h>
 #include <sys/mman.h>
+#include <pthread.h>
 
 #include "bitstream.h"
 
 #define START_CODE 0x000001
 
+// files at least this big are scanned in parallel by default
+#define PARALLEL_MIN_SIZE (4 << 20)
+#define MAX_THREADS 16
+
 static uint32_t read24be(const uint8_t* ptr) {
     return (ptr[0] << 16) | (ptr[1] << 8) | ptr[2];
 }
@@ -23,6 +30,95 @@ static void write32le(FILE *of, uint32_t v) {
   fwrite(va, 1, sizeof(va), of);
 }
 
+// offsets of the start codes in the file, in order
+struct start_codes {
+  size_t *offsets;
+  size_t count, cap;
+};
+
+static void start_codes_push(struct start_codes *sc, size_t offset) {
+  if (sc->count == sc->cap) {
+    sc->cap = sc->cap ? sc->cap * 2 : 1024;
+    sc->offsets = realloc(sc->offsets, sc->cap * sizeof(size_t));
+    assert(sc->offsets);
+  }
+  sc->offsets[sc->count++] = offset;
+}
+
+// Finds the start codes beginning in [lo, hi), reading up to hi+2. memchr is
+// vectorized in libc, so it looks for the 0x01 and checks the zeros before it
+// instead of comparing three bytes at every position.
+static void find_start_codes(const uint8_t *data, size_t lo, size_t hi, struct start_codes *sc) {
+  const uint8_t *p = data + lo + 2;
+  const uint8_t *end = data + hi + 2;
+  while (p < end && (p = memchr(p, 0x01, end - p)) != NULL) {
+    if (p[-1] == 0 && p[-2] == 0) {
+      start_codes_push(sc, p - 2 - data);
+    }
+    p++;
+  }
+}
+
+struct scan_chunk {
+  const uint8_t *data;
+  size_t lo, hi;
+  struct start_codes sc;
+};
+
+static void *scan_thread(void *arg) {
+  struct scan_chunk *c = arg;
+  find_start_codes(c->data, c->lo, c->hi, &c->sc);
+  return NULL;
+}
+
+// Finds every start code a byte by byte scan from the first NAL would stop at.
+// The file is split into chunks scanned in parallel, a start code across a
+// chunk boundary belongs to the chunk it begins in, so the chunks' lists just
+// concatenate.
+static struct start_codes scan_start_codes(const uint8_t *data, size_t file_size, int threads) {
+  // after the first NAL's start code, and not in the last 4 bytes
+  const size_t lo = 2, hi = file_size - 4;
+
+  struct scan_chunk chunks[MAX_THREADS] = {0};
+  pthread_t tids[MAX_THREADS];
+  if (threads < 1) threads = 1;
+  if (threads > MAX_THREADS) threads = MAX_THREADS;
+  if (hi <= lo) threads = 1;
+
+  for (int i = 0; i < threads; i++) {
+    chunks[i].data = data;
+    chunks[i].lo = (hi > lo) ? lo + (hi - lo) * i / threads : lo;
+    chunks[i].hi = (hi > lo) ? lo + (hi - lo) * (i + 1) / threads : lo;
+  }
+  for (int i = 1; i < threads; i++) {
+    int err = pthread_create(&tids[i], NULL, scan_thread, &chunks[i]);
+    assert(err == 0);
+  }
+  scan_thread(&chunks[0]);
+
+  struct start_codes sc = chunks[0].sc;
+  for (int i = 1; i < threads; i++) {
+    pthread_join(tids[i], NULL);
+    for (size_t j = 0; j < chunks[i].sc.count; j++) {
+      start_codes_push(&sc, chunks[i].sc.offsets[j]);
+    }
+    free(chunks[i].sc.offsets);
+  }
+  return sc;
+}
+
+// where the NAL at ptr ends: the next start code, or 4 bytes before the end of the file
+static const uint8_t *next_nal(const uint8_t *data, const uint8_t *ptr, const uint8_t *ptr_end,
+                               const struct start_codes *sc, size_t *i) {
+  while (*i < sc->count && data + sc->offsets[*i] <= ptr) {
+    (*i)++;
+  }
+  if (*i < sc->count) {
+    return data + sc->offsets[*i];
+  }
+  return (ptr + 1 < ptr_end - 4) ? ptr_end - 4 : ptr + 1;
+}
+
 // Table 7-1
 enum hevc_nal_type {
   HEVC_NAL_TYPE_TRAIL_N = 0,
@@ -60,7 +156,7 @@ enum hevc_slice_type {
   HEVC_SLICE_I = 2,
 };
 
-static void hevc_index(const uint8_t *data, size_t file_size, FILE *of_prefix, FILE *of_index) {
+static void hevc_index(const uint8_t *data, size_t file_size, const struct start_codes *sc, FILE *of_prefix, FILE *of_index) {
   const uint8_t* ptr = data;
   const uint8_t* ptr_end = data + file_size;
 
@@ -72,11 +168,9 @@ static void hevc_index(const uint8_t *data, size_t file_size, FILE *of_prefix, F
   uint32_t num_extra_slice_header_bits = 0;
   uint32_t dependent_slice_segments_enabled_flag = 0;
 
+  size_t sc_idx = 0;
   while (ptr < ptr_end) {
-    const uint8_t* next = ptr+1;
-    for (; next < ptr_end-4; next++) {
-      if (read24be(next) == START_CODE) break;
-    }
+    const uint8_t* next = next_nal(data, ptr, ptr_end, sc, &sc_idx);
     size_t nal_size = next - ptr;
     if (nal_size < 6) {
       break;
@@ -183,7 +277,7 @@ enum h264_slice_type {
   // ...
 };
 
-static void h264_index(const uint8_t *data, size_t file_size, FILE *of_prefix, FILE *of_index) {
+static void h264_index(const uint8_t *data, size_t file_size, const struct start_codes *sc, FILE *of_prefix, FILE *of_index) {
   const uint8_t* ptr = data;
   const uint8_t* ptr_end = data + file_size;
 
@@ -197,11 +291,9 @@ static void h264_index(const uint8_t *data, size_t file_size, FILE *of_prefix, F
 
   int last_frame_num = -1;
 
+  size_t sc_idx = 0;
   while (ptr < ptr_end) {
-    const uint8_t* next = ptr+1;
-    for (; next < ptr_end-4; next++) {
-      if (read24be(next) == START_CODE) break;
-    }
+    const uint8_t* next = next_nal(data, ptr, ptr_end, sc, &sc_idx);
     size_t nal_size = next - ptr;
     if (nal_size < 5) {
       break;
@@ -265,13 +357,24 @@ static void h264_index(const uint8_t *data, size_t file_size, FILE *of_prefix, F
 }
 
 int main(int argc, char** argv) {
-  if (argc != 5) {
-    fprintf(stderr, "usage: %s h264|hevc file_path out_prefix out_index\n", argv[0]);
+  int threads = 0;
+  int opt;
+  while ((opt = getopt(argc, argv, "j:")) != -1) {
+    switch (opt) {
+    case 'j':
+      threads = atoi(optarg);
+      break;
+    default:
+      argc = 0;
+    }
+  }
+  if (argc - optind != 4) {
+    fprintf(stderr, "usage: %s [-j threads] h264|hevc file_path out_prefix out_index\n", argv[0]);
     exit(1);
   }
 
-  const char* file_type = argv[1];
-  const char* file_path = argv[2];
+  const char* file_type = argv[optind];
+  const char* file_path = argv[optind + 1];
 
   int fd = open(file_path, O_RDONLY, 0);
   if (fd < 0) {
@@ -279,9 +382,9 @@ int main(int argc, char** argv) {
     exit(1);
   }
 
-  FILE *of_prefix = fopen(argv[3], "wb");
+  FILE *of_prefix = fopen(argv[optind + 2], "wb");
   assert(of_prefix);
-  FILE *of_index = fopen(argv[4], "wb");
+  FILE *of_index = fopen(argv[optind + 3], "wb");
   assert(of_index);
 
   off_t file_size = lseek(fd, 0, SEEK_END);
@@ -291,15 +394,24 @@ int main(int argc, char** argv) {
 
   const uint8_t* data = (const uint8_t*)mmap(NULL, file_size, PROT_READ, MAP_PRIVATE, fd, 0);
   assert(data != MAP_FAILED);
+  // start reading ahead, the scan threads fault in their chunks in parallel
+  madvise((void*)data, file_size, MADV_WILLNEED);
+
+  if (threads == 0) {
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    threads = (file_size >= PARALLEL_MIN_SIZE && cpus > 1) ? cpus : 1;
+  }
+  struct start_codes sc = scan_start_codes(data, file_size, threads);
 
   if (strcmp(file_type, "hevc") == 0) {
-    hevc_index(data, file_size, of_prefix, of_index);
+    hevc_index(data, file_size, &sc, of_prefix, of_index);
   } else if (strcmp(file_type, "h264") == 0) {
-    h264_index(data, file_size, of_prefix, of_index);
+    h264_index(data, file_size, &sc, of_prefix, of_index);
   } else {
     assert(false);
   }
 
+  free(sc.offsets);
   munmap((void*)data, file_size);
   close(fd);
 